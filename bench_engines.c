@@ -0,0 +1,215 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "expression.h"
+#include "peano.h"
+#include "rewrite.h"
+#include "term.h"
+#include "term_io.h"
+#include "unify.h"
+#include "valuate.h"
+
+#undef NDEBUG // FORCE ASSERT ACTIVATION
+
+/*!
+ * \file
+ * \brief Benchmark of the engines on the inputs written by \c bench_generate .
+ *
+ * Usage: \c ./bench_engines [ \c -s ] \c file … where each file is named
+ * \c shape_size.term (the shape selects the engine, see \c bench_generate ).
+ * With \c -s , terms are copied with sharing (see \c term_sharing_enable ).
+ *
+ * Outputs one tab-separated line per file and operation:
+ * \c shape \c size \c nodes \c operation \c runs \c mean_us
+ * where \c mean_us is the mean time of the operation alone (the destruction
+ * of its result is not counted, except for the \c destroy operation).
+ * Lines starting with \c # are comments, so that outputs of two revisions can
+ * be joined on the first four columns.
+ */
+
+/*!
+ * Minimum time spent on each measurement, in seconds.
+ */
+#define MIN_DURATION 0.2
+
+/*!
+ * Maximum number of runs of each measurement.
+ */
+#define MAX_RUNS 100000
+
+/*!
+ * An operation on the input term; the returned term (if any) is destroyed
+ * outside of the measured time.
+ */
+typedef term (*operation)(term t);
+
+/*! File of the input being measured (read by \c op_scan ). */
+static char const *current_file;
+
+/*! Prevent the compiler from removing the measured calls. */
+static volatile long sink;
+
+static term op_scan(term t) {
+  (void)t;
+  FILE *in = fopen(current_file, "r");
+  assert(in != NULL);
+  term res = term_scan(in);
+  fclose(in);
+  return res;
+}
+
+static term op_copy(term t) { return term_copy(t); }
+
+static term op_print(term t) {
+  FILE *out = tmpfile();
+  assert(out != NULL);
+  term_print_compact(t, out);
+  fclose(out);
+  return NULL;
+}
+
+static term op_expression(term t) {
+  sink += expression_valuate(t);
+  return NULL;
+}
+
+/*!
+ * Engine run for each shape (NULL if only the generic operations apply).
+ */
+static struct {
+  char const *const shape;
+  char const *const name;
+  operation op;
+} const engines[] = {
+    {"wide", NULL, NULL},
+    {"deep", NULL, NULL},
+    {"rewrite", "rewrite", term_rewrite},
+    {"unify", "unify", term_unify},
+    {"valuate", "valuate", term_valuate},
+    {"expression", "expression", op_expression},
+    {"peano", "peano", peano_valuate},
+    {"tree", NULL, NULL},
+    {"double", "valuate", term_valuate},
+};
+
+static term_visit count_visitor(term t, int depth, void *data) {
+  (void)depth;
+  long *count = data;
+  long n = term_get_successor_run(t);
+  *count += n > 0 ? n + 1 : 1;
+  return TERM_VISIT_CONTINUE;
+}
+
+static long count_nodes(term t) {
+  long count = 0;
+  term_traverse(t, count_visitor, NULL, &count);
+  return count;
+}
+
+static double seconds(clock_t start) {
+  return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+static void print_line(char const *const shape, long size, long nodes,
+                       char const *const name, long nb_runs, double total) {
+  printf("%s\t%ld\t%ld\t%s\t%ld\t%.3f\n", shape, size, nodes, name, nb_runs,
+         total * 1e6 / nb_runs);
+}
+
+/*!
+ * Measure an operation, repeated until \c MIN_DURATION is spent.
+ */
+static void measure(char const *const shape, long size, long nodes,
+                    char const *const name, operation op, term t) {
+  long nb_runs = 0;
+  double total = 0;
+  clock_t begin = clock();
+  do {
+    clock_t start = clock();
+    term res = op(t);
+    total += seconds(start);
+    term_destroy(&res);
+    nb_runs++;
+  } while (seconds(begin) < MIN_DURATION && nb_runs < MAX_RUNS);
+  print_line(shape, size, nodes, name, nb_runs, total);
+}
+
+/*!
+ * Measure comparison with an equal copy (the whole term is scanned).
+ */
+static void measure_compare(char const *const shape, long size, long nodes,
+                            term t) {
+  term copy = term_copy(t);
+  long nb_runs = 0;
+  clock_t start = clock();
+  do {
+    sink += term_compare(t, copy);
+    nb_runs++;
+  } while (seconds(start) < MIN_DURATION && nb_runs < MAX_RUNS);
+  print_line(shape, size, nodes, "compare", nb_runs, seconds(start));
+  term_destroy(&copy);
+}
+
+static void measure_destroy(char const *const shape, long size, long nodes,
+                            term t) {
+  long nb_runs = 0;
+  double total = 0;
+  clock_t begin = clock();
+  do {
+    term copy = term_copy(t);
+    clock_t start = clock();
+    term_destroy(&copy);
+    total += seconds(start);
+    nb_runs++;
+  } while (seconds(begin) < MIN_DURATION && nb_runs < MAX_RUNS);
+  print_line(shape, size, nodes, "destroy", nb_runs, total);
+}
+
+static void bench_file(char const *const file_name) {
+  char const *base = strrchr(file_name, '/');
+  base = base == NULL ? file_name : base + 1;
+  char const *underscore = strchr(base, '_');
+  assert(underscore != NULL);
+  long size = strtol(underscore + 1, NULL, 10);
+  unsigned e = 0;
+  while (e < sizeof(engines) / sizeof(engines[0]) &&
+         (strlen(engines[e].shape) != (size_t)(underscore - base) ||
+          strncmp(base, engines[e].shape, underscore - base) != 0)) {
+    e++;
+  }
+  assert(e < sizeof(engines) / sizeof(engines[0]));
+  char const *const shape = engines[e].shape;
+
+  current_file = file_name;
+  term t = op_scan(NULL);
+  long nodes = count_nodes(t);
+  measure(shape, size, nodes, "scan", op_scan, t);
+  measure(shape, size, nodes, "copy", op_copy, t);
+  measure_compare(shape, size, nodes, t);
+  measure(shape, size, nodes, "print", op_print, t);
+  measure_destroy(shape, size, nodes, t);
+  if (engines[e].op != NULL) {
+    measure(shape, size, nodes, engines[e].name, engines[e].op, t);
+  }
+  term_destroy(&t);
+  fflush(stdout);
+}
+
+int main(int argc, char **argv) {
+  int first = 1;
+  if (argc > 1 && strcmp(argv[1], "-s") == 0) {
+    term_sharing_enable(true);
+    first = 2;
+  }
+  printf("# shape\tsize\tnodes\toperation\truns\tmean_us\n");
+  if (term_sharing_is_enabled()) {
+    printf("# sharing on\n");
+  }
+  for (int i = first; i < argc; i++) {
+    bench_file(argv[i]);
+  }
+  return 0;
+}
@@ -0,0 +1,169 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*!
+ * \file
+ * \brief Generator of scaled synthetic inputs for \c bench_engines .
+ *
+ * Usage: \c ./bench_generate \c shape \c size writes on the standard output a
+ * term in the format read by \c term_scan . The shape also selects the engine
+ * run on the term by \c bench_engines :
+ * \li \c wide \c f ( a0 … a(size-1) )
+ * \li \c deep \c f ( f ( … a … ) ) with \c size \c f
+ * \li \c rewrite \c rewrite ( -> ( a b ) g ( a … a ) ) with \c size redexes
+ * \li \c unify \c unify ( = ( 'x0 f ( 'x1 ) ) … = ( 'x(size-1) a ) )
+ * \li \c valuate \c size nested \c set, each variable defined from the
+ * previous one
+ * \li \c expression complete binary tree of \c + and \c - with \c size leaves
+ * (rounded up to a power of two)
+ * \li \c peano \c + ( * ( 2 3 ) … ) with \c size products
+ * \li \c tree complete binary tree of \c f with \c size leaves \c a (rounded
+ * up to a power of two)
+ * \li \c double \c size nested \c set, each variable defined as \c f of twice
+ * the previous one (the value has 2^size leaves)
+ */
+
+static void generate_wide(long size) {
+  printf("f (");
+  for (long i = 0; i < size; i++) {
+    printf(" a%ld", i);
+  }
+  printf(" )\n");
+}
+
+static void generate_deep(long size) {
+  for (long i = 0; i < size; i++) {
+    printf("f ( ");
+  }
+  printf("a");
+  for (long i = 0; i < size; i++) {
+    printf(" )");
+  }
+  printf("\n");
+}
+
+static void generate_rewrite(long size) {
+  printf("rewrite (\n -> ( a b )\n g (");
+  for (long i = 0; i < size; i++) {
+    printf(" a");
+  }
+  printf(" )\n)\n");
+}
+
+static void generate_unify(long size) {
+  printf("unify (\n");
+  for (long i = 0; i + 1 < size; i++) {
+    printf(" = ( 'x%ld f ( 'x%ld ) )\n", i, i + 1);
+  }
+  printf(" = ( 'x%ld a )\n)\n", size - 1);
+}
+
+static void generate_valuate(long size) {
+  printf("set ( 'v0 a\n");
+  for (long i = 1; i < size; i++) {
+    printf(" set ( 'v%ld f ( 'v%ld )\n", i, i - 1);
+  }
+  printf(" 'v%ld\n", size - 1);
+  for (long i = 0; i < size; i++) {
+    printf(" )");
+  }
+  printf("\n");
+}
+
+/*!
+ * Balanced tree of height \c height ; leaves are numbered from \c *leaf .
+ */
+static void generate_expression_rec(int height, long *leaf) {
+  if (height == 0) {
+    printf(" %ld", (*leaf)++ % 10);
+    return;
+  }
+  printf(" %s (", height % 2 ? "+" : "-");
+  generate_expression_rec(height - 1, leaf);
+  generate_expression_rec(height - 1, leaf);
+  printf(" )");
+}
+
+static void generate_expression(long size) {
+  int height = 0;
+  while ((1L << height) < size) {
+    height++;
+  }
+  long leaf = 0;
+  generate_expression_rec(height, &leaf);
+  printf("\n");
+}
+
+static void generate_peano(long size) {
+  printf("+ (");
+  for (long i = 0; i < size; i++) {
+    printf(" * ( 2 3 )");
+  }
+  printf(" )\n");
+}
+
+static void generate_tree_rec(int height) {
+  if (height == 0) {
+    printf(" a");
+    return;
+  }
+  printf(" f (");
+  generate_tree_rec(height - 1);
+  generate_tree_rec(height - 1);
+  printf(" )");
+}
+
+static void generate_tree(long size) {
+  int height = 0;
+  while ((1L << height) < size) {
+    height++;
+  }
+  generate_tree_rec(height);
+  printf("\n");
+}
+
+static void generate_double(long size) {
+  printf("set ( 'd0 a\n");
+  for (long i = 1; i <= size; i++) {
+    printf(" set ( 'd%ld f ( 'd%ld 'd%ld )\n", i, i - 1, i - 1);
+  }
+  printf(" 'd%ld\n", size);
+  for (long i = 0; i <= size; i++) {
+    printf(" )");
+  }
+  printf("\n");
+}
+
+static struct {
+  char const *const name;
+  void (*generate)(long size);
+} const shapes[] = {
+    {"wide", generate_wide},
+    {"deep", generate_deep},
+    {"rewrite", generate_rewrite},
+    {"unify", generate_unify},
+    {"valuate", generate_valuate},
+    {"expression", generate_expression},
+    {"peano", generate_peano},
+    {"tree", generate_tree},
+    {"double", generate_double},
+};
+
+int main(int argc, char **argv) {
+  long size = argc == 3 ? strtol(argv[2], NULL, 10) : 0;
+  if (size > 0) {
+    for (unsigned i = 0; i < sizeof(shapes) / sizeof(shapes[0]); i++) {
+      if (strcmp(argv[1], shapes[i].name) == 0) {
+        shapes[i].generate(size);
+        return 0;
+      }
+    }
+  }
+  fprintf(stderr, "usage: %s shape size\nshapes:", argv[0]);
+  for (unsigned i = 0; i < sizeof(shapes) / sizeof(shapes[0]); i++) {
+    fprintf(stderr, " %s", shapes[i].name);
+  }
+  fprintf(stderr, "\n");
+  return 1;
+}
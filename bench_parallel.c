@@ -0,0 +1,180 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rewrite.h"
+#include "scheduler.h"
+#include "term.h"
+#include "term_io.h"
+#include "term_parallel.h"
+#include "term_trace.h"
+#include "valuate.h"
+
+#undef NDEBUG // FORCE ASSERT ACTIVATION
+
+/*!
+ * \file
+ * \brief Scaling of the parallel operations with the number of threads.
+ *
+ * Usage: \c ./bench_parallel \c max_threads \c file … where each file is named
+ * \c shape_size.term (see \c bench_generate ).
+ * The operations are run in a scheduler with 1, 2, 4… up to \c max_threads
+ * workers: the engine of the shape for \c rewrite , \c valuate and
+ * \c double , \c term_copy_parallel , \c term_compare_parallel and
+ * \c term_destroy_parallel otherwise.
+ *
+ * Outputs one tab-separated line per file, operation and number of threads:
+ * \c shape \c size \c nodes \c operation \c threads \c runs \c mean_us
+ * where \c mean_us is the mean elapsed (wall-clock) time of the operation.
+ * Lines starting with \c # are comments.
+ */
+
+/*!
+ * Minimum time spent on each measurement, in micro-seconds.
+ */
+#define MIN_DURATION 200000
+
+/*!
+ * Maximum number of runs of each measurement.
+ */
+#define MAX_RUNS 10000
+
+/*! Prevent the compiler from removing the measured calls. */
+static volatile long sink;
+
+static term_visit count_visitor(term t, int depth, void *data) {
+  (void)depth;
+  long *count = data;
+  long n = term_get_successor_run(t);
+  *count += n > 0 ? n + 1 : 1;
+  return TERM_VISIT_CONTINUE;
+}
+
+static long count_nodes(term t) {
+  long count = 0;
+  term_traverse(t, count_visitor, NULL, &count);
+  return count;
+}
+
+static void print_line(char const *const shape, long size, long nodes,
+                       char const *const name, int nb_threads, long nb_runs,
+                       double total) {
+  printf("%s\t%ld\t%ld\t%s\t%d\t%ld\t%.3f\n", shape, size, nodes, name,
+         nb_threads, nb_runs, total / nb_runs);
+}
+
+/*!
+ * Measure an engine (the destruction of its result is not counted).
+ */
+static void measure_engine(char const *const shape, long size, long nodes,
+                           char const *const name, term (*engine)(term t),
+                           term t, int nb_threads) {
+  long nb_runs = 0;
+  double total = 0;
+  double begin = term_trace_now();
+  do {
+    double start = term_trace_now();
+    term res = engine(t);
+    total += term_trace_now() - start;
+    term_destroy(&res);
+    nb_runs++;
+  } while (term_trace_now() - begin < MIN_DURATION && nb_runs < MAX_RUNS);
+  print_line(shape, size, nodes, name, nb_threads, nb_runs, total);
+}
+
+static void measure_copy(char const *const shape, long size, long nodes,
+                         term t, int nb_threads) {
+  long nb_runs = 0;
+  double total = 0;
+  double begin = term_trace_now();
+  do {
+    double start = term_trace_now();
+    term copy = term_copy_parallel(t);
+    total += term_trace_now() - start;
+    term_destroy(&copy);
+    nb_runs++;
+  } while (term_trace_now() - begin < MIN_DURATION && nb_runs < MAX_RUNS);
+  print_line(shape, size, nodes, "copy", nb_threads, nb_runs, total);
+}
+
+/*!
+ * Measure comparison with an equal copy (the whole term is scanned).
+ */
+static void measure_compare(char const *const shape, long size, long nodes,
+                            term t, int nb_threads) {
+  term copy = term_copy(t);
+  long nb_runs = 0;
+  double start = term_trace_now();
+  do {
+    sink += term_compare_parallel(t, copy);
+    nb_runs++;
+  } while (term_trace_now() - start < MIN_DURATION && nb_runs < MAX_RUNS);
+  print_line(shape, size, nodes, "compare", nb_threads, nb_runs,
+             term_trace_now() - start);
+  term_destroy(&copy);
+}
+
+static void measure_destroy(char const *const shape, long size, long nodes,
+                            term t, int nb_threads) {
+  long nb_runs = 0;
+  double total = 0;
+  double begin = term_trace_now();
+  do {
+    term copy = term_copy(t);
+    double start = term_trace_now();
+    term_destroy_parallel(&copy);
+    total += term_trace_now() - start;
+    nb_runs++;
+  } while (term_trace_now() - begin < MIN_DURATION && nb_runs < MAX_RUNS);
+  print_line(shape, size, nodes, "destroy", nb_threads, nb_runs, total);
+}
+
+static void bench_file(char const *const file_name, int max_threads) {
+  char const *base = strrchr(file_name, '/');
+  base = base == NULL ? file_name : base + 1;
+  char const *underscore = strchr(base, '_');
+  assert(underscore != NULL);
+  long size = strtol(underscore + 1, NULL, 10);
+  char shape[64];
+  snprintf(shape, sizeof(shape), "%.*s", (int)(underscore - base), base);
+
+  FILE *in = fopen(file_name, "r");
+  assert(in != NULL);
+  term t = term_scan(in);
+  fclose(in);
+  long nodes = count_nodes(t);
+  for (int n = 1;; n = 2 * n < max_threads ? 2 * n : max_threads) {
+    scheduler s = scheduler_create(n);
+    scheduler_enter(s);
+    if (strcmp(shape, "rewrite") == 0) {
+      measure_engine(shape, size, nodes, "rewrite", term_rewrite, t, n);
+    } else if (strcmp(shape, "valuate") == 0 || strcmp(shape, "double") == 0) {
+      measure_engine(shape, size, nodes, "valuate", term_valuate, t, n);
+    } else {
+      measure_copy(shape, size, nodes, t, n);
+      measure_compare(shape, size, nodes, t, n);
+      measure_destroy(shape, size, nodes, t, n);
+    }
+    scheduler_leave(s);
+    scheduler_destroy(&s);
+    fflush(stdout);
+    if (n == max_threads) {
+      break;
+    }
+  }
+  term_destroy(&t);
+}
+
+int main(int argc, char **argv) {
+  int max_threads = argc > 1 ? atoi(argv[1]) : 0;
+  if (max_threads <= 0) {
+    fprintf(stderr, "usage: %s max_threads file ...\n", argv[0]);
+    return 1;
+  }
+  printf("# shape\tsize\tnodes\toperation\tthreads\truns\tmean_us\n");
+  for (int i = 2; i < argc; i++) {
+    bench_file(argv[i], max_threads);
+  }
+  return 0;
+}
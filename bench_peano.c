@@ -0,0 +1,90 @@
+#include <assert.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "peano.h"
+#include "term.h"
+#include "term_io.h"
+
+#undef NDEBUG // FORCE ASSERT ACTIVATION
+
+/*!
+ * Largest result for which the stepwise normalizer is run (it costs a step and
+ * a node per successor of every intermediate sum and product, beyond that a
+ * single measure takes too long).
+ */
+#define STEPWISE_LIMIT 50000
+
+/*!
+ * Minimum time spent on each measurement, in seconds.
+ */
+#define MIN_DURATION 0.05
+
+/*!
+ * Copy a term with all its numbers (decimal or Peano) multiplied by factor.
+ */
+static term scale(term t, long factor) {
+  long n;
+  int value;
+  if (term_is_peano(t, &n)) {
+    return term_create_peano(n * factor);
+  }
+  if (term_get_arity(t) == 0 && term_is_number(t, &value)) {
+    return term_create_peano(value * factor);
+  }
+  term res = term_create(term_get_symbol(t));
+  for (int i = 0; i < term_get_arity(t); i++) {
+    term_add_argument_last(res, scale(term_get_argument(t, i), factor));
+  }
+  return res;
+}
+
+/*!
+ * Return the mean time of f on t, in micro-seconds.
+ */
+static double measure(term (*f)(term), term t) {
+  long nb_runs = 0;
+  clock_t start = clock();
+  clock_t end;
+  do {
+    term res = f(t);
+    term_destroy(&res);
+    nb_runs++;
+    end = clock();
+  } while ((double)(end - start) / CLOCKS_PER_SEC < MIN_DURATION);
+  return (double)(end - start) / CLOCKS_PER_SEC * 1e6 / nb_runs;
+}
+
+static void bench_file(char const *const file_name) {
+  FILE *in = fopen(file_name, "r");
+  assert(in != NULL);
+  term t = term_scan(in);
+  fclose(in);
+  for (long factor = 1; factor <= 1000; factor *= 10) {
+    term t_scaled = scale(t, factor);
+    term res = peano_valuate(t_scaled);
+    long value;
+    bool ok = term_is_peano(res, &value);
+    assert(ok);
+    term_destroy(&res);
+    printf("%-28s %6ld %12ld %12.2f %12.2f", file_name, factor, value,
+           measure(peano_valuate, t_scaled),
+           measure(peano_normalize, t_scaled));
+    if (value <= STEPWISE_LIMIT) {
+      printf(" %12.2f\n", measure(peano_normalize_stepwise, t_scaled));
+    } else {
+      printf(" %12s\n", "-");
+    }
+    term_destroy(&t_scaled);
+  }
+  term_destroy(&t);
+}
+
+int main(void) {
+  printf("%-28s %6s %12s %12s %12s %12s\n", "# file", "scale", "value",
+         "integer_us", "fast_us", "stepwise_us");
+  bench_file("DATA/Terms/t_peano_0.term");
+  bench_file("DATA/Terms/t_peano_1.term");
+  bench_file("DATA/Terms/t_peano_2.term");
+  return 0;
+}
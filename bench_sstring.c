@@ -0,0 +1,175 @@
+#include <assert.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "sstring.h"
+
+#undef NDEBUG // FORCE ASSERT ACTIVATION
+
+/*!
+ * \file
+ * \brief Micro-benchmark of \c sstring comparison, hash and validation against
+ * char by char loops on the same symbols.
+ *
+ * For each length, prints the time per operation (in ns) of the loop and of
+ * the \c sstring function, and the speedup.
+ * Timings are only meaningful for optimized modules: with the default \c -O0
+ * the SSE2 intrinsics are not inlined.
+ */
+
+/*! Number of distinct symbols of each length. */
+#define NB_SYMBOLS 1024
+
+/*! Number of passes over the symbols for each measurement. */
+#define NB_PASSES 200
+
+/*! Symbols as C-strings, for the char by char versions. */
+static char *texts[NB_SYMBOLS];
+static char *texts_copy[NB_SYMBOLS];
+
+/*! Same symbols as sstring. */
+static sstring symbols[NB_SYMBOLS];
+static sstring symbols_copy[NB_SYMBOLS];
+
+/*! Prevent the compiler from removing the measured calls. */
+static volatile unsigned long sink;
+
+static int loop_compare(char const *a, char const *b, int la, int lb) {
+  int n = la < lb ? la : lb;
+  for (int i = 0; i < n; i++) {
+    if (a[i] != b[i]) {
+      return (unsigned char)a[i] < (unsigned char)b[i] ? -1 : 1;
+    }
+  }
+  return la < lb ? -1 : (la > lb ? 1 : 0);
+}
+
+static unsigned int loop_hash(char const *a, int length) {
+  unsigned int h = 2166136261u;
+  for (int i = 0; i < length; i++) {
+    h ^= (unsigned char)a[i];
+    h *= 16777619u;
+  }
+  return h;
+}
+
+static bool loop_is_token(char const *a, int length) {
+  for (int i = 0; i < length; i++) {
+    if (isspace((unsigned char)a[i]) || a[i] == '(' || a[i] == ')') {
+      return false;
+    }
+  }
+  return 0 < length;
+}
+
+static double seconds(clock_t start) {
+  return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+static void print_line(char const *const name, int length, double t_loop,
+                       double t_sstring) {
+  double const nb_op = (double)NB_SYMBOLS * NB_PASSES;
+  printf("%-8s %6d %12.2f %12.2f %8.2f\n", name, length, t_loop * 1e9 / nb_op,
+         t_sstring * 1e9 / nb_op, t_loop / t_sstring);
+}
+
+static void bench_length(int length) {
+  for (int k = 0; k < NB_SYMBOLS; k++) {
+    texts[k] = malloc(length + 1);
+    assert(NULL != texts[k]);
+    for (int i = 0; i < length; i++) {
+      texts[k][i] = 'a' + rand() % 26;
+    }
+    texts[k][length] = '\0';
+    texts_copy[k] = malloc(length + 1);
+    assert(NULL != texts_copy[k]);
+    memcpy(texts_copy[k], texts[k], length + 1);
+    symbols[k] = sstring_create_string(texts[k]);
+    symbols_copy[k] = sstring_create_string(texts[k]);
+  }
+  unsigned long acc = 0;
+  clock_t start;
+  double t_loop;
+
+  // equal symbols: the whole symbol is scanned
+  start = clock();
+  for (int p = 0; p < NB_PASSES; p++) {
+    for (int k = 0; k < NB_SYMBOLS; k++) {
+      acc += loop_compare(texts[k], texts_copy[k], length, length);
+    }
+  }
+  t_loop = seconds(start);
+  start = clock();
+  for (int p = 0; p < NB_PASSES; p++) {
+    for (int k = 0; k < NB_SYMBOLS; k++) {
+      acc += sstring_compare(symbols[k], symbols_copy[k]);
+    }
+  }
+  print_line("compare", length, t_loop, seconds(start));
+
+  start = clock();
+  for (int p = 0; p < NB_PASSES; p++) {
+    for (int k = 0; k < NB_SYMBOLS; k++) {
+      acc += 0 == loop_compare(texts[k], texts_copy[k], length, length);
+    }
+  }
+  t_loop = seconds(start);
+  start = clock();
+  for (int p = 0; p < NB_PASSES; p++) {
+    for (int k = 0; k < NB_SYMBOLS; k++) {
+      acc += sstring_equals(symbols[k], symbols_copy[k]);
+    }
+  }
+  print_line("equals", length, t_loop, seconds(start));
+
+  start = clock();
+  for (int p = 0; p < NB_PASSES; p++) {
+    for (int k = 0; k < NB_SYMBOLS; k++) {
+      acc += loop_hash(texts[k], length);
+    }
+  }
+  t_loop = seconds(start);
+  start = clock();
+  for (int p = 0; p < NB_PASSES; p++) {
+    for (int k = 0; k < NB_SYMBOLS; k++) {
+      acc += sstring_hash(symbols[k]);
+    }
+  }
+  print_line("hash", length, t_loop, seconds(start));
+
+  start = clock();
+  for (int p = 0; p < NB_PASSES; p++) {
+    for (int k = 0; k < NB_SYMBOLS; k++) {
+      acc += loop_is_token(texts[k], length);
+    }
+  }
+  t_loop = seconds(start);
+  start = clock();
+  for (int p = 0; p < NB_PASSES; p++) {
+    for (int k = 0; k < NB_SYMBOLS; k++) {
+      acc += sstring_is_token(symbols[k]);
+    }
+  }
+  print_line("token", length, t_loop, seconds(start));
+
+  sink = acc;
+  for (int k = 0; k < NB_SYMBOLS; k++) {
+    free(texts[k]);
+    free(texts_copy[k]);
+    sstring_destroy(&symbols[k]);
+    sstring_destroy(&symbols_copy[k]);
+  }
+}
+
+int main(void) {
+  srand(0);
+  printf("%-8s %6s %12s %12s %8s\n", "# kernel", "length", "loop_ns",
+         "sstring_ns", "speedup");
+  for (int length = 8; length <= 256; length *= 2) {
+    bench_length(length);
+  }
+  return 0;
+}
@@ -0,0 +1,184 @@
+#include <assert.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "term.h"
+#include "term_io.h"
+
+#undef NDEBUG // FORCE ASSERT ACTIVATION
+
+/*!
+ * \file
+ * \brief Benchmark of the term operations built on \c term_traverse against
+ * recursive versions written with the public functions.
+ *
+ * For each shape of term, prints the time (in ms) of the recursive and of the
+ * library version of copy, compare, contains_symbol and compact print.
+ * Recursive versions are not run on terms deeper than \c RECURSIVE_LIMIT
+ * (they would overflow the C stack).
+ */
+
+/*! Deepest term given to recursive versions. */
+#define RECURSIVE_LIMIT 10000
+
+static term copy_rec(term t) {
+  term new = term_create(term_get_symbol(t));
+  for (int i = 0; i < term_get_arity(t); i++) {
+    term_add_argument_last(new, copy_rec(term_get_argument(t, i)));
+  }
+  return new;
+}
+
+static int compare_rec(term t1, term t2) {
+  int compare = sstring_compare(term_get_symbol(t1), term_get_symbol(t2));
+  if (compare == 0) {
+    compare = term_get_arity(t1) - term_get_arity(t2);
+    for (int i = 0; i < term_get_arity(t1) && compare == 0; i++) {
+      compare = compare_rec(term_get_argument(t1, i), term_get_argument(t2, i));
+    }
+  }
+  return compare;
+}
+
+static bool contains_rec(term t, sstring symbol) {
+  if (sstring_compare(term_get_symbol(t), symbol) == 0) {
+    return true;
+  }
+  for (int i = 0; i < term_get_arity(t); i++) {
+    if (contains_rec(term_get_argument(t, i), symbol)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void print_rec(term t, FILE *out) {
+  sstring_print(term_get_symbol(t), out);
+  if (term_get_arity(t)) {
+    fprintf(out, " ( ");
+    for (int i = 0; i < term_get_arity(t); i++) {
+      print_rec(term_get_argument(t, i), out);
+      fprintf(out, " ");
+    }
+    fprintf(out, ")");
+  }
+}
+
+/*!
+ * Complete binary tree of \c g nodes with leaves \c a .
+ */
+static term build_binary(int height, sstring g, sstring a) {
+  if (height == 0) {
+    return term_create(a);
+  }
+  term t = term_create(g);
+  term_add_argument_last(t, build_binary(height - 1, g, a));
+  term_add_argument_last(t, build_binary(height - 1, g, a));
+  return t;
+}
+
+/*!
+ * \c f ( f ( … a … ) ) with depth \c f .
+ */
+static term build_chain(int depth, sstring f, sstring a) {
+  term t = term_create(a);
+  for (int i = 0; i < depth; i++) {
+    term u = term_create(f);
+    term_add_argument_last(u, t);
+    t = u;
+  }
+  return t;
+}
+
+static double ms(clock_t start) {
+  return (double)(clock() - start) * 1000 / CLOCKS_PER_SEC;
+}
+
+static void print_line(char const *const op, char const *const shape,
+                       int depth, double t_rec, double t_lib) {
+  printf("%-10s %-8s %8d", op, shape, depth);
+  if (t_rec < 0) {
+    printf(" %12s", "-");
+  } else {
+    printf(" %12.2f", t_rec);
+  }
+  printf(" %12.2f\n", t_lib);
+}
+
+static void bench_term(char const *const shape, int depth, term t,
+                       sstring missing) {
+  bool const rec = depth <= RECURSIVE_LIMIT;
+  FILE *out = tmpfile();
+  assert(out != NULL);
+  clock_t start;
+  double t_rec = -1;
+
+  term copy = NULL;
+  if (rec) {
+    start = clock();
+    copy = copy_rec(t);
+    t_rec = ms(start);
+    term_destroy(&copy);
+  }
+  start = clock();
+  copy = term_copy(t);
+  print_line("copy", shape, depth, t_rec, ms(start));
+
+  if (rec) {
+    start = clock();
+    int c = compare_rec(t, copy);
+    t_rec = ms(start);
+    assert(c == 0);
+  }
+  start = clock();
+  int c = term_compare(t, copy);
+  print_line("compare", shape, depth, t_rec, ms(start));
+  assert(c == 0);
+
+  if (rec) {
+    start = clock();
+    bool found = contains_rec(t, missing);
+    t_rec = ms(start);
+    assert(!found);
+  }
+  start = clock();
+  bool found = term_contains_symbol(t, missing);
+  print_line("contains", shape, depth, t_rec, ms(start));
+  assert(!found);
+
+  if (rec) {
+    start = clock();
+    print_rec(t, out);
+    t_rec = ms(start);
+  }
+  start = clock();
+  term_print_compact(t, out);
+  print_line("print", shape, depth, t_rec, ms(start));
+
+  start = clock();
+  term_destroy(&copy);
+  print_line("destroy", shape, depth, -1, ms(start));
+  fclose(out);
+}
+
+int main(void) {
+  sstring f = sstring_create_string("f");
+  sstring a = sstring_create_string("a");
+  sstring missing = sstring_create_string("b");
+  printf("%-10s %-8s %8s %12s %12s\n", "# op", "shape", "depth",
+         "recursive_ms", "traverse_ms");
+  for (int height = 12; height <= 20; height += 4) {
+    term t = build_binary(height, f, a);
+    bench_term("binary", height, t, missing);
+    term_destroy(&t);
+  }
+  for (int depth = 100; depth <= 1000000; depth *= 100) {
+    term t = build_chain(depth, f, a);
+    bench_term("chain", depth, t, missing);
+    term_destroy(&t);
+  }
+  sstring_destroy(&f);
+  sstring_destroy(&a);
+  sstring_destroy(&missing);
+  return 0;
+}
@@ -0,0 +1,356 @@
+#include <assert.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bignum.h"
+
+#undef NDEBUG // FORCE ASSERT ACTIVATION
+
+/*! Base of the limbs (a limb holds 9 decimal digits). */
+#define BIGNUM_BASE 1000000000u
+
+/*! Number of decimal digits in a limb. */
+#define BIGNUM_BASE_DIGITS 9
+
+/*! Used to test the validity in asserts */
+#define ASSERT_BIGNUM_OK(b)                                                    \
+  assert(NULL != b);                                                           \
+  assert((0 == b->length) == (NULL == b->limbs));                              \
+  assert(0 == b->length || 0 != b->limbs[b->length - 1]);                      \
+  assert(0 != b->length || !b->negative)
+
+/*!
+ * Structure to store a bignum: sign and magnitude.
+ * 0 is encoded by 0 \c length, \c NULL \c limbs and \c negative false.
+ * \param negative true if the number is strictly negative
+ * \param length number of limbs, the most significant one is not 0
+ * \param limbs magnitude, least significant limb first
+ */
+typedef struct bignum_struct {
+  bool negative;
+  int length;
+  uint32_t *limbs;
+} bignum_struct;
+
+/*!
+ * Allocate a \c bignum with room for a magnitude.
+ * \param length number of limbs (set to 0)
+ * \return new bignum, to be normalized once filled
+ */
+static bignum bignum_allocate(int length) {
+  bignum b = malloc(sizeof(bignum_struct));
+  assert(NULL != b);
+  b->negative = false;
+  b->length = length;
+  b->limbs = NULL;
+  if (length > 0) {
+    b->limbs = calloc(length, sizeof(uint32_t));
+    assert(NULL != b->limbs);
+  }
+  return b;
+}
+
+/*!
+ * Remove most significant 0 limbs.
+ * \param b bignum to normalize
+ * \return b
+ */
+static bignum bignum_normalize(bignum b) {
+  while (b->length > 0 && b->limbs[b->length - 1] == 0) {
+    b->length--;
+  }
+  if (b->length == 0) {
+    free(b->limbs);
+    b->limbs = NULL;
+    b->negative = false;
+  }
+  ASSERT_BIGNUM_OK(b);
+  return b;
+}
+
+/*!
+ * Compare two magnitudes (without most significant 0 limbs).
+ * \return -1, 0 or 1
+ */
+static int magnitude_compare(uint32_t const *a, int na, uint32_t const *b,
+                             int nb) {
+  if (na != nb) {
+    return na < nb ? -1 : 1;
+  }
+  for (int i = na - 1; i >= 0; i--) {
+    if (a[i] != b[i]) {
+      return a[i] < b[i] ? -1 : 1;
+    }
+  }
+  return 0;
+}
+
+/*!
+ * Return |b1| + |b2| (positive).
+ */
+static bignum magnitude_add(bignum b1, bignum b2) {
+  int n = (b1->length > b2->length ? b1->length : b2->length) + 1;
+  bignum res = bignum_allocate(n);
+  uint32_t carry = 0;
+  for (int i = 0; i < n; i++) {
+    uint32_t s = carry;
+    if (i < b1->length) {
+      s += b1->limbs[i];
+    }
+    if (i < b2->length) {
+      s += b2->limbs[i];
+    }
+    carry = s >= BIGNUM_BASE;
+    res->limbs[i] = carry ? s - BIGNUM_BASE : s;
+  }
+  return bignum_normalize(res);
+}
+
+/*!
+ * Subtract a magnitude in place: a -= b.
+ * \pre a ≥ b
+ * \return length of the result (without most significant 0 limbs)
+ */
+static int magnitude_subtract_in_place(uint32_t *a, int na, uint32_t const *b,
+                                       int nb) {
+  uint32_t borrow = 0;
+  for (int i = 0; i < na; i++) {
+    uint32_t sub = borrow + (i < nb ? b[i] : 0);
+    if (a[i] >= sub) {
+      a[i] -= sub;
+      borrow = 0;
+    } else {
+      a[i] = a[i] + BIGNUM_BASE - sub;
+      borrow = 1;
+    }
+  }
+  assert(borrow == 0);
+  while (na > 0 && a[na - 1] == 0) {
+    na--;
+  }
+  return na;
+}
+
+/*!
+ * Return |b1| - |b2| (positive).
+ * \pre |b1| ≥ |b2|
+ */
+static bignum magnitude_subtract(bignum b1, bignum b2) {
+  bignum res = bignum_allocate(b1->length);
+  memcpy(res->limbs, b1->limbs, b1->length * sizeof(uint32_t));
+  res->length = magnitude_subtract_in_place(res->limbs, res->length, b2->limbs,
+                                            b2->length);
+  return bignum_normalize(res);
+}
+
+/*!
+ * Multiply a magnitude by a limb.
+ * \param res where to put the product (room for nb + 1 limbs)
+ * \return length of the result (without most significant 0 limbs)
+ */
+static int magnitude_multiply_limb(uint32_t const *b, int nb, uint32_t q,
+                                   uint32_t *res) {
+  uint64_t carry = 0;
+  for (int i = 0; i < nb; i++) {
+    uint64_t p = (uint64_t)b[i] * q + carry;
+    res[i] = p % BIGNUM_BASE;
+    carry = p / BIGNUM_BASE;
+  }
+  res[nb] = carry;
+  int n = nb + 1;
+  while (n > 0 && res[n - 1] == 0) {
+    n--;
+  }
+  return n;
+}
+
+bignum bignum_create_int64(int64_t n) {
+  // magnitude computed without overflow for INT64_MIN
+  uint64_t m = n < 0 ? (uint64_t)(-(n + 1)) + 1 : (uint64_t)n;
+  bignum b = bignum_allocate(3);
+  for (int i = 0; i < 3; i++) {
+    b->limbs[i] = m % BIGNUM_BASE;
+    m /= BIGNUM_BASE;
+  }
+  b->negative = n < 0;
+  return bignum_normalize(b);
+}
+
+bignum bignum_create_sstring(sstring ss) {
+  assert(NULL != ss);
+  int length = sstring_get_length(ss);
+  assert(length > 0);
+  bignum b = bignum_allocate((length + BIGNUM_BASE_DIGITS - 1) /
+                             BIGNUM_BASE_DIGITS);
+  for (int i = 0; i < length; i++) {
+    char c = sstring_get_char(ss, i);
+    assert('0' <= c && c <= '9');
+    // digit i from the right is in limb i / BIGNUM_BASE_DIGITS
+    int pos = length - 1 - i;
+    uint32_t weight = 1;
+    for (int k = 0; k < pos % BIGNUM_BASE_DIGITS; k++) {
+      weight *= 10;
+    }
+    b->limbs[pos / BIGNUM_BASE_DIGITS] += (c - '0') * weight;
+  }
+  return bignum_normalize(b);
+}
+
+void bignum_destroy(bignum *b) {
+  assert(NULL != b);
+  if (NULL != *b) {
+    free((*b)->limbs);
+    free(*b);
+    *b = NULL;
+  }
+}
+
+bignum bignum_copy(bignum b) {
+  ASSERT_BIGNUM_OK(b);
+  bignum res = bignum_allocate(b->length);
+  if (b->length > 0) {
+    memcpy(res->limbs, b->limbs, b->length * sizeof(uint32_t));
+  }
+  res->negative = b->negative;
+  return res;
+}
+
+bignum bignum_add(bignum b1, bignum b2) {
+  ASSERT_BIGNUM_OK(b1);
+  ASSERT_BIGNUM_OK(b2);
+  bignum res;
+  if (b1->negative == b2->negative) {
+    res = magnitude_add(b1, b2);
+    res->negative = b1->negative;
+  } else if (magnitude_compare(b1->limbs, b1->length, b2->limbs, b2->length) >=
+             0) {
+    res = magnitude_subtract(b1, b2);
+    res->negative = b1->negative;
+  } else {
+    res = magnitude_subtract(b2, b1);
+    res->negative = b2->negative;
+  }
+  return bignum_normalize(res);
+}
+
+bignum bignum_subtract(bignum b1, bignum b2) {
+  ASSERT_BIGNUM_OK(b2);
+  bignum_struct opposite = *b2;
+  opposite.negative = b2->length > 0 && !b2->negative;
+  return bignum_add(b1, &opposite);
+}
+
+bignum bignum_multiply(bignum b1, bignum b2) {
+  ASSERT_BIGNUM_OK(b1);
+  ASSERT_BIGNUM_OK(b2);
+  bignum res = bignum_allocate(b1->length + b2->length);
+  for (int i = 0; i < b1->length; i++) {
+    uint64_t carry = 0;
+    for (int j = 0; j < b2->length; j++) {
+      uint64_t p =
+          res->limbs[i + j] + (uint64_t)b1->limbs[i] * b2->limbs[j] + carry;
+      res->limbs[i + j] = p % BIGNUM_BASE;
+      carry = p / BIGNUM_BASE;
+    }
+    res->limbs[i + b2->length] = carry;
+  }
+  res->negative = b1->negative != b2->negative;
+  return bignum_normalize(res);
+}
+
+bignum bignum_divide(bignum b1, bignum b2) {
+  ASSERT_BIGNUM_OK(b1);
+  ASSERT_BIGNUM_OK(b2);
+  assert(!bignum_is_zero(b2));
+  bignum res = bignum_allocate(b1->length);
+  // remainder is always lower than b2 * BASE
+  uint32_t *rem = calloc(b2->length + 2, sizeof(uint32_t));
+  uint32_t *tmp = calloc(b2->length + 2, sizeof(uint32_t));
+  assert(NULL != rem && NULL != tmp);
+  int nr = 0;
+  for (int i = b1->length - 1; i >= 0; i--) {
+    // rem = rem * BASE + limb i
+    memmove(rem + 1, rem, nr * sizeof(uint32_t));
+    rem[0] = b1->limbs[i];
+    nr++;
+    while (nr > 0 && rem[nr - 1] == 0) {
+      nr--;
+    }
+    // largest q such that q * |b2| ≤ rem
+    uint32_t lo = 0, hi = BIGNUM_BASE - 1;
+    while (lo < hi) {
+      uint32_t mid = lo + (hi - lo + 1) / 2;
+      int nt = magnitude_multiply_limb(b2->limbs, b2->length, mid, tmp);
+      if (magnitude_compare(tmp, nt, rem, nr) <= 0) {
+        lo = mid;
+      } else {
+        hi = mid - 1;
+      }
+    }
+    if (lo > 0) {
+      int nt = magnitude_multiply_limb(b2->limbs, b2->length, lo, tmp);
+      nr = magnitude_subtract_in_place(rem, nr, tmp, nt);
+    }
+    res->limbs[i] = lo;
+  }
+  free(rem);
+  free(tmp);
+  res->negative = b1->negative != b2->negative;
+  return bignum_normalize(res);
+}
+
+int bignum_compare(bignum b1, bignum b2) {
+  ASSERT_BIGNUM_OK(b1);
+  ASSERT_BIGNUM_OK(b2);
+  if (b1->negative != b2->negative) {
+    return b1->negative ? -1 : 1;
+  }
+  int cmp = magnitude_compare(b1->limbs, b1->length, b2->limbs, b2->length);
+  return b1->negative ? -cmp : cmp;
+}
+
+bool bignum_is_zero(bignum b) {
+  ASSERT_BIGNUM_OK(b);
+  return 0 == b->length;
+}
+
+bool bignum_is_int64(bignum b, int64_t *n_pt) {
+  ASSERT_BIGNUM_OK(b);
+  assert(NULL != n_pt);
+  uint64_t m = 0;
+  for (int i = b->length - 1; i >= 0; i--) {
+    if (m > (UINT64_MAX - b->limbs[i]) / BIGNUM_BASE) {
+      return false;
+    }
+    m = m * BIGNUM_BASE + b->limbs[i];
+  }
+  if (b->negative) {
+    if (m > (uint64_t)INT64_MAX + 1) {
+      return false;
+    }
+    *n_pt = m == (uint64_t)INT64_MAX + 1 ? INT64_MIN : -(int64_t)m;
+  } else {
+    if (m > (uint64_t)INT64_MAX) {
+      return false;
+    }
+    *n_pt = (int64_t)m;
+  }
+  return true;
+}
+
+void bignum_print(bignum b, FILE *f) {
+  ASSERT_BIGNUM_OK(b);
+  assert(NULL != f);
+  if (bignum_is_zero(b)) {
+    fputc('0', f);
+    return;
+  }
+  if (b->negative) {
+    fputc('-', f);
+  }
+  fprintf(f, "%" PRIu32, b->limbs[b->length - 1]);
+  for (int i = b->length - 2; i >= 0; i--) {
+    fprintf(f, "%09" PRIu32, b->limbs[i]);
+  }
+}
@@ -0,0 +1,143 @@
+#ifndef __BIGNUM_H
+#define __BIGNUM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "sstring.h"
+
+/*!
+ * \file
+ * \brief This module provides arbitrary precision integers.
+ *
+ * A \c bignum is never modified once created: every operation returns a new
+ * \c bignum that has to be destroyed.
+ *
+ * Division is the integer division of C: the quotient is truncated toward 0.
+ *
+ * assert is enforced.
+ */
+
+/*! \c bignum is a pointer to a hidden structure. */
+typedef struct bignum_struct *bignum;
+
+/*!
+ * Generate a \c bignum from a machine integer.
+ *
+ * \param n value
+ * \return a bignum equal to n
+ */
+extern bignum bignum_create_int64(int64_t n);
+
+/*!
+ * Generate a \c bignum from its decimal writing.
+ *
+ * \param ss \c sstring made of decimal digits only
+ * \pre ss is a non empty sequence of digits (assert-ed)
+ * \return a bignum whose decimal writing is ss
+ */
+extern bignum bignum_create_sstring(sstring ss);
+
+/*!
+ * Destroy a \c bignum and release related resources.
+ *
+ * \param b (location of the) bignum to destroy
+ * \pre b is not NULL (assert-ed)
+ */
+extern void bignum_destroy(bignum *b);
+
+/*!
+ * Provide a copy of a \c bignum.
+ *
+ * \param b \c bignum to copy
+ * \pre b is not NULL (assert-ed)
+ * \return an independant copy of b
+ */
+extern bignum bignum_copy(bignum b);
+
+/*!
+ * Return b1 + b2.
+ *
+ * \param b1,b2 operands
+ * \pre b1 and b2 are not NULL (assert-ed)
+ * \return new \c bignum
+ */
+extern bignum bignum_add(bignum b1, bignum b2);
+
+/*!
+ * Return b1 - b2.
+ *
+ * \param b1,b2 operands
+ * \pre b1 and b2 are not NULL (assert-ed)
+ * \return new \c bignum
+ */
+extern bignum bignum_subtract(bignum b1, bignum b2);
+
+/*!
+ * Return b1 * b2.
+ *
+ * \param b1,b2 operands
+ * \pre b1 and b2 are not NULL (assert-ed)
+ * \return new \c bignum
+ */
+extern bignum bignum_multiply(bignum b1, bignum b2);
+
+/*!
+ * Return b1 / b2, truncated toward 0.
+ *
+ * \param b1,b2 operands
+ * \pre b1 and b2 are not NULL (assert-ed)
+ * \pre b2 is not 0 (assert-ed)
+ * \return new \c bignum
+ */
+extern bignum bignum_divide(bignum b1, bignum b2);
+
+/*!
+ * Indicate how two \c bignum are ordered.
+ *
+ * This function has no side effect and can be safely used in asserts.
+ *
+ * \param b1,b2 \c bignum to compare
+ * \pre b1 and b2 are not NULL (assert-ed)
+ * \return
+ * \li 0 if b1 == b2
+ * \li -1 if b1 < b2
+ * \li 1 otherwise
+ */
+extern int bignum_compare(bignum b1, bignum b2);
+
+/*!
+ * Indicate whether a \c bignum is 0.
+ *
+ * This function has no side effect and can be safely used in asserts.
+ *
+ * \param b \c bignum to test
+ * \pre b is not NULL (assert-ed)
+ * \return true iff b is 0
+ */
+extern bool bignum_is_zero(bignum b);
+
+/*!
+ * Test whether a \c bignum fits in a machine integer.
+ * If true, then the value is stored in *n_pt
+ *
+ * This function has no side effect and can be safely used in asserts.
+ *
+ * \param b \c bignum to query
+ * \param n_pt where to put the value
+ * \pre b and n_pt are not NULL (assert-ed)
+ * \return true if b fits in an \c int64_t
+ */
+extern bool bignum_is_int64(bignum b, int64_t *n_pt);
+
+/*!
+ * Print a \c bignum in decimal to a stream.
+ *
+ * \param b \c bignum to print
+ * \param f stream to print to
+ * \pre b and f are not NULL (assert-ed)
+ */
+extern void bignum_print(bignum b, FILE *f);
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef __CHECK_H
+#define __CHECK_H
+
+#include <assert.h>
+
+/*!
+ * \file
+ * \brief Switch between the checked build (default) and the release build.
+ *
+ * \c assert is used for cheap preconditions (non \c NULL pointers, bounds…)
+ * and stays active in both builds.
+ *
+ * \c CHECK is used for validations that cost as much as the operation they
+ * guard (scanning a whole term or symbol, allocating in a loop…). The input
+ * is validated once, upfront, where it enters a module. \c CHECK is an
+ * \c assert in the checked build and compiles out when \c RELEASE is defined
+ * (\c make \c release builds with \c -O2 \c -DRELEASE into \c Release/ ).
+ */
+
+#ifdef RELEASE
+#define CHECK(e) ((void)0)
+#else
+#define CHECK(e) assert(e)
+#endif
+
+#endif
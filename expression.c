@@ -1,166 +1,768 @@
 #include <assert.h>
 #include <ctype.h>
+#include <limits.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
+#include "check.h"
 #include "expression.h"
 
 #undef NDEBUG // FORCE ASSERT ACTIVATION
 
-// valid symbols
-static char const *const symbol_plus = "+";
-static char const *const symbol_minus = "-";
-static char const *const symbol_product = "*";
-static char const *const symbol_divided = "/";
-static char const *const symbol_and = "&&";
-static char const *const symbol_or = "||";
-static char const *const symbol_not = "!";
-static char const *const symbol_bool_T = "true";
-static char const *const symbol_bool_F = "false";
+/*!
+ * Symbols used by the evaluation, interned once per context (see
+ * \c term_symbol_intern ) so that recognizing one is a pointer comparison.
+ */
+struct expression_context_struct {
+  sstring plus;
+  sstring minus;
+  sstring product;
+  sstring divided;
+  sstring and;
+  sstring or ;
+  sstring not;
+  sstring T;
+  sstring F;
+};
+
+/*!
+ * Interned copy of a symbol.
+ * \param text symbol.
+ * \return the interned symbol (not to be destroyed).
+ */
+static sstring symbol_intern(char const *text) {
+  sstring s = sstring_create_string(text);
+  sstring res = term_symbol_intern(s);
+  sstring_destroy(&s);
+  return res;
+}
 
-static int const nb_symbols = 7;
-static char const *const symbols[] = {"+", "-", "*", "/", "&&", "||", "!"};
+expression_context expression_context_create(void) {
+  expression_context ctx = malloc(sizeof(struct expression_context_struct));
+  assert(ctx != NULL);
+  ctx->plus = symbol_intern("+");
+  ctx->minus = symbol_intern("-");
+  ctx->product = symbol_intern("*");
+  ctx->divided = symbol_intern("/");
+  ctx->and = symbol_intern("&&");
+  ctx->or = symbol_intern("||");
+  ctx->not = symbol_intern("!");
+  ctx->T = symbol_intern("true");
+  ctx->F = symbol_intern("false");
+  return ctx;
+}
+
+void expression_context_destroy(expression_context *ctx) {
+  assert(ctx != NULL);
+  if (*ctx != NULL) {
+    free(*ctx);
+    *ctx = NULL;
+  }
+}
+
+/* Check if symbol is an operator
+ * \return true if symbol is an operator
+ */
+static bool symbol_is_operator(expression_context ctx, term t) {
+  return term_has_symbol(t, ctx->plus) || term_has_symbol(t, ctx->minus) ||
+         term_has_symbol(t, ctx->product) || term_has_symbol(t, ctx->divided) ||
+         term_has_symbol(t, ctx->and) || term_has_symbol(t, ctx->or) ||
+         term_has_symbol(t, ctx->not);
+}
 
 /* Check if symbol is valid
  * \return true if symbol is valid
  */
-static bool symbol_is_valid(term t) {
-  bool res = term_get_arity(t) > 0;
+static bool symbol_is_valid(expression_context ctx, term t) {
+  return symbol_is_operator(ctx, t) || term_get_arity(t) > 0;
+}
 
-  for (int i = 0; i < nb_symbols; i++) {
-    sstring ss = sstring_create_string(symbols[i]);
-    res = res || (sstring_compare(term_get_symbol(t), ss) == 0);
-    sstring_destroy(&ss);
+/* Check if symbol is a natural number in decimal notation (of any size)
+ * \return true if symbol is a number
+ */
+static bool symbol_is_number(sstring s) {
+  if (sstring_is_empty(s)) {
+    return false;
   }
-
-  return res;
+  for (int i = 0; i < sstring_get_length(s); i++) {
+    if (!isdigit((unsigned char)sstring_get_char(s, i))) {
+      return false;
+    }
+  }
+  return true;
 }
 
 /* Check if symbol is a boolean
  * \return true if symbol is a boolean
  */
-static bool symbol_is_boolean(sstring s) {
-  sstring T = sstring_create_string(symbol_bool_T);
-  sstring F = sstring_create_string(symbol_bool_F);
-
-  bool res = (sstring_compare(s, T) == 0) || (sstring_compare(s, F) == 0);
-
-  sstring_destroy(&T);
-  sstring_destroy(&F);
-
-  return res;
+static bool term_is_boolean(expression_context ctx, term t) {
+  return term_has_symbol(t, ctx->T) || term_has_symbol(t, ctx->F);
 }
 
-bool term_is_valid_expression(term t) {
+/*!
+ * Check if the term is a valid expression.
+ * \param ctx evaluation context.
+ * \param t term to check.
+ * \param with_variables whether variables are accepted as values.
+ * \return true if term is valid.
+ */
+static bool expression_is_valid(expression_context ctx, term t,
+                                bool with_variables) {
   assert(t != NULL);
 
   sstring s = term_get_symbol(t);
   bool res = false;
-  int i = 0;
 
-  if (symbol_is_valid(t) || sstring_is_integer(s, &i) || symbol_is_boolean(s)) {
+  if (symbol_is_valid(ctx, t) || term_get_kind(t) == TERM_KIND_INTEGER ||
+      symbol_is_number(s) || term_is_boolean(ctx, t) ||
+      (with_variables && term_is_variable(t))) {
     res = true;
-    term_argument_traversal tat = term_argument_traversal_create(t);
-    while (term_argument_traversal_has_next(tat)) {
-      if (!term_is_valid_expression(term_argument_traversal_get_next(tat))) {
+    term arg;
+    term_for_each_argument(arg, t) {
+      if (!expression_is_valid(ctx, arg, with_variables)) {
         res = false;
+        break;
       }
     }
-    term_argument_traversal_destroy(&tat);
   }
 
   return res;
 }
 
-// SString symbols
-sstring plus;
-sstring minus;
-sstring product;
-sstring divided;
-sstring and;
-sstring or ;
-sstring not;
-sstring T;
+bool expression_is_valid_with_context(expression_context ctx, term t) {
+  assert(ctx != NULL);
+  return expression_is_valid(ctx, t, false);
+}
 
-/* Return valuate term */
-int expression_valuate_inner(term t) {
-  assert(t != NULL);
-  assert(term_is_valid_expression(t));
+bool term_is_valid_expression(term t) {
+  expression_context ctx = expression_context_create();
+  bool res = expression_is_valid(ctx, t, false);
+  expression_context_destroy(&ctx);
+  return res;
+}
 
-  sstring s = term_get_symbol(t);
-  int res = 0;
-  if (sstring_is_integer(s, &res))
-    return res;
+/*!
+ * Operation codes of the expression stack machine.
+ * Operators take the number of arguments as operand.
+ */
+typedef enum {
+  /*! push the operand */
+  OP_PUSH,
+  /*! push constant number operand (too big for the operand) */
+  OP_PUSH_BIG,
+  /*! push the value of variable number operand */
+  OP_LOAD,
+  OP_ADD,
+  OP_SUB,
+  OP_MUL,
+  OP_DIV,
+  OP_AND,
+  OP_OR,
+  OP_NOT,
+  /*! pop operand values and push 0 (unknown symbol with arguments) */
+  OP_DROP
+} expression_opcode;
+
+/*!
+ * One instruction of the stack machine.
+ */
+typedef struct expression_instruction_struct {
+  /*! operation */
+  expression_opcode opcode;
+  /*! value to push, number of arguments, of variable or of constant */
+  int64_t operand;
+} expression_instruction;
 
-  if (symbol_is_boolean(s)) {
-    if (sstring_compare(s, T) == 0) {
-      return 1;
+/*!
+ * Compiled expression (postfix code).
+ */
+struct expression_code_struct {
+  /*! instructions */
+  expression_instruction *instructions;
+  /*! number of instructions */
+  int length;
+  /*! allocated number of instructions */
+  int capacity;
+  /*! maximal stack height during execution */
+  int stack_size;
+  /*! stack height after the last instruction (used while compiling) */
+  int stack_height;
+  /*! variables, in order of first appearance */
+  sstring *variables;
+  /*! number of variables */
+  int nb_variables;
+  /*! constants too big for an operand */
+  bignum *constants;
+  /*! number of big constants */
+  int nb_constants;
+};
+
+/*! Initial number of instructions allocated for a code. */
+#define EXPRESSION_CODE_LENGTH_BASE 16
+
+/*! Stack height under which running a code does not allocate. */
+#define EXPRESSION_STACK_LOCAL 256
+
+/*!
+ * Append an instruction to a code.
+ * \param code code being compiled.
+ * \param opcode operation.
+ * \param operand operand.
+ * \param pop number of stack values consumed.
+ * \param push number of stack values produced.
+ */
+static void expression_code_emit(expression_code code, expression_opcode opcode,
+                                 int64_t operand, int pop, int push) {
+  if (code->length == code->capacity) {
+    code->capacity *= 2;
+    code->instructions = realloc(
+        code->instructions, code->capacity * sizeof(expression_instruction));
+    assert(code->instructions != NULL);
+  }
+  code->instructions[code->length].opcode = opcode;
+  code->instructions[code->length].operand = operand;
+  code->length++;
+  code->stack_height += push - pop;
+  if (code->stack_height > code->stack_size) {
+    code->stack_size = code->stack_height;
+  }
+}
+
+/*!
+ * Recursive compiling function: arguments first, then the operator.
+ * \param ctx evaluation context.
+ * \param code code being compiled.
+ * \param t (sub-)expression to compile.
+ */
+static void expression_compile_inner(expression_context ctx,
+                                     expression_code code, term t) {
+  sstring s = term_get_symbol(t);
+  int n = 0;
+  if (term_get_integer(t, &n)) {
+    expression_code_emit(code, OP_PUSH, n, 0, 1);
+    return;
+  }
+  if (symbol_is_number(s)) {
+    bignum b = bignum_create_sstring(s);
+    int64_t v;
+    if (bignum_is_int64(b, &v)) {
+      expression_code_emit(code, OP_PUSH, v, 0, 1);
+      bignum_destroy(&b);
     } else {
-      return 0;
+      code->constants =
+          realloc(code->constants, (code->nb_constants + 1) * sizeof(bignum));
+      assert(code->constants != NULL);
+      code->constants[code->nb_constants] = b;
+      expression_code_emit(code, OP_PUSH_BIG, code->nb_constants++, 0, 1);
+    }
+    return;
+  }
+  if (term_is_variable(t)) {
+    while (n < code->nb_variables && sstring_compare(code->variables[n], s)) {
+      n++;
+    }
+    if (n == code->nb_variables) {
+      code->variables = realloc(code->variables, (n + 1) * sizeof(sstring));
+      assert(code->variables != NULL);
+      code->variables[code->nb_variables++] = sstring_copy(s);
+    }
+    expression_code_emit(code, OP_LOAD, n, 0, 1);
+    return;
+  }
+  if (term_is_boolean(ctx, t)) {
+    expression_code_emit(code, OP_PUSH, term_has_symbol(t, ctx->T), 0, 1);
+    return;
+  }
+
+  int arity = term_get_arity(t);
+  term arg;
+  term_for_each_argument(arg, t) {
+    expression_compile_inner(ctx, code, arg);
+  }
+
+  expression_opcode opcode = OP_DROP;
+  if (term_has_symbol(t, ctx->plus)) {
+    opcode = OP_ADD;
+  } else if (term_has_symbol(t, ctx->minus)) {
+    opcode = OP_SUB;
+  } else if (term_has_symbol(t, ctx->product)) {
+    opcode = OP_MUL;
+  } else if (term_has_symbol(t, ctx->divided)) {
+    opcode = OP_DIV;
+  } else if (term_has_symbol(t, ctx->and)) {
+    opcode = OP_AND;
+  } else if (term_has_symbol(t, ctx->or)) {
+    opcode = OP_OR;
+  } else if (term_has_symbol(t, ctx->not)) {
+    opcode = OP_NOT;
+  }
+  expression_code_emit(code, opcode, arity, arity, 1);
+}
+
+expression_code expression_compile(expression_context ctx, term t) {
+  assert(ctx != NULL);
+  assert(t != NULL);
+  CHECK(expression_is_valid(ctx, t, true));
+  expression_code code = malloc(sizeof(struct expression_code_struct));
+  assert(code != NULL);
+  code->variables = NULL;
+  code->nb_variables = 0;
+  code->constants = NULL;
+  code->nb_constants = 0;
+  code->length = 0;
+  code->capacity = EXPRESSION_CODE_LENGTH_BASE;
+  code->stack_size = code->stack_height = 0;
+  code->instructions =
+      malloc(code->capacity * sizeof(expression_instruction));
+  assert(code->instructions != NULL);
+  expression_compile_inner(ctx, code, t);
+  assert(code->stack_height == 1);
+  return code;
+}
+
+void expression_code_destroy(expression_code *code) {
+  assert(code != NULL);
+  if (*code != NULL) {
+    for (int i = 0; i < (*code)->nb_variables; i++) {
+      sstring_destroy(&(*code)->variables[i]);
+    }
+    free((*code)->variables);
+    for (int i = 0; i < (*code)->nb_constants; i++) {
+      bignum_destroy(&(*code)->constants[i]);
+    }
+    free((*code)->constants);
+    free((*code)->instructions);
+    free(*code);
+    *code = NULL;
+  }
+}
+
+int expression_code_get_nb_variables(expression_code code) {
+  assert(code != NULL);
+  return code->nb_variables;
+}
+
+sstring expression_code_get_variable(expression_code code, int i) {
+  assert(code != NULL);
+  assert(0 <= i && i < code->nb_variables);
+  return code->variables[i];
+}
+
+/*!
+ * Run a code on machine integers, checking every operation for overflow.
+ * \param code compiled expression without variable.
+ * \param res_pt where to put the value.
+ * \return false if some value does not fit in an \c int64_t .
+ */
+static bool expression_code_run_int64(expression_code code, int64_t *res_pt) {
+  int64_t local[EXPRESSION_STACK_LOCAL];
+  int64_t *stack = local;
+  if (code->stack_size > EXPRESSION_STACK_LOCAL) {
+    stack = malloc(code->stack_size * sizeof(int64_t));
+    assert(stack != NULL);
+  }
+  bool overflow = false;
+  int top = 0; // number of values on the stack
+  expression_instruction const *ins = code->instructions;
+  expression_instruction const *const end = ins + code->length;
+  for (; ins < end && !overflow; ins++) {
+    int n = (int)ins->operand;
+    int64_t res = 0;
+    int64_t *args = stack + top - n;
+    switch (ins->opcode) {
+    case OP_PUSH:
+      stack[top++] = ins->operand;
+      continue;
+    case OP_PUSH_BIG:
+      overflow = true;
+      continue;
+    case OP_LOAD:
+      assert(false);
+      continue;
+    case OP_ADD:
+      for (int i = 0; i < n; i++) {
+        overflow |= __builtin_add_overflow(res, args[i], &res);
+      }
+      break;
+    case OP_SUB:
+      for (int i = 0; i < n; i++) {
+        overflow |= __builtin_sub_overflow(res, args[i], &res);
+      }
+      break;
+    case OP_MUL:
+      res = 1;
+      for (int i = 0; i < n; i++) {
+        overflow |= __builtin_mul_overflow(res, args[i], &res);
+      }
+      break;
+    case OP_DIV:
+      if (n > 0) {
+        res = args[0];
+      }
+      for (int i = 1; i < n; i++) {
+        // a null divisor may come from an overflow, left to the exact run
+        if (args[i] == 0 || (res == INT64_MIN && args[i] == -1)) {
+          overflow = true;
+        } else {
+          res /= args[i];
+        }
+      }
+      break;
+    case OP_AND:
+      res = 1;
+      for (int i = 0; i < n; i++) {
+        res = res && args[i];
+      }
+      break;
+    case OP_OR:
+      for (int i = 0; i < n; i++) {
+        res = res || args[i];
+      }
+      break;
+    case OP_NOT:
+      res = n > 0 ? !args[0] : 1;
+      break;
+    case OP_DROP:
+      break;
+    }
+    top -= n;
+    stack[top++] = res;
+  }
+  assert(overflow || top == 1);
+  *res_pt = stack[0];
+  if (stack != local) {
+    free(stack);
+  }
+  return !overflow;
+}
+
+/*!
+ * Run a code on arbitrary precision integers.
+ * \param code compiled expression without variable.
+ * \return value of the expression, NULL on a division by zero.
+ */
+static bignum expression_code_run_bignum(expression_code code) {
+  bignum *stack = malloc((code->stack_size + 1) * sizeof(bignum));
+  assert(stack != NULL);
+  bignum zero = bignum_create_int64(0);
+  bool defined = true;
+  int top = 0; // number of values on the stack
+  for (int k = 0; k < code->length; k++) {
+    expression_instruction const *ins = &code->instructions[k];
+    int n = (int)ins->operand;
+    bignum *args = stack + top - n;
+    bignum res = NULL;
+    int truth = 0;
+    switch (ins->opcode) {
+    case OP_PUSH:
+      stack[top++] = bignum_create_int64(ins->operand);
+      continue;
+    case OP_PUSH_BIG:
+      stack[top++] = bignum_copy(code->constants[n]);
+      continue;
+    case OP_LOAD:
+      assert(false);
+      continue;
+    case OP_ADD:
+    case OP_SUB:
+      res = bignum_copy(zero);
+      for (int i = 0; i < n; i++) {
+        bignum tmp = ins->opcode == OP_ADD ? bignum_add(res, args[i])
+                                           : bignum_subtract(res, args[i]);
+        bignum_destroy(&res);
+        res = tmp;
+      }
+      break;
+    case OP_MUL:
+      res = bignum_create_int64(1);
+      for (int i = 0; i < n; i++) {
+        bignum tmp = bignum_multiply(res, args[i]);
+        bignum_destroy(&res);
+        res = tmp;
+      }
+      break;
+    case OP_DIV:
+      res = bignum_copy(n > 0 ? args[0] : zero);
+      for (int i = 1; i < n && defined; i++) {
+        if (bignum_is_zero(args[i])) {
+          defined = false; // the stack is still run to be released
+          break;
+        }
+        bignum tmp = bignum_divide(res, args[i]);
+        bignum_destroy(&res);
+        res = tmp;
+      }
+      break;
+    case OP_AND:
+      truth = 1;
+      for (int i = 0; i < n; i++) {
+        truth = truth && !bignum_is_zero(args[i]);
+      }
+      break;
+    case OP_OR:
+      for (int i = 0; i < n; i++) {
+        truth = truth || !bignum_is_zero(args[i]);
+      }
+      break;
+    case OP_NOT:
+      truth = n > 0 ? bignum_is_zero(args[0]) : 1;
+      break;
+    case OP_DROP:
+      break;
     }
+    if (res == NULL) {
+      res = bignum_create_int64(truth);
+    }
+    for (int i = 0; i < n; i++) {
+      bignum_destroy(&args[i]);
+    }
+    top -= n;
+    stack[top++] = res;
   }
+  assert(top == 1);
+  bignum res = stack[0];
+  if (!defined) {
+    bignum_destroy(&res);
+  }
+  bignum_destroy(&zero);
+  free(stack);
+  return res;
+}
+
+bignum expression_code_run_exact(expression_code code) {
+  assert(code != NULL);
+  assert(code->nb_variables == 0);
+  int64_t res;
+  if (expression_code_run_int64(code, &res)) {
+    return bignum_create_int64(res);
+  }
+  return expression_code_run_bignum(code);
+}
 
-  int arg_res[term_get_arity(t)];
-  for (int i = 0; i < term_get_arity(t); i++) {
-    arg_res[i] = expression_valuate_inner(term_get_argument(t, i));
+int expression_code_run(expression_code code) {
+  assert(code != NULL);
+  assert(code->nb_variables == 0);
+  int64_t res;
+  if (!expression_code_run_int64(code, &res)) {
+    // only to get a meaningful failure
+    bignum b = expression_code_run_bignum(code);
+    assert(b != NULL);
+    bool fits = bignum_is_int64(b, &res);
+    bignum_destroy(&b);
+    assert(fits);
   }
+  assert(INT_MIN <= res && res <= INT_MAX);
+  return (int)res;
+}
+
+/*! Number of rows evaluated at once by \c expression_code_run_batch . */
+#define EXPRESSION_BATCH_CHUNK 256
+
+/*!
+ * One column of a batch stack: a value for each row of the current chunk.
+ */
+typedef int64_t expression_column[EXPRESSION_BATCH_CHUNK];
 
-  if (sstring_compare(s, plus) == 0) {
-    for (int i = 0; i < term_get_arity(t); i++) {
-      res += arg_res[i];
+/*!
+ * Fill a column with a value.
+ * \param res column to fill.
+ * \param m number of rows.
+ * \param value value to put.
+ */
+static void batch_fill(int64_t *restrict res, int m, int64_t value) {
+  for (int j = 0; j < m; j++) {
+    res[j] = value;
+  }
+}
+
+/*!
+ * Run a whole chunk of rows through one code.
+ * Every instruction operates on full columns, so that inner loops are simple
+ * and can be vectorized by the compiler. Values are computed on 64 bits
+ * integers checked like in \c expression_code_run_int64 : a row that
+ * overflows or divides by zero is flagged and its computation goes on with
+ * meaningless (but defined) values.
+ * \param code compiled expression.
+ * \param stack stack of columns, at least \c code->stack_size high.
+ * \param columns variable values, column \c i for variable \c i .
+ * \param first first row of the chunk.
+ * \param m number of rows in the chunk.
+ * \param results where to put the values of the rows of the chunk.
+ * \param undefined where to flag the rows of the chunk without a value.
+ */
+static void expression_code_run_chunk(expression_code code,
+                                      expression_column *stack,
+                                      int const *const columns[], int first,
+                                      int m, int *results,
+                                      bool *restrict undefined) {
+  for (int j = 0; j < m; j++) {
+    undefined[j] = false;
+  }
+  int top = 0;
+  for (int k = 0; k < code->length; k++) {
+    int n = (int)code->instructions[k].operand;
+    expression_opcode opcode = code->instructions[k].opcode;
+    if (opcode == OP_PUSH) {
+      batch_fill(stack[top++], m, code->instructions[k].operand);
+      continue;
     }
-  } else if (sstring_compare(s, minus) == 0) {
-    for (int i = 0; i < term_get_arity(t); i++) {
-      res -= arg_res[i];
+    if (opcode == OP_PUSH_BIG) {
+      // does not fit in 64 bits: no row has a value that fits
+      batch_fill(stack[top++], m, 0);
+      for (int j = 0; j < m; j++) {
+        undefined[j] = true;
+      }
+      continue;
     }
-  } else if (sstring_compare(s, product) == 0) {
-    res = 1;
-    for (int i = 0; i < term_get_arity(t); i++) {
-      res *= arg_res[i];
+    if (opcode == OP_LOAD) {
+      int64_t *restrict res = stack[top++];
+      int const *restrict column = columns[n] + first;
+      for (int j = 0; j < m; j++) {
+        res[j] = column[j];
+      }
+      continue;
     }
-  } else if (sstring_compare(s, divided) == 0) {
-    res = arg_res[0];
-    for (int i = 1; i < term_get_arity(t); i++) {
-      res /= arg_res[i];
+    if (n == 0) {
+      // no argument: neutral value
+      bool one = opcode == OP_MUL || opcode == OP_AND || opcode == OP_NOT;
+      batch_fill(stack[top++], m, one ? 1 : 0);
+      continue;
     }
-  } else if (sstring_compare(s, and) == 0) {
-    res = 1;
-    for (int i = 0; i < term_get_arity(t); i++) {
-      res = res && arg_res[i];
+    int64_t *restrict res = stack[top - n];
+    switch (opcode) {
+    case OP_ADD:
+      for (int i = 1; i < n; i++) {
+        int64_t const *restrict arg = stack[top - n + i];
+        for (int j = 0; j < m; j++) {
+          undefined[j] |= __builtin_add_overflow(res[j], arg[j], &res[j]);
+        }
+      }
+      break;
+    case OP_SUB:
+      for (int j = 0; j < m; j++) {
+        undefined[j] |= __builtin_sub_overflow(0, res[j], &res[j]);
+      }
+      for (int i = 1; i < n; i++) {
+        int64_t const *restrict arg = stack[top - n + i];
+        for (int j = 0; j < m; j++) {
+          undefined[j] |= __builtin_sub_overflow(res[j], arg[j], &res[j]);
+        }
+      }
+      break;
+    case OP_MUL:
+      for (int i = 1; i < n; i++) {
+        int64_t const *restrict arg = stack[top - n + i];
+        for (int j = 0; j < m; j++) {
+          undefined[j] |= __builtin_mul_overflow(res[j], arg[j], &res[j]);
+        }
+      }
+      break;
+    case OP_DIV:
+      for (int i = 1; i < n; i++) {
+        int64_t const *restrict arg = stack[top - n + i];
+        for (int j = 0; j < m; j++) {
+          bool const invalid =
+              arg[j] == 0 || (res[j] == INT64_MIN && arg[j] == -1);
+          undefined[j] |= invalid;
+          res[j] /= invalid ? 1 : arg[j];
+        }
+      }
+      break;
+    case OP_AND:
+      for (int j = 0; j < m; j++) {
+        res[j] = res[j] != 0;
+      }
+      for (int i = 1; i < n; i++) {
+        int64_t const *restrict arg = stack[top - n + i];
+        for (int j = 0; j < m; j++) {
+          res[j] &= arg[j] != 0;
+        }
+      }
+      break;
+    case OP_OR:
+      for (int j = 0; j < m; j++) {
+        res[j] = res[j] != 0;
+      }
+      for (int i = 1; i < n; i++) {
+        int64_t const *restrict arg = stack[top - n + i];
+        for (int j = 0; j < m; j++) {
+          res[j] |= arg[j] != 0;
+        }
+      }
+      break;
+    case OP_NOT:
+      for (int j = 0; j < m; j++) {
+        res[j] = res[j] == 0;
+      }
+      break;
+    default: // OP_DROP
+      batch_fill(res, m, 0);
+      break;
+    }
+    top -= n - 1;
+  }
+  assert(top == 1);
+  for (int j = 0; j < m; j++) {
+    int64_t const value = stack[0][j];
+    undefined[j] |= value < INT_MIN || value > INT_MAX;
+    results[j] = undefined[j] ? 0 : (int)value;
+  }
+}
+
+int expression_code_run_batch(expression_code code,
+                              int const *const columns[], int nb_rows,
+                              int *results, bool *undefined) {
+  assert(code != NULL);
+  assert(code->nb_variables == 0 || columns != NULL);
+  assert(nb_rows >= 0);
+  assert(nb_rows == 0 || results != NULL);
+  expression_column *stack = malloc(code->stack_size * sizeof(expression_column));
+  assert(stack != NULL);
+  bool chunk_undefined[EXPRESSION_BATCH_CHUNK];
+  int nb_undefined = 0;
+  for (int first = 0; first < nb_rows; first += EXPRESSION_BATCH_CHUNK) {
+    int m = nb_rows - first;
+    if (m > EXPRESSION_BATCH_CHUNK) {
+      m = EXPRESSION_BATCH_CHUNK;
     }
-  } else if (sstring_compare(s, or) == 0) {
-    for (int i = 0; i < term_get_arity(t); i++) {
-      res = res || arg_res[i];
+    expression_code_run_chunk(code, stack, columns, first, m, results + first,
+                              chunk_undefined);
+    for (int j = 0; j < m; j++) {
+      nb_undefined += chunk_undefined[j];
+    }
+    if (undefined != NULL) {
+      memcpy(undefined + first, chunk_undefined, m * sizeof(bool));
     }
-  } else if (sstring_compare(s, not) == 0) {
-    res = !arg_res[0];
   }
+  free(stack);
+  return nb_undefined;
+}
 
+int expression_valuate_with_context(expression_context ctx, term t) {
+  expression_code code = expression_compile(ctx, t);
+  int res = expression_code_run(code);
+  expression_code_destroy(&code);
   return res;
 }
 
-int expression_valuate(term t) {
-  assert(t != NULL);
-  assert(term_is_valid_expression(t));
-
-  plus = sstring_create_string(symbol_plus);
-  minus = sstring_create_string(symbol_minus);
-  product = sstring_create_string(symbol_product);
-  divided = sstring_create_string(symbol_divided);
-  and = sstring_create_string(symbol_and);
-  or = sstring_create_string(symbol_or);
-  not = sstring_create_string(symbol_not);
-  T = sstring_create_string(symbol_bool_T);
-
-  int res = expression_valuate_inner(t);
-
-  sstring_destroy(&plus);
-  sstring_destroy(&minus);
-  sstring_destroy(&product);
-  sstring_destroy(&divided);
-  sstring_destroy(&and);
-  sstring_destroy(& or);
-  sstring_destroy(&not);
-  sstring_destroy(&T);
+bignum expression_valuate_exact_with_context(expression_context ctx, term t) {
+  expression_code code = expression_compile(ctx, t);
+  bignum res = expression_code_run_exact(code);
+  expression_code_destroy(&code);
+  return res;
+}
 
+bignum expression_valuate_exact(term t) {
+  expression_context ctx = expression_context_create();
+  bignum res = expression_valuate_exact_with_context(ctx, t);
+  expression_context_destroy(&ctx);
+  return res;
+}
+
+int expression_valuate(term t) {
+  expression_context ctx = expression_context_create();
+  int res = expression_valuate_with_context(ctx, t);
+  expression_context_destroy(&ctx);
   return res;
 }
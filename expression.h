@@ -3,6 +3,7 @@
 
 #include <stdio.h>
 
+#include "bignum.h"
 #include "term.h"
 #include "term_variable.h"
 
@@ -20,6 +21,9 @@
  *
  * The variable type is restricted to integers and boolean
  *
+ * Integers are evaluated exactly: computation is done on 64 bits integers,
+ * checked for overflow, and done again on \c bignum if any value is too big.
+ *
  * \c assert is enforced to test that all pre-conditions are valid.
  *
  * \author Nicolas HIOT
@@ -35,8 +39,146 @@
  */
 extern bool term_is_valid_expression(term t);
 
+/*!
+ * Evaluation context.
+ * It holds everything an evaluation needs, so that evaluations using different
+ * contexts can run concurrently.
+ * A context can be reused for many evaluations but not by two at once.
+ */
+typedef struct expression_context_struct *expression_context;
+
+/*!
+ * Create an evaluation context.
+ * \return a new context
+ */
+extern expression_context expression_context_create(void);
+
+/*!
+ * Destroy an evaluation context and release related resources.
+ * \param ctx (location of the) context to destroy.
+ * \pre \c ctx is non NULL.
+ */
+extern void expression_context_destroy(expression_context *ctx);
+
+/*!
+ * Same as \c term_is_valid_expression within a given context.
+ * \param ctx evaluation context.
+ * \param t term to check.
+ * \pre \c ctx and \c t are non NULL.
+ * \return true if term is valid.
+ */
+extern bool expression_is_valid_with_context(expression_context ctx, term t);
+
 /*!
  * Return the value of expression
+ * \param ctx evaluation context.
+ * \param t expression to valuate.
+ * \pre \c ctx and \c t are non NULL.
+ * \pre \c t is a valid expression
+ * \return value of expression.
+ */
+extern int expression_valuate_with_context(expression_context ctx, term t);
+
+/*!
+ * Return the exact value of expression
+ * \param ctx evaluation context.
+ * \param t expression to valuate.
+ * \pre \c ctx and \c t are non NULL.
+ * \pre \c t is a valid expression
+ * \return value of expression (to be destroyed), NULL on a division by zero.
+ */
+extern bignum expression_valuate_exact_with_context(expression_context ctx,
+                                                    term t);
+
+/*!
+ * Compiled expression.
+ * An expression is compiled once into a code for a stack machine, the code can
+ * then be run any number of times (even concurrently).
+ */
+typedef struct expression_code_struct *expression_code;
+
+/*!
+ * Compile an expression.
+ * The expression is validated once, here.
+ * Variables (like \c 'x ) may appear where values are expected, they are
+ * numbered from 0 in order of first appearance.
+ * \param ctx evaluation context.
+ * \param t expression to compile.
+ * \pre \c ctx and \c t are non NULL.
+ * \pre \c t is a valid expression (variables allowed)
+ * \return compiled expression.
+ */
+extern expression_code expression_compile(expression_context ctx, term t);
+
+/*!
+ * Destroy a compiled expression and release related resources.
+ * \param code (location of the) compiled expression to destroy.
+ * \pre \c code is non NULL.
+ */
+extern void expression_code_destroy(expression_code *code);
+
+/*!
+ * Return the number of variables of a compiled expression.
+ * \param code compiled expression.
+ * \pre \c code is non NULL.
+ * \return number of variables.
+ */
+extern int expression_code_get_nb_variables(expression_code code);
+
+/*!
+ * Return the symbol of a variable of a compiled expression (and not a copy).
+ * \param code compiled expression.
+ * \param i number of the variable.
+ * \pre \c code is non NULL.
+ * \pre 0 ≤ \c i < number of variables.
+ * \return symbol of variable number \c i .
+ */
+extern sstring expression_code_get_variable(expression_code code, int i);
+
+/*!
+ * Return the value of a compiled expression.
+ * \param code compiled expression.
+ * \pre \c code is non NULL.
+ * \pre \c code has no variable.
+ * \pre the value fits in an \c int (assert-ed) otherwise use
+ * \c expression_code_run_exact .
+ * \return value of expression.
+ */
+extern int expression_code_run(expression_code code);
+
+/*!
+ * Return the exact value of a compiled expression.
+ * \param code compiled expression.
+ * \pre \c code is non NULL.
+ * \pre \c code has no variable.
+ * \return value of expression (to be destroyed), NULL on a division by zero.
+ */
+extern bignum expression_code_run_exact(expression_code code);
+
+/*!
+ * Evaluate a compiled expression on many rows of variable values.
+ * Values are given by columns: \c columns[i][r] is the value of variable
+ * \c i on row \c r .
+ * Computation is done on 64 bits integers checked for overflow. A row has no
+ * value if it divides by zero, if some value does not fit in 64 bits or if
+ * its value does not fit in an \c int : it is flagged (its result is 0) and
+ * the other rows are not affected.
+ * \param code compiled expression.
+ * \param columns one column of \c nb_rows values per variable.
+ * \param nb_rows number of rows.
+ * \param results where to put the \c nb_rows values of the expression.
+ * \param undefined where to put for each row whether it has no value (can
+ * be NULL).
+ * \pre \c code is non NULL.
+ * \pre \c columns , \c results and \c undefined hold enough values.
+ * \return the number of rows without a value.
+ */
+extern int expression_code_run_batch(expression_code code,
+                                     int const *const columns[], int nb_rows,
+                                     int *results, bool *undefined);
+
+/*!
+ * Return the value of expression (with a temporary context)
  * \param t expression to valuate.
  * \pre \c t is non NULL.
  * \pre \c t is a valid expression
@@ -44,4 +186,13 @@ extern bool term_is_valid_expression(term t);
  */
 extern int expression_valuate(term t);
 
+/*!
+ * Return the exact value of expression (with a temporary context)
+ * \param t expression to valuate.
+ * \pre \c t is non NULL.
+ * \pre \c t is a valid expression
+ * \return value of expression (to be destroyed), NULL on a division by zero.
+ */
+extern bignum expression_valuate_exact(term t);
+
 #endif
@@ -2,104 +2,310 @@
 #include "term_io.h"
 #include <assert.h>
 #include <ctype.h>
+#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
 
-bool term_is_number(term t, int *n_pt) {
-  sstring symbol = term_get_symbol(t);
-  return sstring_is_integer(symbol, n_pt);
+bool term_is_number(term t, int *n_pt) { return term_get_integer(t, n_pt); }
+/*!
+ * Symbols and expression context used by the evaluation, created once per
+ * context. Symbols are interned (see \c term_symbol_intern ).
+ */
+struct peano_context_struct {
+  sstring symbol_if;
+  sstring symbol_zero;
+  sstring symbol_successor;
+  sstring symbol_plus;
+  sstring symbol_times;
+  expression_context expression;
+};
+
+/*!
+ * Interned copy of a symbol.
+ * \param text symbol.
+ * \return the interned symbol (not to be destroyed).
+ */
+static sstring symbol_intern(char const *text) {
+  sstring s = sstring_create_string(text);
+  sstring res = term_symbol_intern(s);
+  sstring_destroy(&s);
+  return res;
+}
+
+peano_context peano_context_create(void) {
+  peano_context ctx = malloc(sizeof(struct peano_context_struct));
+  assert(ctx != NULL);
+  ctx->symbol_if = symbol_intern("if");
+  ctx->symbol_zero = symbol_intern("0");
+  ctx->symbol_successor = symbol_intern("S");
+  ctx->symbol_plus = symbol_intern("+");
+  ctx->symbol_times = symbol_intern("*");
+  ctx->expression = expression_context_create();
+  return ctx;
+}
+
+void peano_context_destroy(peano_context *ctx) {
+  assert(ctx != NULL);
+  if (*ctx != NULL) {
+    expression_context_destroy(&(*ctx)->expression);
+    free(*ctx);
+    *ctx = NULL;
+  }
 }
+
 /*!
- * Recursive valuating function.
- * \param t term being valuated.
- * \return t peano term if its possible
+ * Replace Peano numerals (\c S^n(0) with n > 0) by their decimal value, so that
+ * arithmetic is done on the counts.
+ * \param t term to modify.
  */
-static term peano_valuate_inner(term t) {
-  int *n_pt = (int *)malloc(sizeof(int));
-  if (term_is_number(t, n_pt)) {
-    sstring symbol = sstring_create_string("S");
-    term_set_symbol(t, symbol);
-    sstring_destroy(&symbol);
-    symbol = sstring_create_string("0");
-    term tmp = t;
-    for (int i = 0; i < *n_pt; i++) {
-      term_add_argument_first(tmp, term_create(term_get_symbol(t)));
-      tmp = term_get_argument(tmp, 0);
-    }
-    term_set_symbol(tmp, symbol);
+static void peano_numerals_to_numbers(term t) {
+  long n;
+  if (term_is_peano(t, &n) && n > 0) {
+    char buffer[24];
+    sprintf(buffer, "%ld", n);
+    sstring symbol = sstring_create_string(buffer);
+    term number = term_create(symbol);
     sstring_destroy(&symbol);
+    term_replace_move(t, &number);
   } else {
-    term_argument_traversal tat = term_argument_traversal_create(t);
-    while (term_argument_traversal_has_next(tat)) {
-      term tmp = term_argument_traversal_get_next(tat);
-      peano_valuate_inner(tmp);
+    term arg;
+    term_for_each_argument(arg, t) {
+      peano_numerals_to_numbers(arg);
     }
-    term_argument_traversal_destroy(&tat);
   }
-  free(n_pt);
-  return t;
 }
-sstring symbol_if = NULL;
-sstring symbol_zero = NULL;
+
 /*!
 * evaluate term with if
+* \param ctx evaluation context.
 * \param t term to evaluate
 * \return t term with replacement
 */
-static term peano_compare(term t) {
-  if (sstring_compare(term_get_symbol(t), symbol_if) == 0) {
+static term peano_compare(peano_context ctx, term t) {
+  if (term_has_symbol(t, ctx->symbol_if)) {
     term first = term_get_argument(t, 0);
-    if (sstring_compare(term_get_symbol(first), symbol_zero) == 0) {
-      term tmp = term_copy(term_get_argument(t, 1));
-      term_destroy(&t);
-      t = term_copy(tmp);
-      term_destroy(&tmp);
-    } else {
-      term tmp = term_copy(term_get_argument(t, 2));
-      term_destroy(&t);
-      t = term_copy(tmp);
-      term_destroy(&tmp);
-    }
+    int pos = term_has_symbol(first, ctx->symbol_zero)
+                  ? 1
+                  : 2;
+    // replaced in place, t may be an argument
+    term branch = term_get_argument(t, pos);
+    term_replace_move(t, &branch);
   }
-  term_argument_traversal tat = term_argument_traversal_create(t);
-  while (term_argument_traversal_has_next(tat)) {
-    term tmp = term_argument_traversal_get_next(tat);
-    peano_compare(tmp);
+  if (term_get_successor_run(t) > 0) {
+    // a numeral holds no if, do not create its successors
+    return t;
+  }
+  term arg;
+  term_for_each_argument(arg, t) {
+    peano_compare(ctx, arg);
   }
-  term_argument_traversal_destroy(&tat);
   return t;
 }
-/*!
- * int to char* function
- * \param val int to transform in char*
- * \return char* correspond to the int
- */
-static char *int_to_pchar(int val) {
-  char *char_symbol = (char *)malloc(sizeof(char) * 2);
-  char_symbol[0] = val + '0';
-  char_symbol[1] = '\0';
-  return char_symbol;
+
+bool peano_is_valid_with_context(peano_context ctx, term t) {
+  assert(ctx != NULL);
+  assert(t != NULL);
+  long n;
+  int value;
+  if (term_is_peano(t, &n)) {
+    return true;
+  }
+  if (term_get_arity(t) == 0) {
+    return term_get_integer(t, &value) && value >= 0;
+  }
+  if (term_has_symbol(t, ctx->symbol_if)) {
+    if (term_get_arity(t) != 3) {
+      return false;
+    }
+  } else if (!term_has_symbol(t, ctx->symbol_plus) &&
+             !term_has_symbol(t, ctx->symbol_times)) {
+    return false;
+  }
+  term arg;
+  term_for_each_argument(arg, t) {
+    if (!peano_is_valid_with_context(ctx, arg)) {
+      return false;
+    }
+  }
+  return true;
 }
 
-term peano_valuate(term t) {
+term peano_valuate_bounded_with_context(peano_context ctx, term t, long max) {
+  assert(ctx != NULL);
   assert(t != NULL);
-  symbol_if = sstring_create_string("if");
-  symbol_zero = sstring_create_string("0");
+  assert(max >= 0);
   term t_copy = term_copy(t);
-  t_copy = peano_compare(t_copy);
+  t_copy = peano_compare(ctx, t_copy);
+  peano_numerals_to_numbers(t_copy);
 
-  int val = expression_valuate(t_copy);
+  expression_code code = expression_compile(ctx->expression, t_copy);
+  bignum b = expression_code_run_exact(code);
+  assert(b != NULL); // no division
+  int64_t val;
+  bool fits = bignum_is_int64(b, &val) && val >= 0 && val <= max;
+  bignum_destroy(&b);
+  expression_code_destroy(&code);
   term_destroy(&t_copy);
-  char *char_symbol = int_to_pchar(val);
-  sstring symbol = sstring_create_string(char_symbol);
-  t_copy = term_create(symbol);
 
-  peano_valuate_inner(t_copy);
+  return fits ? term_create_peano(val) : NULL;
+}
+
+term peano_valuate_with_context(peano_context ctx, term t) {
+  term res = peano_valuate_bounded_with_context(ctx, t, LONG_MAX);
+  assert(res != NULL);
+  return res;
+}
+
+term peano_valuate(term t) {
+  peano_context ctx = peano_context_create();
+  term res = peano_valuate_with_context(ctx, t);
+  peano_context_destroy(&ctx);
+  return res;
+}
+
+/*!
+ * Create the numeral \c S^n(0).
+ * \param ctx evaluation context.
+ * \param n value of the numeral.
+ * \param fast if true a single run term is created, otherwise every
+ * successor is a node.
+ * \return numeral
+ */
+static term peano_numeral(peano_context ctx, long n, bool fast) {
+  if (fast) {
+    return term_create_peano(n);
+  }
+  term res = term_create(ctx->symbol_zero);
+  for (; n > 0; n--) {
+    term s = term_create(ctx->symbol_successor);
+    term_add_argument_last(s, res);
+    res = s;
+  }
+  return res;
+}
+
+/*!
+ * Normalize \c +(x y) for numerals in normal form.
+ * Without the fast path, the rules
+ * \c +(0 'y) -> 'y and \c +(S('x) 'y) -> S(+('x 'y))
+ * are applied one successor at a time.
+ * \param ctx evaluation context.
+ * \param x first numeral (not modified).
+ * \param y second numeral, moved into the result (destroyed).
+ * \param fast whether runs are added on their counts.
+ * \return normal form of the sum
+ */
+static term peano_add(peano_context ctx, term x, term y, bool fast) {
+  if (fast) {
+    long n, m, r;
+    bool ok = term_is_peano(x, &n) && term_is_peano(y, &m);
+    assert(ok);
+    ok = !__builtin_add_overflow(n, m, &r);
+    assert(ok);
+    term_destroy(&y);
+    return term_create_peano(r);
+  }
+  term res = y;
+  while (term_has_symbol(x, ctx->symbol_successor)) {
+    term s = term_create(ctx->symbol_successor);
+    term_add_argument_last(s, res);
+    res = s;
+    x = term_get_argument(x, 0);
+  }
+  assert(term_has_symbol(x, ctx->symbol_zero));
+  return res;
+}
+
+/*!
+ * Normalize \c *(x y) for numerals in normal form.
+ * Without the fast path, the rules
+ * \c *(0 'y) -> 0 and \c *(S('x) 'y) -> +('y *('x 'y))
+ * are applied one successor at a time.
+ * \param ctx evaluation context.
+ * \param x first numeral (not modified).
+ * \param y second numeral (not modified).
+ * \param fast whether runs are multiplied on their counts.
+ * \return normal form of the product
+ */
+static term peano_multiply(peano_context ctx, term x, term y, bool fast) {
+  if (fast) {
+    long n, m, r;
+    bool ok = term_is_peano(x, &n) && term_is_peano(y, &m);
+    assert(ok);
+    ok = !__builtin_mul_overflow(n, m, &r);
+    assert(ok);
+    return term_create_peano(r);
+  }
+  term res = term_create(ctx->symbol_zero);
+  while (term_has_symbol(x, ctx->symbol_successor)) {
+    res = peano_add(ctx, y, res, false);
+    x = term_get_argument(x, 0);
+  }
+  assert(term_has_symbol(x, ctx->symbol_zero));
+  return res;
+}
+
+/*!
+ * Compute the normal form of a term, innermost first.
+ * \param ctx evaluation context.
+ * \param t term to normalize (not modified).
+ * \param fast whether the successor fast path is used.
+ * \return numeral in normal form
+ */
+static term peano_normalize_inner(peano_context ctx, term t, bool fast) {
+  int arity = term_get_arity(t);
+  if (term_has_symbol(t, ctx->symbol_if)) {
+    assert(arity == 3);
+    term cond = peano_normalize_inner(ctx, term_get_argument(t, 0), fast);
+    int pos =
+        term_has_symbol(cond, ctx->symbol_zero) ? 1 : 2;
+    term_destroy(&cond);
+    return peano_normalize_inner(ctx, term_get_argument(t, pos), fast);
+  }
+  bool plus = term_has_symbol(t, ctx->symbol_plus);
+  if (plus || term_has_symbol(t, ctx->symbol_times)) {
+    term res = peano_numeral(ctx, plus ? 0 : 1, fast);
+    term operand;
+    term_for_each_argument(operand, t) {
+      term arg = peano_normalize_inner(ctx, operand, fast);
+      term tmp;
+      if (plus) {
+        tmp = peano_add(ctx, res, arg, fast);
+      } else {
+        tmp = peano_multiply(ctx, res, arg, fast);
+        term_destroy(&arg);
+      }
+      term_destroy(&res);
+      res = tmp;
+    }
+    return res;
+  }
+  long n;
+  if (term_is_peano(t, &n)) {
+    return peano_numeral(ctx, n, fast);
+  }
+  int value = 0;
+  bool number = arity == 0 && term_is_number(t, &value);
+  assert(number && value >= 0);
+  return peano_numeral(ctx, value, fast);
+}
 
-  sstring_destroy(&symbol);
-  sstring_destroy(&symbol_if);
-  sstring_destroy(&symbol_zero);
-  free(char_symbol);
+term peano_normalize_with_context(peano_context ctx, term t, bool fast) {
+  assert(ctx != NULL);
+  assert(t != NULL);
+  return peano_normalize_inner(ctx, t, fast);
+}
+
+term peano_normalize(term t) {
+  peano_context ctx = peano_context_create();
+  term res = peano_normalize_with_context(ctx, t, true);
+  peano_context_destroy(&ctx);
+  return res;
+}
 
-  return t_copy;
+term peano_normalize_stepwise(term t) {
+  peano_context ctx = peano_context_create();
+  term res = peano_normalize_with_context(ctx, t, false);
+  peano_context_destroy(&ctx);
+  return res;
 }
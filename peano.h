@@ -21,14 +21,114 @@
  * \return true if symbol is valid
  */
 extern bool term_is_number(term t, int *n_pt);
+/*!
+ * Evaluation context.
+ * It holds everything an evaluation needs, so that evaluations using different
+ * contexts can run concurrently.
+ * A context can be reused for many evaluations but not by two at once.
+ */
+typedef struct peano_context_struct *peano_context;
+
+/*!
+ * Create an evaluation context.
+ * \return a new context
+ */
+extern peano_context peano_context_create(void);
+
+/*!
+ * Destroy an evaluation context and release related resources.
+ * \param ctx (location of the) context to destroy.
+ * \pre \c ctx is non NULL.
+ */
+extern void peano_context_destroy(peano_context *ctx);
+
+/*!
+ * Check the shape required by \c peano_valuate : \c + , \c * and \c if (with
+ * three arguments) over decimal numbers and Peano numerals.
+ * \param ctx evaluation context
+ * \param t term to check
+ * \pre ctx and t are not null
+ * \return true if \c t can be valuated
+ */
+extern bool peano_is_valid_with_context(peano_context ctx, term t);
+
+/*!
+ * Same as \c peano_valuate within a given context.
+ * \param ctx evaluation context
+ * \param t term to modified
+ * \pre ctx and t are not null
+ * \return peano term
+ */
+extern term peano_valuate_with_context(peano_context ctx, term t);
+
+/*!
+ * Same as \c peano_valuate_with_context , for values that may be too big.
+ * \param ctx evaluation context
+ * \param t term to modified
+ * \param max greatest value accepted (at most \c LONG_MAX )
+ * \pre ctx and t are not null
+ * \pre max is not negative
+ * \return peano term, NULL if its value is greater than \c max
+ */
+extern term peano_valuate_bounded_with_context(peano_context ctx, term t,
+                                               long max);
+
 /*!
  * The initial term is not modified.
  * A new term is generated with peano arithmetic term.
+ * Peano numerals in \c t are handled through their count and the result is
+ * stored as a single \c S^n(0) term (see \c term_create_peano ).
  * \param t term to modified
  * \pre t is not null
- * \pre all term in t must be + or * and a number
+ * \pre all term in t must be + or * and a number (decimal or Peano)
  * \return peano term
  */
 extern term peano_valuate(term t);
 
+/*!
+ * Same as \c peano_normalize within a given context.
+ * \param ctx evaluation context
+ * \param t term to normalize
+ * \param fast if true, numerals are runs and \c + and \c * are computed on
+ * their counts (successor fast path), otherwise rules are applied one
+ * successor at a time as in \c peano_normalize_stepwise
+ * \pre ctx and t are not null
+ * \return peano term
+ */
+extern term peano_normalize_with_context(peano_context ctx, term t, bool fast);
+
+/*!
+ * The initial term is not modified.
+ * A new term is generated by normalizing \c t with the Peano rules
+ * \code
+ * + ( 0 'y ) -> 'y
+ * + ( S ( 'x ) 'y ) -> S ( + ( 'x 'y ) )
+ * * ( 0 'y ) -> 0
+ * * ( S ( 'x ) 'y ) -> + ( 'y * ( 'x 'y ) )
+ * if ( 0 'a 'b ) -> 'a
+ * if ( S ( 'x ) 'a 'b ) -> 'b
+ * \endcode
+ * innermost first (decimal numbers are read as numerals, \c + and \c * with
+ * more than two arguments associate to the left).
+ * As a successor fast path, a numeral is a single \c S^n(0) run (see
+ * \c term_create_peano ) and all the applications of a rule on it are done at
+ * once on its count.
+ * \param t term to normalize
+ * \pre t is not null
+ * \pre all term in t must be +, *, if and a number (decimal or Peano)
+ * \return peano term
+ */
+extern term peano_normalize(term t);
+
+/*!
+ * Same as \c peano_normalize but without the fast path: every rule
+ * application handles a single successor and numerals are built node by node.
+ * It costs a step per successor (for \c * , per successor of the product).
+ * \param t term to normalize
+ * \pre t is not null
+ * \pre all term in t must be +, *, if and a number (decimal or Peano)
+ * \return peano term
+ */
+extern term peano_normalize_stepwise(term t);
+
 #endif
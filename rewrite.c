@@ -1,8 +1,17 @@
 #include "term_io.h"
 #include <assert.h>
+#include <ctype.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
 
 #undef NDEBUG // FORCE ASSERT ACTIVATION
 
+#include "check.h"
+#include "rewrite.h"
+#include "scheduler.h"
+#include "term_stats.h"
+#include "term_trace.h"
 #include "term_variable.h"
 #include "unify.h"
 
@@ -23,7 +32,7 @@ static char const *const symbol_error = "ERROR";
 static void term_clean_arguments(term t) {
   int arity = term_get_arity(t);
   for (int i = 0; i < arity; i++) {
-    term arg = term_extract_argument(t, 0);
+    term arg = term_take_argument(t, 0);
     term_destroy(&arg);
   }
 }
@@ -38,8 +47,9 @@ static term term_create_valuation(term variable, term value) {
 }
 
 static bool term_contains_variable(term t) {
-  for (int i = 0; i < term_get_arity(t); i++) {
-    if (term_is_variable(term_get_argument(t, i))) {
+  term arg;
+  term_for_each_argument(arg, t) {
+    if (term_is_variable(arg)) {
       return true;
     }
   }
@@ -62,32 +72,93 @@ static term term_create_affectation() {
  * \pre t and arg are non NULL.
  */
 static void term_add_arg_sort_unique(term t, term arg) {
-  int arity = term_get_arity(t);
-  for (int i = 0; i < arity; i++) {
-    if (term_compare(arg, term_get_argument(t, i)) == 0) {
+  int i = 0;
+  term current;
+  term_for_each_argument(current, t) {
+    int compare = term_compare(arg, current);
+    if (compare == 0) {
       term_destroy(&arg);
       return;
     }
-    if (term_compare(arg, term_get_argument(t, i)) < 0) {
+    if (compare < 0) {
       term_add_argument_position(t, arg, i);
       return;
     }
+    i++;
   }
   term_add_argument_last(t, arg);
 }
 
+/*!
+ * Move the arguments of a term to another one, both sorted without duplicate
+ * (see \c term_add_arg_sort_unique ). The arguments already present are
+ * destroyed.
+ * Both are walked once from their first argument (a linear merge), so there
+ * are fewer comparisons than when adding the arguments one by one; when the
+ * arguments of \c others all go after (or before) those of \c t , they are
+ * moved without comparison.
+ * \param t term to add to.
+ * \param others term whose arguments are moved (left without argument).
+ * \pre t and others are non NULL.
+ */
+static void term_merge_sort_unique(term t, term others) {
+  int const arity = term_get_arity(t);
+  int const nb_others = term_get_arity(others);
+  if (nb_others == 0) {
+    return;
+  }
+  // usual case: all the arguments of others go after (or before) those of t
+  if (arity == 0 || term_compare(term_get_argument(t, arity - 1),
+                                 term_get_argument(others, 0)) < 0) {
+    while (term_get_arity(others) > 0) {
+      term_add_argument_last(t, term_take_argument(others, 0));
+    }
+    return;
+  }
+  if (term_compare(term_get_argument(others, nb_others - 1),
+                   term_get_argument(t, 0)) < 0) {
+    while (term_get_arity(others) > 0) {
+      term_add_argument_first(
+          t, term_take_argument(others, term_get_arity(others) - 1));
+    }
+    return;
+  }
+  term mine = term_create(term_get_symbol(t));
+  while (term_get_arity(t) > 0) {
+    term_add_argument_last(mine, term_take_argument(t, 0));
+  }
+  while (term_get_arity(mine) > 0 || term_get_arity(others) > 0) {
+    term from = term_get_arity(others) == 0 ? mine : others;
+    if (term_get_arity(mine) > 0 && term_get_arity(others) > 0) {
+      int compare = term_compare(term_get_argument(mine, 0),
+                                 term_get_argument(others, 0));
+      if (compare == 0) {
+        term arg = term_take_argument(others, 0);
+        term_destroy(&arg);
+      }
+      from = compare <= 0 ? mine : others;
+    }
+    term_add_argument_last(t, term_take_argument(from, 0));
+  }
+  term_destroy(&mine);
+}
+
 term term_copy_replace_at_loc(term t, term r, term *loc) {
   if (*loc == t) {
     return r;
   }
+  // argument of t on the way to *loc (if it is inside t), the other ones are
+  // copied as a whole (their arguments are shared when sharing is on)
+  term on_path = *loc;
+  while (on_path != NULL && term_get_father(on_path) != t) {
+    on_path = term_get_father(on_path);
+  }
   term new = term_create(term_get_symbol(t));
-  for (int i = 0; i < term_get_arity(t); i++) {
-    term arg = term_get_argument(t, i);
-    if (*loc == arg) {
-      term_add_argument_last(new, r);
-    } else {
-      term_add_argument_last(new, term_copy_replace_at_loc(arg, r, loc));
-    }
+  term arg;
+  term_for_each_argument(arg, t) {
+    term_add_argument_last(new, arg == on_path
+                                    ? term_copy_replace_at_loc(arg, r, loc)
+                                    : term_copy(arg));
   }
   return new;
 }
@@ -116,8 +187,8 @@ static bool term_is_pattern(term t, term pattern, term affectation) {
   // insert error term for later.
   if (term_is_variable(pattern)) {
     if (term_contains_symbol(affectation, term_get_symbol(pattern))) {
-      for (int i = 0; i < term_get_arity(affectation); i++) {
-        term valuation = term_get_argument(affectation, i);
+      term valuation;
+      term_for_each_argument(valuation, affectation) {
         if (sstring_compare(term_get_symbol(term_get_argument(valuation, 0)),
                             term_get_symbol(pattern)) == 0) {
           if (term_compare(term_get_argument(valuation, 1), t) != 0) {
@@ -146,20 +217,17 @@ static bool term_is_pattern(term t, term pattern, term affectation) {
   // arguments of pattern, if
   // it's a pattern of each arguments of the term. (for example with variables)
   if (sstring_compare(term_get_symbol(pattern), term_get_symbol(t)) == 0) {
-    term_argument_traversal ttraversal = term_argument_traversal_create(t);
-    term_argument_traversal patternTraversal =
-        term_argument_traversal_create(pattern);
+    term_argument_iterator patternIterator =
+        term_argument_iterator_start(pattern);
     bool subtermsArePatterns = true;
-    while (term_argument_traversal_has_next(ttraversal)) {
-      term current_t = term_argument_traversal_get_next(ttraversal);
-      term current_pattern = term_argument_traversal_get_next(patternTraversal);
+    term current_t;
+    term_for_each_argument(current_t, t) {
+      term current_pattern = term_argument_iterator_next(&patternIterator);
       if (!term_is_pattern(current_t, current_pattern, affectation)) {
         subtermsArePatterns = false;
         break;
       }
     }
-    term_argument_traversal_destroy(&patternTraversal);
-    term_argument_traversal_destroy(&ttraversal);
     if (!subtermsArePatterns)
       return false;
 
@@ -180,6 +248,267 @@ static bool term_is_pattern(term t, term pattern, term affectation) {
   return false;
 }
 
+/*!
+ * Learned counts of a rule.
+ */
+typedef struct {
+  /*! the rule ( \c -> ( pattern replacement ) ) */
+  term rule;
+  /*! hash of the rule (see \c rule_hash ) */
+  unsigned int hash;
+  /*! number of sub-terms the pattern was tried on */
+  unsigned long attempts;
+  /*! number of sub-terms the pattern matched */
+  unsigned long hits;
+  /*! next rule in the same bucket (index, -1 for none) */
+  int next;
+} rule_profile;
+
+/*! Initial number of buckets of a \c rewrite_profile . */
+#define PROFILE_BUCKETS_BASE 16
+
+/*!
+ * Learned counts of rules, found by hash and comparison of the rules (the
+ * index of a rule in a rewrite term does not matter).
+ */
+struct rewrite_profile_struct {
+  /*! profiles of the rules, in the order they were first seen */
+  rule_profile *rules;
+  /*! number of rules */
+  int nb_rules;
+  /*! allocated size of \c rules */
+  int capacity;
+  /*! first rule of each bucket (index, -1 for none) */
+  int *buckets;
+  /*! number of buckets (a power of 2) */
+  unsigned int nb_buckets;
+};
+
+rewrite_profile rewrite_profile_create(void) {
+  rewrite_profile p = malloc(sizeof(struct rewrite_profile_struct));
+  assert(p != NULL);
+  p->rules = NULL;
+  p->nb_rules = 0;
+  p->capacity = 0;
+  p->nb_buckets = PROFILE_BUCKETS_BASE;
+  p->buckets = malloc(p->nb_buckets * sizeof(int));
+  assert(p->buckets != NULL);
+  for (unsigned int h = 0; h < p->nb_buckets; h++) {
+    p->buckets[h] = -1;
+  }
+  return p;
+}
+
+void rewrite_profile_destroy(rewrite_profile *p) {
+  assert(p != NULL);
+  if (*p != NULL) {
+    for (int i = 0; i < (*p)->nb_rules; i++) {
+      term_destroy(&(*p)->rules[i].rule);
+    }
+    free((*p)->rules);
+    free((*p)->buckets);
+    free(*p);
+    *p = NULL;
+  }
+}
+
+/*!
+ * Pre-order visitor of \c rule_hash : adds the symbol and arity of a term. A
+ * \c S^n(0) run is hashed like the same term built explicitly, as they are
+ * equal for \c term_compare .
+ */
+static term_visit rule_hash_pre(term t, int depth, void *data) {
+  unsigned int *hash = data;
+  (void)depth;
+  long run = term_get_successor_run(t);
+  for (long i = 0; i < run; i++) {
+    *hash = (*hash * 31 + sstring_hash(term_get_symbol(t))) * 31 + 1;
+  }
+  if (run > 0) {
+    sstring s = sstring_create_string("0");
+    *hash = (*hash * 31 + sstring_hash(s)) * 31;
+    sstring_destroy(&s);
+  } else {
+    *hash = (*hash * 31 + sstring_hash(term_get_symbol(t))) * 31 +
+            term_get_arity(t);
+  }
+  return TERM_VISIT_CONTINUE;
+}
+
+/*!
+ * Hash of a rule, equal rules have the same hash.
+ * \param rule rule to hash.
+ * \return hash value.
+ */
+static unsigned int rule_hash(term rule) {
+  unsigned int hash = 0;
+  term_traverse(rule, rule_hash_pre, NULL, &hash);
+  return hash;
+}
+
+/*!
+ * Find the profile of a rule, it is added (with null counts) if missing.
+ * \param p profile.
+ * \param rule rule to look for (copied if added).
+ * \return the profile of the rule (valid until the next addition).
+ */
+static rule_profile *rewrite_profile_find(rewrite_profile p, term rule) {
+  unsigned int hash = rule_hash(rule);
+  for (int i = p->buckets[hash & (p->nb_buckets - 1)]; i >= 0;
+       i = p->rules[i].next) {
+    if (p->rules[i].hash == hash && term_compare(p->rules[i].rule, rule) == 0) {
+      return &p->rules[i];
+    }
+  }
+  if (p->nb_rules == p->capacity) {
+    p->capacity = p->capacity == 0 ? 8 : 2 * p->capacity;
+    p->rules = realloc(p->rules, p->capacity * sizeof(rule_profile));
+    assert(p->rules != NULL);
+  }
+  if ((unsigned int)p->nb_rules >= 2 * p->nb_buckets) {
+    p->nb_buckets *= 2;
+    p->buckets = realloc(p->buckets, p->nb_buckets * sizeof(int));
+    assert(p->buckets != NULL);
+    for (unsigned int h = 0; h < p->nb_buckets; h++) {
+      p->buckets[h] = -1;
+    }
+    for (int i = 0; i < p->nb_rules; i++) {
+      unsigned int h = p->rules[i].hash & (p->nb_buckets - 1);
+      p->rules[i].next = p->buckets[h];
+      p->buckets[h] = i;
+    }
+  }
+  int i = p->nb_rules++;
+  rule_profile *rp = &p->rules[i];
+  rp->rule = term_copy(rule);
+  rp->hash = hash;
+  rp->attempts = 0;
+  rp->hits = 0;
+  unsigned int h = hash & (p->nb_buckets - 1);
+  rp->next = p->buckets[h];
+  p->buckets[h] = i;
+  return rp;
+}
+
+int rewrite_profile_get_nb_rules(rewrite_profile p) {
+  assert(p != NULL);
+  return p->nb_rules;
+}
+
+term rewrite_profile_get_rule(rewrite_profile p, int i, unsigned long *attempts,
+                              unsigned long *hits) {
+  assert(p != NULL);
+  assert(0 <= i && i < p->nb_rules);
+  assert(attempts != NULL);
+  assert(hits != NULL);
+  *attempts = p->rules[i].attempts;
+  *hits = p->rules[i].hits;
+  return p->rules[i].rule;
+}
+
+void rewrite_profile_save(rewrite_profile p, FILE *out) {
+  assert(p != NULL);
+  assert(out != NULL);
+  for (int i = 0; i < p->nb_rules; i++) {
+    fprintf(out, "%lu %lu ", p->rules[i].attempts, p->rules[i].hits);
+    term_print_compact(p->rules[i].rule, out);
+    fputc('\n', out);
+  }
+}
+
+/*!
+ * Read a line of any length.
+ * \param in stream to read from.
+ * \return the line, without its end of line, to be freed, or NULL at the end
+ * of the stream.
+ */
+static char *profile_read_line(FILE *in) {
+  size_t size = 128;
+  size_t length = 0;
+  char *line = malloc(size);
+  assert(line != NULL);
+  int c;
+  while ((c = getc(in)) != EOF && c != '\n') {
+    if (length + 1 == size) {
+      size *= 2;
+      line = realloc(line, size);
+      assert(line != NULL);
+    }
+    line[length++] = c;
+  }
+  if (c == EOF && length == 0) {
+    free(line);
+    return NULL;
+  }
+  line[length] = '\0';
+  return line;
+}
+
+/*!
+ * Read a count of a saved profile.
+ * \param text where to read, moved after the count.
+ * \param count where to store the count.
+ * \return false if \c text does not start with a count.
+ */
+static bool profile_read_count(char const **text, unsigned long *count) {
+  char const *c = *text + strspn(*text, " \t");
+  if (!isdigit((unsigned char)*c)) {
+    return false;
+  }
+  char *end;
+  errno = 0;
+  *count = strtoul(c, &end, 10);
+  *text = end;
+  return errno == 0;
+}
+
+bool rewrite_profile_load(rewrite_profile p, FILE *in) {
+  assert(p != NULL);
+  assert(in != NULL);
+  sstring s_rule = sstring_create_string(symbol_rule);
+  bool ok = true;
+  char *line;
+  while (ok && (line = profile_read_line(in)) != NULL) {
+    char const *text = line;
+    unsigned long attempts, hits;
+    if (text[strspn(text, " \t\r")] != '\0') {
+      // the term is checked before it is read
+      term rule = NULL;
+      ok = profile_read_count(&text, &attempts) &&
+           profile_read_count(&text, &hits) && hits <= attempts &&
+           (rule = term_scan_text(text)) != NULL &&
+           sstring_equals(term_get_symbol(rule), s_rule) &&
+           term_get_arity(rule) == 2;
+      if (ok) {
+        rule_profile *rp = rewrite_profile_find(p, rule);
+        rp->attempts += attempts;
+        rp->hits += hits;
+      }
+      term_destroy(&rule);
+    }
+    free(line);
+  }
+  sstring_destroy(&s_rule);
+  return ok;
+}
+
+/*!
+ * Rule being applied during a rewriting step, with the counts traced for the
+ * step.
+ */
+typedef struct {
+  /*! index of the rule (for statistics) */
+  int rule;
+  /*! learned counts of the rule (NULL if there is no profile) */
+  rule_profile *profile;
+  /*! number of matches of the rules applied so far in the step */
+  long matches;
+  /*! time spent adding the results without duplicate, in µs (when traced) */
+  double dedup_us;
+  /*! budget of splits of the sub-terms into tasks (see \c scheduler_split ) */
+  int splits_left;
+} rewrite_step;
+
 static term term_create_result() {
   sstring string_result = sstring_create_string(symbol_results);
   term results = term_create(string_result);
@@ -187,6 +516,107 @@ static term term_create_result() {
   return results;
 }
 
+static void term_rewrite_rule(term t_whole, term t_current, term pattern,
+                              term replace, term results, rewrite_step *step);
+
+/*!
+ * Arguments of a sub-term split into chunks of consecutive arguments, each
+ * with its own results and counts (merged afterwards).
+ */
+typedef struct {
+  term t_whole;
+  term pattern;
+  term replace;
+  /*! arguments of the sub-term */
+  term *args;
+  int nb_args;
+  int nb_chunks;
+  /*! results of each chunk */
+  term *results;
+  /*! step of each chunk */
+  rewrite_step *steps;
+  /*! counts of the rule of each chunk */
+  rule_profile *profiles;
+} rewrite_chunks;
+
+static void rewrite_chunk_run(void *data, int i) {
+  rewrite_chunks *chunks = data;
+  int const first = (long)i * chunks->nb_args / chunks->nb_chunks;
+  int const last = (long)(i + 1) * chunks->nb_args / chunks->nb_chunks;
+  for (int k = first; k < last; k++) {
+    term_rewrite_rule(chunks->t_whole, chunks->args[k], chunks->pattern,
+                      chunks->replace, chunks->results[i], &chunks->steps[i]);
+  }
+}
+
+/*!
+ * Apply a rule to the arguments of a sub-term (see \c term_rewrite_rule ).
+ * Within the budget of splits of the step, the arguments are split into
+ * chunks run as tasks, whose results are then merged in chunk order (the
+ * results are a sorted set, they do not depend on the order).
+ */
+static void term_rewrite_arguments(term t_whole, term t_current, term pattern,
+                                   term replace, term results,
+                                   rewrite_step *step) {
+  int splits_left = step->splits_left;
+  int const nb_chunks =
+      scheduler_split(&splits_left, term_get_arity(t_current));
+  if (nb_chunks <= 1) {
+    term arg;
+    term_for_each_argument(arg, t_current) {
+      term_rewrite_rule(t_whole, arg, pattern, replace, results, step);
+    }
+    return;
+  }
+  rewrite_chunks chunks;
+  chunks.t_whole = t_whole;
+  chunks.pattern = pattern;
+  chunks.replace = replace;
+  chunks.nb_args = term_get_arity(t_current);
+  chunks.nb_chunks = nb_chunks;
+  chunks.args = malloc(chunks.nb_args * sizeof(term));
+  chunks.results = malloc(nb_chunks * sizeof(term));
+  chunks.steps = malloc(nb_chunks * sizeof(rewrite_step));
+  chunks.profiles = malloc(nb_chunks * sizeof(rule_profile));
+  assert(chunks.args != NULL && chunks.results != NULL &&
+         chunks.steps != NULL && chunks.profiles != NULL);
+  int k = 0;
+  term arg;
+  term_for_each_argument(arg, t_current) { chunks.args[k++] = arg; }
+  for (int i = 0; i < nb_chunks; i++) {
+    chunks.results[i] = term_create_result();
+    chunks.steps[i] = *step;
+    chunks.steps[i].matches = 0;
+    chunks.steps[i].dedup_us = 0;
+    chunks.steps[i].splits_left = splits_left;
+    if (step->profile != NULL) {
+      chunks.profiles[i].rule = step->profile->rule;
+      chunks.profiles[i].attempts = 0;
+      chunks.profiles[i].hits = 0;
+      chunks.steps[i].profile = &chunks.profiles[i];
+    }
+  }
+  scheduler_parallel_for(nb_chunks, rewrite_chunk_run, &chunks);
+  double start = term_trace_start();
+  for (int i = 0; i < nb_chunks; i++) {
+    term_merge_sort_unique(results, chunks.results[i]);
+    term_destroy(&chunks.results[i]);
+    step->matches += chunks.steps[i].matches;
+    step->dedup_us += chunks.steps[i].dedup_us;
+    if (step->profile != NULL) {
+      step->profile->attempts += chunks.profiles[i].attempts;
+      step->profile->hits += chunks.profiles[i].hits;
+    }
+  }
+  if (start >= 0) {
+    step->dedup_us += term_trace_now() - start;
+  }
+  free(chunks.args);
+  free(chunks.results);
+  free(chunks.steps);
+  free(chunks.profiles);
+}
+
 /*!
  * To make operate a single rewriting rule on a term.
  * The products of rewriting are added to the results term as argument.
@@ -198,25 +628,42 @@ static term term_create_result() {
  * \param replace term to replace matches
  * \param results terms already generated by previous rules and the current
  * rule.
+ * \param step rule being applied and counts of the step.
  * \pre none of the term is NULL.
  */
 static void term_rewrite_rule(term t_whole, term t_current, term pattern,
-                              term replace, term results) {
+                              term replace, term results, rewrite_step *step) {
+  // Cheapest rejection test: the root of a pattern that is not a variable has
+  // to match the root of the term
+  if (!term_is_variable(pattern) &&
+      (term_get_arity(t_current) != term_get_arity(pattern) ||
+       !sstring_equals(term_get_symbol(t_current), term_get_symbol(pattern)))) {
+    term_stats_count_match(step->rule, false);
+    if (step->profile != NULL) {
+      step->profile->attempts++;
+    }
+    term_rewrite_arguments(t_whole, t_current, pattern, replace, results,
+                           step);
+    return;
+  }
   term affectation = term_create_affectation();
+  bool match = term_is_pattern(t_current, pattern, affectation);
+  term_stats_count_match(step->rule, match);
+  if (step->profile != NULL) {
+    step->profile->attempts++;
+    step->profile->hits += match;
+  }
   // If the term is a pattern,
-  if (term_is_pattern(t_current, pattern, affectation)) {
+  if (match) {
     // replace the variables in it and add the possibility to results.
     term r = term_copy(replace);
-    term_argument_traversal affectationTraversal =
-        term_argument_traversal_create(affectation);
     bool valuesSet = false;
-    while (term_argument_traversal_has_next(affectationTraversal)) {
-      term valuation = term_argument_traversal_get_next(affectationTraversal);
+    term valuation;
+    term_for_each_argument(valuation, affectation) {
       term_replace_variable(r, term_get_symbol(term_get_argument(valuation, 0)),
                             term_get_argument(valuation, 1));
       valuesSet = true;
     }
-    term_argument_traversal_destroy(&affectationTraversal);
 
     // If the pattern contains a variable but no affectation was made, it's
     // wrong, we stop here and don't add to results
@@ -226,18 +673,17 @@ static void term_rewrite_rule(term t_whole, term t_current, term pattern,
     // add to results the possibility
     term *loc = &t_current;
     term copy = term_copy_replace_at_loc(t_whole, r, loc);
+    step->matches++;
+    double start = term_trace_start();
     term_add_arg_sort_unique(results, copy);
+    if (start >= 0) {
+      step->dedup_us += term_trace_now() - start;
+    }
   } else {
     // Else, the term is not a pattern, so we try to rewrite its arguments
     // with the pattern
-    term_argument_traversal t_current_traversal =
-        term_argument_traversal_create(t_current);
-    while (term_argument_traversal_has_next(t_current_traversal)) {
-      term_rewrite_rule(t_whole,
-                        term_argument_traversal_get_next(t_current_traversal),
-                        pattern, replace, results);
-    }
-    term_argument_traversal_destroy(&t_current_traversal);
+    term_rewrite_arguments(t_whole, t_current, pattern, replace, results,
+                           step);
   }
   term_destroy(&affectation);
 }
@@ -248,7 +694,7 @@ static void term_rewrite_rule(term t_whole, term t_current, term pattern,
  * \li any number first argument has been removed
  * \li last argument is the term to rewrite
  *
- * Should be used for assert only
+ * Should be used for CHECK only
  */
 static bool rules_are_well_formed(term t) {
   sstring s_rewrite = sstring_create_string(symbol_rewrite);
@@ -258,7 +704,7 @@ static bool rules_are_well_formed(term t) {
   int factor = 1;
   term firstArgument = term_get_argument(t, 0);
   if (!term_is_variable(firstArgument) && term_get_arity(firstArgument) == 0) {
-    sstring_is_integer(term_get_symbol(firstArgument), &factor);
+    term_get_integer(firstArgument, &factor);
     hasFactor = true;
   }
   int startIndex;
@@ -280,53 +726,79 @@ static bool rules_are_well_formed(term t) {
   return true;
 }
 
-term term_rewrite(term t) {
-  assert(rules_are_well_formed(t));
+term term_rewrite(term t) { return term_rewrite_with_profile(NULL, t); }
+
+term term_rewrite_with_profile(rewrite_profile profile, term t) {
+  CHECK(rules_are_well_formed(t));
+  double const trace_start = term_trace_start();
   // Here I suppose the rule is well formed
   int factor = 1;
   // Check if there is a factor for the rules then affect it
   term firstArgument = term_get_argument(t, 0);
   if (!term_is_variable(firstArgument) && term_get_arity(firstArgument) == 0) {
-    sstring_is_integer(term_get_symbol(firstArgument), &factor);
+    term_get_integer(firstArgument, &factor);
+  }
+  // factor > 1 means that there is a factor as first argument, so we pass it
+  int const firstRule = factor > 1 ? 1 : 0;
+  int const nbRules = term_get_arity(t) - 1 - firstRule;
+  term *rules = malloc(nbRules * sizeof(term));
+  // profiles are indices, additions may move them
+  int *profiles = malloc(nbRules * sizeof(int));
+  assert(nbRules == 0 || (rules != NULL && profiles != NULL));
+  for (int r = 0; r < nbRules; r++) {
+    rules[r] = term_get_argument(t, firstRule + r);
+    if (profile != NULL) {
+      profiles[r] = rewrite_profile_find(profile, rules[r]) - profile->rules;
+    }
   }
   term termToRewrite = term_get_argument(t, term_get_arity(t) - 1);
+  // tasks only in a scheduler, counters are not thread-safe and reading a run
+  // or shared arguments creates arguments
+  bool const parallel =
+      scheduler_get_current_nb_workers() > 1 && !term_stats_is_enabled() &&
+      !term_sharing_is_enabled() && !term_contains_successor_run(t) &&
+      !term_contains_shared(t);
   term results = term_create_result();
   term newResults = term_create_result();
   term_add_argument_last(results, term_copy(termToRewrite));
 
   for (int i = 0; i < factor; i++) {
-    term_argument_traversal rewriteTraversal =
-        term_argument_traversal_create(t);
-    // factor > 1 means that there is a factor as first argument, so we pass it
-    if (factor > 1) {
-      term_argument_traversal_get_next(rewriteTraversal);
-    }
+    double const step_start = term_trace_start();
+    int const frontier = term_get_arity(results);
+    rewrite_step step;
+    step.matches = 0;
+    step.dedup_us = 0;
+    step.splits_left = parallel ? scheduler_get_current_split_depth() : 0;
     // I loop through rules
-    while (term_argument_traversal_has_next(rewriteTraversal)) {
-      term rule = term_argument_traversal_get_next(rewriteTraversal);
-      if (!term_argument_traversal_has_next(rewriteTraversal)) {
-        // We are at the end, we stop
-        break;
-      }
+    for (int r = 0; r < nbRules; r++) {
+      step.rule = r;
+      step.profile = profile != NULL ? &profile->rules[profiles[r]] : NULL;
+      term rule = rules[r];
       term termToReplace = term_get_argument(rule, 0);
       term replaceWith = term_get_argument(rule, 1);
-      term_argument_traversal args = term_argument_traversal_create(results);
       // I Loop trough args of the results
-      while (term_argument_traversal_has_next(args)) {
-        term termToRewrite = term_argument_traversal_get_next(args);
+      term termToRewrite;
+      term_for_each_argument(termToRewrite, results) {
         // For each args of the term to rewrite, i rewrite it
         // The possibilities are set in results
         term_rewrite_rule(termToRewrite, termToRewrite, termToReplace,
-                          replaceWith, newResults);
+                          replaceWith, newResults, &step);
       }
-      term_argument_traversal_destroy(&args);
     }
-    term_argument_traversal_destroy(&rewriteTraversal);
+    term_trace_event("rewrite step", step_start,
+                     "\"step\": %d, \"frontier\": %d, \"rules_tried\": %d, "
+                     "\"matches\": %ld, \"results\": %d, \"dedup_us\": %.3f",
+                     i, frontier, nbRules, step.matches,
+                     term_get_arity(newResults), step.dedup_us);
     term_destroy(&results);
-    results = term_copy(newResults);
-    term_destroy(&newResults);
+    results = newResults;
     newResults = term_create_result();
   }
   term_destroy(&newResults);
+  free(rules);
+  free(profiles);
+  term_trace_event("term_rewrite", trace_start,
+                   "\"factor\": %d, \"results\": %d", factor,
+                   term_get_arity(results));
   return results;
 }
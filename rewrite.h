@@ -49,6 +49,73 @@
  */
 extern term term_rewrite ( term t ) ;
 
+/*!
+ * Learned statistics of rewriting rules: for each rule (identified by the
+ * rule itself, \c -> ( pattern replacement ) ), the number of sub-terms its
+ * pattern was tried on and matched.
+ * A profile is kept between calls and can be saved to be loaded by the next
+ * run over the same rules.
+ */
+typedef struct rewrite_profile_struct * rewrite_profile ;
+
+/*!
+ * Create an empty profile.
+ * \return a new profile.
+ */
+extern rewrite_profile rewrite_profile_create ( void ) ;
+
+/*!
+ * Destroy a profile and set it to NULL.
+ * \param p (location of the) profile to destroy.
+ */
+extern void rewrite_profile_destroy ( rewrite_profile * p ) ;
+
+/*!
+ * \param p profile.
+ * \return the number of rules known by the profile.
+ */
+extern int rewrite_profile_get_nb_rules ( rewrite_profile p ) ;
+
+/*!
+ * Get the counts of a rule of a profile (rules are in the order they were
+ * first seen).
+ * \param p profile.
+ * \param i index of the rule.
+ * \param attempts where to store the number of sub-terms the pattern was tried
+ * on.
+ * \param hits where to store the number of sub-terms the pattern matched.
+ * \pre 0 ≤ \c i < number of rules.
+ * \return the rule (belongs to the profile).
+ */
+extern term rewrite_profile_get_rule ( rewrite_profile p , int i , unsigned long * attempts , unsigned long * hits ) ;
+
+/*!
+ * Save a profile, one rule per line:
+ * \verbatim attempts hits -> ( pattern replacement ) \endverbatim
+ * \param p profile.
+ * \param out stream to write to.
+ */
+extern void rewrite_profile_save ( rewrite_profile p , FILE * out ) ;
+
+/*!
+ * Add the counts saved by \c rewrite_profile_save to a profile.
+ * \param p profile.
+ * \param in stream to read from (until its end).
+ * \return false if a line is not in the format of \c rewrite_profile_save ,
+ * blank lines apart (the counts of the lines before it are kept).
+ */
+extern bool rewrite_profile_load ( rewrite_profile p , FILE * in ) ;
+
+/*!
+ * Same as \c term_rewrite , counting into a profile.
+ * The attempts and hits of the call are added to the profile.
+ * \param profile learned statistics (NULL for none).
+ * \param t encode the terms to rewrite
+ * \pre t should be of the correct form
+ * \return term whose arguments are the result of the rewriting (if any).
+ */
+extern term term_rewrite_with_profile ( rewrite_profile profile , term t ) ;
+
 
 
 # endif
@@ -0,0 +1,405 @@
+// threads are POSIX
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "scheduler.h"
+
+#undef NDEBUG // FORCE ASSERT ACTIVATION
+
+/*! Initial capacity of the deque of a worker (a power of 2). */
+#define DEQUE_CAPACITY_BASE 64
+
+/*!
+ * Worker: a thread (or the entering thread for the first one) and its deque
+ * of spawned tasks.
+ * The deque is a circular array: tasks are at indexes [ \c top , \c bottom ).
+ */
+typedef struct worker_struct {
+  /*! scheduler of the worker */
+  scheduler s;
+  /*! thread (not used for the first worker) */
+  pthread_t thread;
+  /*! protects the deque and the \c done fields of the tasks spawned here */
+  pthread_mutex_t lock;
+  /*! signaled when a task spawned here is run by another worker */
+  pthread_cond_t done;
+  /*! tasks (index modulo \c capacity ) */
+  scheduler_task **tasks;
+  /*! index of the oldest task (next one to be stolen) */
+  long top;
+  /*! index after the newest task */
+  long bottom;
+  /*! size of \c tasks (a power of 2) */
+  long capacity;
+  /*! state of the random choice of victims */
+  unsigned int seed;
+} worker;
+
+struct scheduler_struct {
+  /*! number of workers */
+  int nb_workers;
+  /*! workers, the first one is the entering thread */
+  worker *workers;
+  /*! only one thread at a time is in the scheduler */
+  pthread_mutex_t enter_lock;
+  /*! protects the fields below */
+  pthread_mutex_t lock;
+  /*! signaled when a task is spawned while workers are sleeping */
+  pthread_cond_t wake;
+  /*! number of tasks spawned so far (so that a sleeping worker misses none) */
+  unsigned long nb_spawned;
+  /*! number of workers waiting on \c wake */
+  int nb_sleeping;
+  /*! whether the threads have to stop */
+  bool stop;
+};
+
+/*! Key of the worker of the current thread (NULL if none). */
+static pthread_key_t current_key;
+
+/*! Creation of \c current_key . */
+static pthread_once_t current_key_once = PTHREAD_ONCE_INIT;
+
+static void current_key_create(void) {
+  int error = pthread_key_create(&current_key, NULL);
+  assert(error == 0);
+}
+
+/*!
+ * \return the worker of the current thread, NULL if it is not in a scheduler.
+ */
+static worker *current_worker(void) {
+  pthread_once(&current_key_once, current_key_create);
+  return pthread_getspecific(current_key);
+}
+
+/*!
+ * Add a task at the bottom of the deque of a worker.
+ */
+static void deque_push(worker *w, scheduler_task *task) {
+  pthread_mutex_lock(&w->lock);
+  if (w->bottom - w->top == w->capacity) {
+    scheduler_task **tasks = malloc(2 * w->capacity * sizeof(scheduler_task *));
+    assert(tasks != NULL);
+    for (long i = w->top; i < w->bottom; i++) {
+      tasks[i & (2 * w->capacity - 1)] = w->tasks[i & (w->capacity - 1)];
+    }
+    free(w->tasks);
+    w->tasks = tasks;
+    w->capacity *= 2;
+  }
+  w->tasks[w->bottom & (w->capacity - 1)] = task;
+  w->bottom++;
+  pthread_mutex_unlock(&w->lock);
+}
+
+/*!
+ * Remove the newest task of a worker (by the worker itself).
+ * \return the task, NULL if the deque is empty.
+ */
+static scheduler_task *deque_pop(worker *w) {
+  scheduler_task *task = NULL;
+  pthread_mutex_lock(&w->lock);
+  if (w->bottom > w->top) {
+    w->bottom--;
+    task = w->tasks[w->bottom & (w->capacity - 1)];
+  }
+  pthread_mutex_unlock(&w->lock);
+  return task;
+}
+
+/*!
+ * Remove the oldest task of a worker (by another worker).
+ * \return the task, NULL if the deque is empty.
+ */
+static scheduler_task *deque_steal(worker *w) {
+  scheduler_task *task = NULL;
+  pthread_mutex_lock(&w->lock);
+  if (w->bottom > w->top) {
+    task = w->tasks[w->top & (w->capacity - 1)];
+    w->top++;
+  }
+  pthread_mutex_unlock(&w->lock);
+  return task;
+}
+
+/*!
+ * Find a task to run: the newest one of the worker, or else the oldest one of
+ * another worker (tried from a random one).
+ * \return the task, NULL if there is none.
+ */
+static scheduler_task *worker_find_task(worker *w) {
+  scheduler_task *task = deque_pop(w);
+  scheduler s = w->s;
+  w->seed = w->seed * 1103515245 + 12345;
+  int const first = (w->seed >> 16) % s->nb_workers;
+  for (int i = 0; task == NULL && i < s->nb_workers; i++) {
+    worker *victim = &s->workers[(first + i) % s->nb_workers];
+    if (victim != w) {
+      task = deque_steal(victim);
+    }
+  }
+  return task;
+}
+
+/*!
+ * Run a task taken from a deque and tell its owner.
+ */
+static void task_run(scheduler_task *task) {
+  task->function(task->data);
+  worker *owner = task->owner;
+  pthread_mutex_lock(&owner->lock);
+  task->done = true;
+  pthread_cond_signal(&owner->done);
+  pthread_mutex_unlock(&owner->lock);
+}
+
+static void *worker_run(void *data) {
+  worker *w = data;
+  scheduler s = w->s;
+  pthread_once(&current_key_once, current_key_create);
+  pthread_setspecific(current_key, w);
+  for (;;) {
+    pthread_mutex_lock(&s->lock);
+    unsigned long const nb_spawned = s->nb_spawned;
+    bool const stop = s->stop;
+    pthread_mutex_unlock(&s->lock);
+    if (stop) {
+      return NULL;
+    }
+    scheduler_task *task = worker_find_task(w);
+    if (task != NULL) {
+      task_run(task);
+      continue;
+    }
+    pthread_mutex_lock(&s->lock);
+    if (!s->stop && s->nb_spawned == nb_spawned) {
+      s->nb_sleeping++;
+      pthread_cond_wait(&s->wake, &s->lock);
+      s->nb_sleeping--;
+    }
+    pthread_mutex_unlock(&s->lock);
+  }
+}
+
+scheduler scheduler_create(int nb_workers) {
+  assert(nb_workers > 0);
+  scheduler s = malloc(sizeof(struct scheduler_struct));
+  assert(s != NULL);
+  s->nb_workers = nb_workers;
+  s->nb_spawned = 0;
+  s->nb_sleeping = 0;
+  s->stop = false;
+  int error = pthread_mutex_init(&s->enter_lock, NULL);
+  assert(error == 0);
+  error = pthread_mutex_init(&s->lock, NULL);
+  assert(error == 0);
+  error = pthread_cond_init(&s->wake, NULL);
+  assert(error == 0);
+  s->workers = malloc(nb_workers * sizeof(worker));
+  assert(s->workers != NULL);
+  for (int i = 0; i < nb_workers; i++) {
+    worker *w = &s->workers[i];
+    w->s = s;
+    error = pthread_mutex_init(&w->lock, NULL);
+    assert(error == 0);
+    error = pthread_cond_init(&w->done, NULL);
+    assert(error == 0);
+    w->capacity = DEQUE_CAPACITY_BASE;
+    w->tasks = malloc(w->capacity * sizeof(scheduler_task *));
+    assert(w->tasks != NULL);
+    w->top = w->bottom = 0;
+    w->seed = i;
+  }
+  for (int i = 1; i < nb_workers; i++) {
+    error = pthread_create(&s->workers[i].thread, NULL, worker_run,
+                           &s->workers[i]);
+    assert(error == 0);
+  }
+  return s;
+}
+
+void scheduler_destroy(scheduler *s) {
+  assert(s != NULL);
+  if (*s != NULL) {
+    scheduler sc = *s;
+    pthread_mutex_lock(&sc->lock);
+    sc->stop = true;
+    pthread_cond_broadcast(&sc->wake);
+    pthread_mutex_unlock(&sc->lock);
+    for (int i = 1; i < sc->nb_workers; i++) {
+      pthread_join(sc->workers[i].thread, NULL);
+    }
+    for (int i = 0; i < sc->nb_workers; i++) {
+      assert(sc->workers[i].bottom == sc->workers[i].top);
+      pthread_cond_destroy(&sc->workers[i].done);
+      pthread_mutex_destroy(&sc->workers[i].lock);
+      free(sc->workers[i].tasks);
+    }
+    free(sc->workers);
+    pthread_cond_destroy(&sc->wake);
+    pthread_mutex_destroy(&sc->lock);
+    pthread_mutex_destroy(&sc->enter_lock);
+    free(sc);
+    *s = NULL;
+  }
+}
+
+int scheduler_get_nb_workers(scheduler s) {
+  assert(s != NULL);
+  return s->nb_workers;
+}
+
+void scheduler_enter(scheduler s) {
+  assert(s != NULL);
+  assert(current_worker() == NULL);
+  pthread_mutex_lock(&s->enter_lock);
+  pthread_setspecific(current_key, &s->workers[0]);
+}
+
+void scheduler_leave(scheduler s) {
+  assert(s != NULL);
+  assert(current_worker() == &s->workers[0]);
+  assert(s->workers[0].bottom == s->workers[0].top);
+  pthread_setspecific(current_key, NULL);
+  pthread_mutex_unlock(&s->enter_lock);
+}
+
+int scheduler_get_current_nb_workers(void) {
+  worker *w = current_worker();
+  return w == NULL ? 1 : w->s->nb_workers;
+}
+
+int scheduler_get_current_split_depth(void) {
+  int const nb_workers = scheduler_get_current_nb_workers();
+  if (nb_workers == 1) {
+    return 0;
+  }
+  // about four tasks per worker
+  int depth = 2;
+  while ((1 << depth) < 4 * nb_workers) {
+    depth++;
+  }
+  return depth;
+}
+
+int scheduler_split(int *splits_left, int n) {
+  assert(splits_left != NULL);
+  assert(n >= 0);
+  if (*splits_left <= 0 || n <= 1) {
+    return n < 1 ? n : 1;
+  }
+  int bits = 0;
+  while (bits < *splits_left && (1 << bits) < n) {
+    bits++;
+  }
+  *splits_left -= bits;
+  return n < (1 << bits) ? n : 1 << bits;
+}
+
+void scheduler_spawn(scheduler_task *task, void (*function)(void *data),
+                     void *data) {
+  assert(task != NULL);
+  assert(function != NULL);
+  worker *w = current_worker();
+  task->function = function;
+  task->data = data;
+  task->done = false;
+  if (w == NULL || w->s->nb_workers == 1) {
+    task->owner = NULL;
+    function(data);
+    task->done = true;
+    return;
+  }
+  task->owner = w;
+  deque_push(w, task);
+  scheduler s = w->s;
+  pthread_mutex_lock(&s->lock);
+  s->nb_spawned++;
+  if (s->nb_sleeping > 0) {
+    pthread_cond_signal(&s->wake);
+  }
+  pthread_mutex_unlock(&s->lock);
+}
+
+void scheduler_sync(scheduler_task *task) {
+  assert(task != NULL);
+  worker *w = task->owner;
+  if (w == NULL) {
+    // run at once by scheduler_spawn
+    return;
+  }
+  assert(w == current_worker());
+  // usual case: the task was not stolen, it is the newest one
+  pthread_mutex_lock(&w->lock);
+  bool const newest = w->bottom > w->top &&
+                      w->tasks[(w->bottom - 1) & (w->capacity - 1)] == task;
+  if (newest) {
+    w->bottom--;
+  }
+  bool done = task->done;
+  pthread_mutex_unlock(&w->lock);
+  if (newest) {
+    task->function(task->data);
+    return;
+  }
+  // stolen: help with other tasks, wait once there is none
+  while (!done) {
+    scheduler_task *other = worker_find_task(w);
+    if (other != NULL) {
+      task_run(other);
+    }
+    pthread_mutex_lock(&w->lock);
+    while (other == NULL && !task->done) {
+      pthread_cond_wait(&w->done, &w->lock);
+    }
+    done = task->done;
+    pthread_mutex_unlock(&w->lock);
+  }
+}
+
+/*!
+ * Calls [ \c first , \c last ) of \c scheduler_parallel_for .
+ */
+typedef struct {
+  void (*function)(void *data, int i);
+  void *data;
+  int first;
+  int last;
+} parallel_for_range;
+
+static void parallel_for_run(void *data) {
+  parallel_for_range *range = data;
+  if (range->last - range->first == 1) {
+    range->function(range->data, range->first);
+    return;
+  }
+  int const middle = range->first + (range->last - range->first) / 2;
+  parallel_for_range upper = {range->function, range->data, middle,
+                              range->last};
+  parallel_for_range lower = {range->function, range->data, range->first,
+                              middle};
+  scheduler_task task;
+  scheduler_spawn(&task, parallel_for_run, &upper);
+  parallel_for_run(&lower);
+  scheduler_sync(&task);
+}
+
+void scheduler_parallel_for(int n, void (*function)(void *data, int i),
+                            void *data) {
+  assert(n >= 0);
+  assert(function != NULL);
+  if (scheduler_get_current_nb_workers() == 1) {
+    for (int i = 0; i < n; i++) {
+      function(data, i);
+    }
+    return;
+  }
+  if (n > 0) {
+    parallel_for_range all = {function, data, 0, n};
+    parallel_for_run(&all);
+  }
+}
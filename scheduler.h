@@ -0,0 +1,147 @@
+#ifndef __SCHEDULER_H
+#define __SCHEDULER_H
+
+#include <stdbool.h>
+
+/*!
+ * \file
+ * \brief Work-stealing scheduler of fork-join tasks.
+ *
+ * A scheduler has a fixed number of workers: the thread that enters it and
+ * \c nb_workers - 1 threads of its own. Each worker has a deque of tasks:
+ * it pushes and pops the tasks it spawns at the bottom, idle workers steal
+ * the oldest ones at the top (the largest ones in a recursive split).
+ *
+ * Typical use:
+ * \verbatim
+ scheduler s = scheduler_create(4);
+ scheduler_enter(s);
+ term res = term_rewrite(t); // the engines split their work into tasks
+ scheduler_leave(s);
+ scheduler_destroy(&s);
+ \endverbatim
+ *
+ * Outside of a scheduler (the thread did not enter one and is not one of its
+ * workers), a spawned task is run at once: code written with tasks runs
+ * sequentially.
+ *
+ * Tasks should be coarse (from microseconds): spawning costs a few locks.
+ */
+
+/*!
+ * Scheduler are accessed through pointers / reference.
+ * The exact structure type is hidden in the .c .
+ */
+typedef struct scheduler_struct *scheduler;
+
+/*!
+ * Task, to be used as a local variable of the spawning function until it is
+ * synchronized. Its fields are private.
+ */
+typedef struct {
+  /*! private: function run by the task */
+  void (*function)(void *data);
+  /*! private: argument of \c function */
+  void *data;
+  /*! private: worker that spawned the task, NULL if it was run at once */
+  void *owner;
+  /*! private: whether the task was run (protected by the owner) */
+  bool done;
+} scheduler_task;
+
+/*!
+ * Create a scheduler and start its threads.
+ * \param nb_workers number of workers, the entering thread included.
+ * \pre \c nb_workers is positive.
+ * \return a new scheduler.
+ */
+extern scheduler scheduler_create(int nb_workers);
+
+/*!
+ * Stop the threads of a scheduler and release it.
+ * \param s (location of the) scheduler to destroy.
+ * \pre no thread is in the scheduler.
+ */
+extern void scheduler_destroy(scheduler *s);
+
+/*!
+ * \param s a scheduler.
+ * \return the number of workers of the scheduler.
+ */
+extern int scheduler_get_nb_workers(scheduler s);
+
+/*!
+ * Make the calling thread the first worker of a scheduler, until
+ * \c scheduler_leave . Only one thread at a time is in a scheduler (others
+ * wait).
+ * \param s scheduler to enter.
+ * \pre the calling thread is not in a scheduler.
+ */
+extern void scheduler_enter(scheduler s);
+
+/*!
+ * Leave the scheduler entered by \c scheduler_enter .
+ * \param s scheduler to leave.
+ * \pre the calling thread entered \c s and all its tasks are synchronized.
+ */
+extern void scheduler_leave(scheduler s);
+
+/*!
+ * \return the number of workers of the scheduler the calling thread is in, 1
+ * if it is not in a scheduler.
+ */
+extern int scheduler_get_current_nb_workers(void);
+
+/*!
+ * Number of nested splits of a work in two parts that give enough tasks for
+ * the workers of the current scheduler to balance the work (the log2 of the
+ * number of tasks, about four per worker).
+ * \return the number of splits, 0 if the calling thread is not in a scheduler
+ * or if it has a single worker.
+ */
+extern int scheduler_get_current_split_depth(void);
+
+/*!
+ * Number of parts to split a work of \c n items into, within a budget of
+ * splits (initially given by \c scheduler_get_current_split_depth ).
+ * The budget is decreased by the log2 of the number of parts, so that nested
+ * splits of the parts give about as many tasks as a single split.
+ * \param splits_left budget of splits (updated).
+ * \param n number of items.
+ * \pre \c splits_left is non NULL and \c n is non negative.
+ * \return the number of parts, from 1 (no split) to \c n ( \c n if less
+ * than 1).
+ */
+extern int scheduler_split(int *splits_left, int n);
+
+/*!
+ * Spawn a task: \c function may be run by another worker until
+ * \c scheduler_sync is called.
+ * \param task task (kept until \c scheduler_sync ).
+ * \param function function to run.
+ * \param data argument of \c function .
+ * \pre \c task and \c function are non NULL.
+ */
+extern void scheduler_spawn(scheduler_task *task, void (*function)(void *data),
+                            void *data);
+
+/*!
+ * Wait until a spawned task is run. If no worker stole it, it is run by the
+ * calling thread, otherwise the calling thread runs other tasks meanwhile.
+ * \param task task given to \c scheduler_spawn by the same thread.
+ * \pre \c task is non NULL.
+ */
+extern void scheduler_sync(scheduler_task *task);
+
+/*!
+ * Run \c function ( \c data , \c i ) for each \c i from 0 to \c n - 1 as
+ * tasks (split recursively in halves) and wait for all of them.
+ * \param n number of calls.
+ * \param function function to run.
+ * \param data first argument of \c function .
+ * \pre \c n is non negative and \c function is non NULL.
+ */
+extern void scheduler_parallel_for(int n, void (*function)(void *data, int i),
+                                   void *data);
+
+#endif
@@ -1,63 +1,119 @@
 #include <assert.h>
 #include <ctype.h>
+#include <limits.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
 
 #include "sstring.h"
+#include "term_stats.h"
 #undef NDEBUG // FORCE ASSERT ACTIVATION
 
+/*!
+ * Chars are stored in blocks of this size (the width of an SSE2 register).
+ * Chars after the end of the string in the last block are \c '\0', so that
+ * the kernels below read whole blocks without testing the length.
+ */
+#define SSTRING_BLOCK 16
+
+/*!
+ * Number of chars stored inside the structure, without any other allocation.
+ * Most symbols are this short.
+ */
+#define SSTRING_INLINE_CAPACITY SSTRING_BLOCK
+
 /*! Used to test the validity in asserts */
 #define ASSERT_SSTRING_OK(ss)                                                  \
   assert(NULL != ss);                                                          \
-  assert((0 == ss->length) == (NULL == ss->chars))
+  assert(ss->length <= ss->capacity);                                          \
+  assert(0 == ss->capacity % SSTRING_BLOCK);                                   \
+  assert((SSTRING_INLINE_CAPACITY == ss->capacity) ==                          \
+         (ss->inline_chars == ss->chars))
 
 /*!
  * Structure to store a sstring.
  * There is no room for the final \c '\0' of C-string.
  * \param length  length of the string, the number of char exactly
- * \param chars pointer to the the sequence of char
+ * \param capacity number of char that \c chars can hold, a multiple of
+ * \c SSTRING_BLOCK, chars from \c length to \c capacity are \c '\0'
+ * \param chars pointer to the the sequence of char, either \c inline_chars or
+ * an allocated array when the string is too long
+ * \param inline_chars storage for short strings
  */
 typedef struct sstring_struct {
   unsigned int length;
+  unsigned int capacity;
   char *chars;
+  char inline_chars[SSTRING_INLINE_CAPACITY];
 } sstring_struct;
 
+/*!
+ * Round a length up to a whole number of blocks (at least one).
+ */
+static unsigned int sstring_round_to_block(unsigned int length) {
+  if (0 == length) {
+    return SSTRING_BLOCK;
+  }
+  assert(length <= UINT_MAX - SSTRING_BLOCK);
+  return (length + SSTRING_BLOCK - 1) / SSTRING_BLOCK * SSTRING_BLOCK;
+}
+
+/*!
+ * Allocate a \c sstring able to hold \c length chars, its chars are \c '\0'.
+ * \param length length of the string.
+ * \return the new \c sstring
+ */
+static sstring sstring_allocate(unsigned int length) {
+  sstring res = malloc(sizeof(sstring_struct));
+  assert(NULL != res);
+  res->length = length;
+  res->capacity = sstring_round_to_block(length);
+  TERM_STATS_ADD(bytes_allocated, sizeof(sstring_struct));
+  if (res->capacity == SSTRING_INLINE_CAPACITY) {
+    res->chars = res->inline_chars;
+  } else {
+    res->chars = malloc(res->capacity * sizeof(char));
+    assert(NULL != res->chars);
+    TERM_STATS_ADD(bytes_allocated, res->capacity);
+  }
+  memset(res->chars, 0, res->capacity);
+  return res;
+}
+
 bool sstring_is_empty(sstring ss) {
   ASSERT_SSTRING_OK(ss);
   return 0 == ss->length;
 }
 
 sstring sstring_create_empty(void) {
-  sstring res = malloc(sizeof(sstring_struct));
-  assert(NULL != res);
-  res->length = 0;
-  res->chars = NULL;
+  sstring res = sstring_allocate(0);
   ASSERT_SSTRING_OK(res);
   return res;
 }
 
 sstring sstring_create_string(char const *st) {
-  if (strlen(st) < 1)
-    return sstring_create_empty();
-  else {
-    sstring ch = (sstring)malloc(sizeof(struct sstring_struct));
-    assert(ch != NULL);
-    ch->length = strlen(st);
-    ch->chars = (char *)malloc(sizeof(char) * strlen(st));
-    assert(ch->chars != NULL);
-    for (int i = 0; (unsigned)i < ch->length; i++) {
-      ch->chars[i] = st[i];
-    }
-    return ch;
-  }
+  assert(NULL != st);
+  size_t length = strlen(st);
+  assert(length <= UINT_MAX);
+  sstring res = sstring_allocate(length);
+  memcpy(res->chars, st, length);
+  ASSERT_SSTRING_OK(res);
+  return res;
 }
 
 void sstring_destroy(sstring *ss) {
   // assert(NULL != ss);
   if (ss != NULL) {
     // ASSERT_SSTRING_OK((*ss));
-    // NB free ( NULL ) is legal
-    free((*ss)->chars);
+    if ((*ss)->chars != (*ss)->inline_chars) {
+      free((*ss)->chars);
+    }
     free(*ss);
     *ss = NULL;
   }
@@ -66,73 +122,113 @@ void sstring_destroy(sstring *ss) {
 void sstring_print(sstring ss, FILE *f) {
   ASSERT_SSTRING_OK(ss);
   assert(NULL != f);
-  if (!sstring_is_empty(ss)) {
-    for (unsigned int i = 0; i < ss->length; i++) {
-      fputc(ss->chars[i], f);
-    }
-  }
+  fwrite(ss->chars, sizeof(char), ss->length, f);
 }
 
 void sstring_concatenate(sstring ss1, sstring ss2) {
-  if (sstring_is_empty(ss1) && !sstring_is_empty(ss2)) {
-    ss1->length = ss2->length;
-    ss1->chars = (char *)malloc(sizeof(char) * (ss1->length));
-    for (unsigned int i = 0; i < ss1->length; i++) {
-      ss1->chars[i] = ss2->chars[i];
+  ASSERT_SSTRING_OK(ss1);
+  ASSERT_SSTRING_OK(ss2);
+  unsigned int length2 = ss2->length;
+  unsigned int length = ss1->length + length2;
+  assert(length >= ss1->length);
+  if (length > ss1->capacity) {
+    // geometric growth: appending char by char is linear overall
+    unsigned int capacity = ss1->capacity <= UINT_MAX / 4 ? 2 * ss1->capacity
+                                                          : UINT_MAX;
+    if (capacity < length) {
+      capacity = length;
     }
-  } else if (!sstring_is_empty(ss1)) {
-    int lengthss1 = sstring_get_length(ss1),
-        lengthss2 = sstring_get_length(ss2), i;
-    ss1->chars =
-        (char *)realloc(ss1->chars, sizeof(char) * (lengthss1 + lengthss2));
-    ss1->length = (lengthss1 + lengthss2);
-    for (i = 0; i < lengthss2; i++) {
-      ss1->chars[i + lengthss1] = ss2->chars[i];
+    capacity = sstring_round_to_block(capacity);
+    TERM_STATS_ADD(bytes_allocated, capacity);
+    if (ss1->chars == ss1->inline_chars) {
+      ss1->chars = malloc(capacity * sizeof(char));
+      assert(NULL != ss1->chars);
+      memcpy(ss1->chars, ss1->inline_chars, ss1->length);
+    } else {
+      ss1->chars = realloc(ss1->chars, capacity * sizeof(char));
+      assert(NULL != ss1->chars);
     }
+    memset(ss1->chars + ss1->length, 0, capacity - ss1->length);
+    ss1->capacity = capacity;
   }
+  // ss2 may be ss1, its chars are read after the reallocation
+  memcpy(ss1->chars + ss1->length, ss2->chars, length2);
+  ss1->length = length;
+  ASSERT_SSTRING_OK(ss1);
 }
 
 sstring sstring_copy(sstring ss) {
   ASSERT_SSTRING_OK(ss);
-  if (sstring_is_empty(ss)) {
-    return sstring_create_empty();
-  } else {
-    sstring res = malloc(sizeof(sstring_struct));
-    assert(NULL != res);
-    res->length = ss->length;
-    res->chars = malloc(res->length * sizeof(char) + 1);
-    assert(NULL != res->chars);
-    for (unsigned int i = 0; i < res->length; i++) {
-      res->chars[i] = ss->chars[i];
+  sstring res = sstring_allocate(ss->length);
+  memcpy(res->chars, ss->chars, ss->length);
+  ASSERT_SSTRING_OK(res);
+  return res;
+}
+
+/*!
+ * Index of the first position before \c n where two char arrays differ, or a
+ * value \c >= \c n if they do not.
+ * Whole blocks are read, so both arrays must be readable up to \c n rounded
+ * to a block.
+ */
+static unsigned int sstring_mismatch(char const *a, char const *b,
+                                     unsigned int n) {
+  unsigned int i = 0;
+#if defined(__AVX2__)
+  for (; i + 32 <= n; i += 32) {
+    __m256i va = _mm256_loadu_si256((__m256i const *)(a + i));
+    __m256i vb = _mm256_loadu_si256((__m256i const *)(b + i));
+    unsigned int diff = ~(unsigned int)_mm256_movemask_epi8(
+        _mm256_cmpeq_epi8(va, vb));
+    if (0 != diff) {
+      return i + __builtin_ctz(diff);
     }
-    ASSERT_SSTRING_OK(res);
-    return res;
   }
+#endif
+#if defined(__SSE2__)
+  for (; i < n; i += SSTRING_BLOCK) {
+    __m128i va = _mm_loadu_si128((__m128i const *)(a + i));
+    __m128i vb = _mm_loadu_si128((__m128i const *)(b + i));
+    unsigned int diff =
+        0xFFFFu & ~(unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb));
+    if (0 != diff) {
+      return i + __builtin_ctz(diff);
+    }
+  }
+#else
+  for (; i < n; i++) {
+    if (a[i] != b[i]) {
+      return i;
+    }
+  }
+#endif
+  return i;
 }
 
 int sstring_compare(sstring ss1, sstring ss2) {
   ASSERT_SSTRING_OK(ss1);
   ASSERT_SSTRING_OK(ss2);
-  int i = 0;
-  if (!sstring_is_empty(ss1) && !sstring_is_empty(ss2)) {
-    do {
-      if ((ss1->chars[i] > ss2->chars[i]) &&
-          (ss1->chars[i] != ss2->chars[i] + 32)) {
-        return 1;
-      } else if ((ss1->chars[i] < ss2->chars[i]) &&
-                 (ss1->chars[i] != ss2->chars[i] - 32)) {
-        return -1;
-      }
-      i++;
-    } while (i < sstring_get_length(ss1) || i < sstring_get_length(ss2));
-    return 0;
-  } else if (sstring_is_empty(ss1) && !sstring_is_empty(ss2)) {
-    return -1;
-  } else if (sstring_is_empty(ss2) && !sstring_is_empty(ss1)) {
-    return 1;
-  } else {
+  TERM_STATS_ADD(sstring_compare_calls, 1);
+  // interned symbols are shared
+  if (ss1 == ss2) {
     return 0;
   }
+  unsigned int n = ss1->length < ss2->length ? ss1->length : ss2->length;
+  unsigned int i = sstring_mismatch(ss1->chars, ss2->chars, n);
+  if (i < n) {
+    return (unsigned char)ss1->chars[i] < (unsigned char)ss2->chars[i] ? -1
+                                                                        : 1;
+  }
+  return ss1->length < ss2->length ? -1 : (ss1->length > ss2->length ? 1 : 0);
+}
+
+bool sstring_equals(sstring ss1, sstring ss2) {
+  ASSERT_SSTRING_OK(ss1);
+  ASSERT_SSTRING_OK(ss2);
+  TERM_STATS_ADD(sstring_compare_calls, 1);
+  // padding is '\0' on both sides, so whole blocks can be compared
+  return ss1 == ss2 || (ss1->length == ss2->length &&
+         sstring_mismatch(ss1->chars, ss2->chars, ss1->length) >= ss1->length);
 }
 
 int sstring_get_length(sstring ss) {
@@ -144,16 +240,119 @@ char sstring_get_char(sstring ss, int i) { return ss->chars[i]; }
 
 bool sstring_is_integer(sstring ss, int *n_pt) {
   ASSERT_SSTRING_OK(ss);
-  bool is_digit = false;
-  for (int i = 0; i < sstring_get_length(ss); i++) {
-    is_digit = isdigit(ss->chars[i]);
-  }
-  if (is_digit) {
-    *n_pt = 0;
-    for (int i = 0; i < sstring_get_length(ss); i++) {
-      *n_pt = (ss->chars[i] - '0') + *n_pt * 10;
-      is_digit = isdigit(ss->chars[i]);
+  if (sstring_is_empty(ss)) {
+    return false;
+  }
+  int n = 0;
+  for (unsigned int i = 0; i < ss->length; i++) {
+    if (!isdigit((unsigned char)ss->chars[i])) {
+      return false;
+    }
+    int digit = ss->chars[i] - '0';
+    if (n > (INT_MAX - digit) / 10) {
+      return false;
+    }
+    n = n * 10 + digit;
+  }
+  *n_pt = n;
+  return true;
+}
+
+unsigned int sstring_hash(sstring ss) {
+  ASSERT_SSTRING_OK(ss);
+  // 8 chars at a time, the '\0' padding of the block is hashed too
+  uint64_t h = 0x9E3779B97F4A7C15u ^ ss->length;
+  unsigned int end = sstring_round_to_block(ss->length);
+  for (unsigned int i = 0; i < end; i += sizeof(uint64_t)) {
+    uint64_t w;
+    memcpy(&w, ss->chars + i, sizeof(uint64_t));
+    h = (h ^ w) * 0xFF51AFD7ED558CCDu;
+    h ^= h >> 32;
+  }
+  return (unsigned int)h;
+}
+
+#if defined(__SSE2__)
+/*!
+ * Mask of the chars of a block that are blank (as \c isspace ) or parenthesis.
+ */
+static unsigned int sstring_block_not_token(char const *p) {
+  __m128i c = _mm_loadu_si128((__m128i const *)p);
+  __m128i bad = _mm_or_si128(
+      _mm_cmpeq_epi8(c, _mm_set1_epi8(' ')),
+      _mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8('(')),
+                   _mm_cmpeq_epi8(c, _mm_set1_epi8(')'))));
+  // '\t' '\n' '\v' '\f' '\r' as an unsigned range
+  __m128i x = _mm_sub_epi8(c, _mm_set1_epi8('\t'));
+  bad = _mm_or_si128(bad,
+                     _mm_cmpeq_epi8(_mm_min_epu8(x, _mm_set1_epi8(4)), x));
+  return (unsigned int)_mm_movemask_epi8(bad);
+}
+
+/*!
+ * Mask of the chars of a block that are letters, digits or \c '_' .
+ */
+static unsigned int sstring_block_word(char const *p) {
+  __m128i c = _mm_loadu_si128((__m128i const *)p);
+  __m128i letter =
+      _mm_sub_epi8(_mm_or_si128(c, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+  __m128i digit = _mm_sub_epi8(c, _mm_set1_epi8('0'));
+  __m128i good = _mm_or_si128(
+      _mm_cmpeq_epi8(_mm_min_epu8(letter, _mm_set1_epi8(25)), letter),
+      _mm_or_si128(
+          _mm_cmpeq_epi8(_mm_min_epu8(digit, _mm_set1_epi8(9)), digit),
+          _mm_cmpeq_epi8(c, _mm_set1_epi8('_'))));
+  return (unsigned int)_mm_movemask_epi8(good);
+}
+#endif
+
+bool sstring_is_token(sstring ss) {
+  ASSERT_SSTRING_OK(ss);
+  if (0 == ss->length) {
+    return false;
+  }
+#if defined(__SSE2__)
+  // '\0' padding is neither blank nor parenthesis
+  for (unsigned int i = 0; i < ss->length; i += SSTRING_BLOCK) {
+    if (0 != sstring_block_not_token(ss->chars + i)) {
+      return false;
+    }
+  }
+#else
+  for (unsigned int i = 0; i < ss->length; i++) {
+    char c = ss->chars[i];
+    if (isspace((unsigned char)c) || c == '(' || c == ')') {
+      return false;
+    }
+  }
+#endif
+  return true;
+}
+
+bool sstring_is_word_from(sstring ss, int from) {
+  ASSERT_SSTRING_OK(ss);
+  assert(0 <= from);
+  unsigned int i = from;
+#if defined(__SSE2__)
+  for (; i < ss->length; i += SSTRING_BLOCK) {
+    unsigned int start = i % SSTRING_BLOCK;
+    unsigned int block = i - start;
+    unsigned int end = ss->length - block;
+    unsigned int wanted = (end < SSTRING_BLOCK ? (1u << end) : 0x10000u) -
+                          (1u << start);
+    if (wanted != (wanted & sstring_block_word(ss->chars + block))) {
+      return false;
+    }
+    i = block;
+  }
+#else
+  for (; i < ss->length; i++) {
+    char c = ss->chars[i];
+    if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+          (c >= '0' && c <= '9') || c == '_')) {
+      return false;
     }
   }
-  return is_digit;
+#endif
+  return true;
 }
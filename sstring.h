@@ -12,7 +12,11 @@
  * and a pointer to the actual char sequence.
  * Please note that there is no \c '\0' to mark the end of the \c sstring.
  *
- * Empty string is encoded by 0 \c length and \c NULL \c pointer.
+ * Empty string is encoded by 0 \c length.
+ * Short strings (most symbols) are stored inside the structure, so that they
+ * need a single allocation. Concatenation grows the storage geometrically.
+ * Comparison, hash and char class tests work on whole blocks of chars (with
+ * SSE2 and AVX2 when the compiler targets them, plain C otherwise).
  *
  * assert is enforced.
  *
@@ -81,6 +85,8 @@ extern sstring sstring_copy(sstring ss);
 
 /*!
  * Indicate how two \c sstring are ordered alphabetically.
+ * The order is the one of \c strcmp (chars are compared as \c unsigned
+ * \c char and a prefix comes first).
  *
  * \param ss1 \c sstring
  * \param ss2 \c sstring
@@ -92,6 +98,19 @@ extern sstring sstring_copy(sstring ss);
  */
 extern int sstring_compare(sstring ss1, sstring ss2);
 
+/*!
+ * Indicate whether two \c sstring are equal.
+ * Same as \c sstring_compare returning 0, but faster.
+ *
+ * This function has no side effect and can be safely used in asserts.
+ *
+ * \param ss1 \c sstring
+ * \param ss2 \c sstring
+ * \pre ss1 and ss2 are valid \c sstring (assert-ed)
+ * \return true iff ss1 and ss2 hold the same chars
+ */
+extern bool sstring_equals(sstring ss1, sstring ss2);
+
 /*!
  * Indicate whether a string is empty.
  *
@@ -130,7 +149,8 @@ extern int sstring_get_length(sstring ss);
 extern char sstring_get_char(sstring ss, int i);
 
 /*!
- * Test whether the sstring represent a positive integer in decimal notation.
+ * Test whether the sstring represent a positive integer in decimal notation
+ * that fits in an \c int .
  * If true, then the value is stored in *n_pt
  *
  * This function has no side effect and can be safely used in asserts.
@@ -138,7 +158,47 @@ extern char sstring_get_char(sstring ss, int i);
  * \param ss \c sstring to query.
  * \param n_pt where to put the integer value.
  * \return true if the sstring represent a decimal writing of a positive integer
+ * (false if it is too big for an \c int )
  */
 extern bool sstring_is_integer(sstring ss, int *n_pt);
 
+/*!
+ * Compute a hash value for a \c sstring.
+ * Two \c sstring that are equal according to \c sstring_compare have the same
+ * hash value.
+ *
+ * This function has no side effect and can be safely used in asserts.
+ *
+ * \param ss \c sstring to hash
+ * \pre ss is a valid \c sstring (assert-ed)
+ * \return hash value of \c ss
+ */
+extern unsigned int sstring_hash(sstring ss);
+
+/*!
+ * Test whether a \c sstring is non empty and holds no blank (as \c isspace )
+ * nor parenthesis, i.e. whether it can be a term symbol.
+ *
+ * This function has no side effect and can be safely used in asserts.
+ *
+ * \param ss \c sstring to test
+ * \pre ss is a valid \c sstring (assert-ed)
+ * \return true if ss is a token
+ */
+extern bool sstring_is_token(sstring ss);
+
+/*!
+ * Test whether all chars of a \c sstring, starting at a given position, are
+ * ASCII letters, digits or \c '_' .
+ *
+ * This function has no side effect and can be safely used in asserts.
+ *
+ * \param ss \c sstring to test
+ * \param from position of the first char to test (true if past the end)
+ * \pre ss is a valid \c sstring (assert-ed)
+ * \pre from is non negative (assert-ed)
+ * \return true if the chars from \c from on are all word chars
+ */
+extern bool sstring_is_word_from(sstring ss, int from);
+
 #endif
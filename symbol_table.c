@@ -0,0 +1,215 @@
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "symbol_table.h"
+
+#undef NDEBUG // FORCE ASSERT ACTIVATION
+
+/*!
+ * Initial number of buckets (a power of 2, at least \c SYMBOL_TABLE_STRIPES
+ * so that all the symbols of a bucket have the same lock).
+ */
+#define SYMBOL_TABLE_BUCKETS_BASE 256
+
+/*!
+ * Link of a bucket chain. It is not modified once published.
+ */
+typedef struct symbol_cell_struct {
+  /*! symbol */
+  symbol_entry *entry;
+  /*! hash of the text of the symbol */
+  unsigned int hash;
+  /*! next link in the chain */
+  struct symbol_cell_struct *next;
+} symbol_cell;
+
+/*!
+ * Buckets of a table, with the chains of the buckets they replaced (which
+ * may still be read).
+ */
+typedef struct symbol_buckets_struct {
+  /*! number of buckets (a power of 2) */
+  unsigned int nb_buckets;
+  /*! heads of the chains (read with acquire, written with release) */
+  symbol_cell **heads;
+  /*! buckets replaced by these ones (NULL if none) */
+  struct symbol_buckets_struct *retired;
+} symbol_buckets;
+
+struct symbol_table_struct {
+  /*! current buckets (read with acquire, written with release) */
+  symbol_buckets *buckets;
+  /*! locks to add symbols, by hash; all of them to grow */
+  pthread_mutex_t stripes[SYMBOL_TABLE_STRIPES];
+  /*! number of symbols (atomic) */
+  int nb_entries;
+  void *(*data_create)(sstring text);
+  void (*data_destroy)(void *data);
+};
+
+static symbol_buckets *symbol_buckets_create(unsigned int nb_buckets,
+                                             symbol_buckets *retired) {
+  symbol_buckets *b = malloc(sizeof(symbol_buckets));
+  assert(b != NULL);
+  b->nb_buckets = nb_buckets;
+  b->heads = calloc(nb_buckets, sizeof(symbol_cell *));
+  assert(b->heads != NULL);
+  b->retired = retired;
+  return b;
+}
+
+/*!
+ * Free buckets and their chains (not the symbols).
+ */
+static void symbol_buckets_destroy(symbol_buckets *b) {
+  for (unsigned int i = 0; i < b->nb_buckets; i++) {
+    symbol_cell *c = b->heads[i];
+    while (c != NULL) {
+      symbol_cell *next = c->next;
+      free(c);
+      c = next;
+    }
+  }
+  free(b->heads);
+  free(b);
+}
+
+/*!
+ * Find a symbol in buckets, without lock.
+ * \return the symbol, NULL if it is not there.
+ */
+static symbol_entry *symbol_buckets_find(symbol_buckets *b, sstring text,
+                                         unsigned int hash) {
+  symbol_cell *c = __atomic_load_n(&b->heads[hash & (b->nb_buckets - 1)],
+                                   __ATOMIC_ACQUIRE);
+  for (; c != NULL; c = c->next) {
+    if (c->hash == hash && sstring_equals(c->entry->text, text)) {
+      return c->entry;
+    }
+  }
+  return NULL;
+}
+
+/*!
+ * Add a link at the head of a chain and publish it.
+ * \pre the lock of the chain is held.
+ */
+static void symbol_buckets_add(symbol_buckets *b, symbol_entry *entry,
+                               unsigned int hash) {
+  symbol_cell *c = malloc(sizeof(symbol_cell));
+  assert(c != NULL);
+  symbol_cell **head = &b->heads[hash & (b->nb_buckets - 1)];
+  c->entry = entry;
+  c->hash = hash;
+  c->next = *head;
+  __atomic_store_n(head, c, __ATOMIC_RELEASE);
+}
+
+symbol_table symbol_table_create(void *(*data_create)(sstring text),
+                                 void (*data_destroy)(void *data)) {
+  symbol_table st = malloc(sizeof(struct symbol_table_struct));
+  assert(st != NULL);
+  st->buckets = symbol_buckets_create(SYMBOL_TABLE_BUCKETS_BASE, NULL);
+  for (int i = 0; i < SYMBOL_TABLE_STRIPES; i++) {
+    int error = pthread_mutex_init(&st->stripes[i], NULL);
+    assert(error == 0);
+  }
+  st->nb_entries = 0;
+  st->data_create = data_create;
+  st->data_destroy = data_destroy;
+  return st;
+}
+
+void symbol_table_destroy(symbol_table *st) {
+  assert(st != NULL);
+  if (*st != NULL) {
+    symbol_buckets *b = (*st)->buckets;
+    // each symbol is in the chains of the current buckets
+    for (unsigned int i = 0; i < b->nb_buckets; i++) {
+      for (symbol_cell *c = b->heads[i]; c != NULL; c = c->next) {
+        if ((*st)->data_destroy != NULL) {
+          (*st)->data_destroy(c->entry->data);
+        }
+        sstring_destroy(&c->entry->text);
+        free(c->entry);
+      }
+    }
+    while (b != NULL) {
+      symbol_buckets *retired = b->retired;
+      symbol_buckets_destroy(b);
+      b = retired;
+    }
+    for (int i = 0; i < SYMBOL_TABLE_STRIPES; i++) {
+      pthread_mutex_destroy(&(*st)->stripes[i]);
+    }
+    free(*st);
+    *st = NULL;
+  }
+}
+
+symbol_entry const *symbol_table_find(symbol_table st, sstring text) {
+  assert(st != NULL);
+  assert(text != NULL);
+  return symbol_buckets_find(__atomic_load_n(&st->buckets, __ATOMIC_ACQUIRE),
+                             text, sstring_hash(text));
+}
+
+/*!
+ * Double the number of buckets, unless another thread already did it.
+ * The chains are copied (readers may still walk the old ones).
+ * \param b buckets that are too small.
+ */
+static void symbol_table_grow(symbol_table st, symbol_buckets *b) {
+  for (int i = 0; i < SYMBOL_TABLE_STRIPES; i++) {
+    pthread_mutex_lock(&st->stripes[i]);
+  }
+  if (st->buckets == b) {
+    symbol_buckets *grown = symbol_buckets_create(2 * b->nb_buckets, b);
+    for (unsigned int i = 0; i < b->nb_buckets; i++) {
+      for (symbol_cell *c = b->heads[i]; c != NULL; c = c->next) {
+        symbol_buckets_add(grown, c->entry, c->hash);
+      }
+    }
+    __atomic_store_n(&st->buckets, grown, __ATOMIC_RELEASE);
+  }
+  for (int i = SYMBOL_TABLE_STRIPES - 1; i >= 0; i--) {
+    pthread_mutex_unlock(&st->stripes[i]);
+  }
+}
+
+symbol_entry const *symbol_table_intern(symbol_table st, sstring text) {
+  assert(st != NULL);
+  assert(text != NULL);
+  unsigned int const hash = sstring_hash(text);
+  symbol_entry *entry = symbol_buckets_find(
+      __atomic_load_n(&st->buckets, __ATOMIC_ACQUIRE), text, hash);
+  if (entry != NULL) {
+    return entry;
+  }
+  pthread_mutex_t *lock = &st->stripes[hash % SYMBOL_TABLE_STRIPES];
+  pthread_mutex_lock(lock);
+  // the buckets do not change while a lock is held
+  symbol_buckets *b = st->buckets;
+  entry = symbol_buckets_find(b, text, hash);
+  bool const added = entry == NULL;
+  if (added) {
+    entry = malloc(sizeof(symbol_entry));
+    assert(entry != NULL);
+    entry->text = sstring_copy(text);
+    entry->id = __atomic_fetch_add(&st->nb_entries, 1, __ATOMIC_RELAXED);
+    entry->data =
+        st->data_create != NULL ? st->data_create(entry->text) : NULL;
+    symbol_buckets_add(b, entry, hash);
+  }
+  pthread_mutex_unlock(lock);
+  if (added && (unsigned int)symbol_table_get_size(st) > b->nb_buckets) {
+    symbol_table_grow(st, b);
+  }
+  return entry;
+}
+
+int symbol_table_get_size(symbol_table st) {
+  assert(st != NULL);
+  return __atomic_load_n(&st->nb_entries, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,99 @@
+#ifndef __SYMBOL_TABLE_H
+#define __SYMBOL_TABLE_H
+
+#include "sstring.h"
+
+/*!
+ * \file
+ * \brief Concurrent table of interned symbols.
+ *
+ * Each distinct text is stored once, with a dense id (in order of insertion)
+ * and data computed once when the symbol is added. Entries are never modified
+ * nor removed until the table is destroyed, so their text can be shared by
+ * any number of terms.
+ *
+ * The table can be used by several threads at once:
+ * \li finding a symbol already in the table takes no lock (bucket heads are
+ * read with acquire loads, chains are never modified once published),
+ * \li adding a symbol locks one of \c SYMBOL_TABLE_STRIPES locks (chosen by
+ * hash), growing the table locks all of them,
+ * \li when the table grows, the old buckets may still be read by other
+ * threads: they are retired and only freed with the table (their total size
+ * is less than the one of the current buckets).
+ *
+ * Nothing is reclaimed before the table is destroyed: there is no count of the
+ * users of a symbol, so a symbol no longer used stays in the table. The memory
+ * of a table grows with the number of distinct symbols ever added, which is
+ * bounded for a given input but not for a process that reads new symbols
+ * forever.
+ */
+
+/*!
+ * Number of locks used to add symbols.
+ */
+#define SYMBOL_TABLE_STRIPES 64
+
+/*!
+ * Tables are accessed through pointers / reference.
+ * The exact structure type is hidden in the .c .
+ */
+typedef struct symbol_table_struct *symbol_table;
+
+/*!
+ * Symbol in a table.
+ */
+typedef struct {
+  /*! interned text (must not be modified nor destroyed) */
+  sstring text;
+  /*! id of the symbol, from 0 in order of insertion */
+  int id;
+  /*! data computed when the symbol was added */
+  void *data;
+} symbol_entry;
+
+/*!
+ * Create an empty table.
+ * \param data_create computes the data of a symbol when it is added (can be
+ * NULL for no data).
+ * \param data_destroy releases the data of a symbol (can be NULL).
+ * \return an empty table.
+ */
+extern symbol_table symbol_table_create(void *(*data_create)(sstring text),
+                                        void (*data_destroy)(void *data));
+
+/*!
+ * Destroy a table with all its symbols.
+ * \param st (location of the) table to destroy.
+ * \pre no other thread uses the table nor the texts of its symbols.
+ */
+extern void symbol_table_destroy(symbol_table *st);
+
+/*!
+ * Find a symbol.
+ * Never locks.
+ * \param st table to look into.
+ * \param text text of the symbol.
+ * \pre \c st and \c text are non NULL.
+ * \return the entry of the symbol, NULL if it is not in the table.
+ */
+extern symbol_entry const *symbol_table_find(symbol_table st, sstring text);
+
+/*!
+ * Find a symbol, it is added if missing (with a copy of \c text ).
+ * If several threads add the same symbol at once, one entry is added and
+ * returned to all of them.
+ * \param st table to look into.
+ * \param text text of the symbol.
+ * \pre \c st and \c text are non NULL.
+ * \return the entry of the symbol (valid until the table is destroyed).
+ */
+extern symbol_entry const *symbol_table_intern(symbol_table st, sstring text);
+
+/*!
+ * \param st a table.
+ * \pre \c st is non NULL.
+ * \return the number of symbols in the table.
+ */
+extern int symbol_table_get_size(symbol_table st);
+
+#endif
@@ -1,8 +1,13 @@
 #include <assert.h>
 #include <ctype.h>
+#include <pthread.h>
 #include <stdlib.h>
+#include <string.h>
 
+#include "check.h"
+#include "symbol_table.h"
 #include "term.h"
+#include "term_stats.h"
 
 #undef NDEBUG // FORCE ASSERT ACTIVATION
 
@@ -26,18 +31,57 @@ typedef struct term_list_struct {
  * Arguments can be accessed from both side.
  */
 typedef struct term_struct {
-  /*! Symbol of the term */
+  /*! Symbol of the term (interned, shared with the other terms) */
   sstring symbol;
   /*! Number of arguments, stored for efficiency */
   int arity;
+  /*!
+   * In a shared term: number of terms sharing it, minus 1 (atomic, see
+   * \c term_copy ). It is 0 in the other terms.
+   */
+  int references;
   /*! Father term if set then this term is an argument of the father. */
   term father;
   /*! First argument in the first link of the doubled chain. */
   term_list argument_first;
   /*! Last argument in the first link of the doubled chain. */
   term_list argument_last;
+  /*!
+   * If not 0, the term is \c S^n(0) with n = \c successor_run and its
+   * argument is not stored yet (it is created when accessed).
+   */
+  long successor_run;
+  /*!
+   * If not NULL, the arguments of the term are the ones of this shared term
+   * (which is not modified while it is shared). They are cloned when they are
+   * accessed or modified, the argument fields are the ones of the shared term
+   * until then.
+   */
+  term shared;
+  /*!
+   * Frozen copy of the term (a shared term holding one reference, see
+   * \c term_copy ), or \c frozen_mark if the term is inside a term holding
+   * one, or NULL. It is dropped when the term or a sub-term is modified (see
+   * \c term_modify ).
+   */
+  term frozen;
+  /*! Kind of the symbol, computed when it is set. */
+  term_kind kind;
+  /*! Value of the symbol if kind is \c TERM_KIND_INTEGER */
+  int integer;
 } term_struct;
 
+/*!
+ * Mark of the sub-terms of a term holding a frozen copy (only its address is
+ * used).
+ */
+static term_struct frozen_mark;
+
+/*! Symbol of Peano successor. */
+static char const *const symbol_successor = "S";
+/*! Symbol of Peano zero. */
+static char const *const symbol_zero = "0";
+
 /*!
  * To test whether a \c sstring is a valid symbol.
  * This means not empty, no space nor parenthesis.
@@ -46,16 +90,113 @@ typedef struct term_struct {
  */
 static bool symbol_is_valild(sstring const symbol) {
   assert(symbol != NULL);
-  if (sstring_is_empty(symbol)) {
-    return false;
+  return sstring_is_token(symbol);
+}
+
+bool term_symbol_is_variable(sstring symbol) {
+  assert(symbol != NULL);
+  if (sstring_get_length(symbol) > 1 && sstring_get_char(symbol, 0) == '\'') {
+    char c = sstring_get_char(symbol, 1);
+    return ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_') &&
+           sstring_is_word_from(symbol, 2);
   }
-  for (int i = 0; i < sstring_get_length(symbol); i++) {
-    char c = sstring_get_char(symbol, i);
-    if (isspace(c) || c == ')' || c == '(') {
-      return false;
-    }
-  };
-  return true;
+  return false;
+}
+
+/*!
+ * Kind and integer value of a symbol, computed once when the symbol is
+ * interned.
+ */
+typedef struct {
+  term_kind kind;
+  int integer;
+} symbol_class;
+
+/*!
+ * Classify a symbol (data of the entries of \c symbols ).
+ * \param symbol symbol to classify.
+ * \return the allocated classification.
+ */
+static void *symbol_class_create(sstring symbol) {
+  symbol_class *c = malloc(sizeof(symbol_class));
+  assert(c != NULL);
+  c->integer = 0;
+  if (term_symbol_is_variable(symbol)) {
+    c->kind = TERM_KIND_VARIABLE;
+  } else if (sstring_is_integer(symbol, &c->integer)) {
+    c->kind = TERM_KIND_INTEGER;
+  } else {
+    c->kind = TERM_KIND_SYMBOL;
+  }
+  return c;
+}
+
+/*!
+ * Symbols of all terms: each distinct text is stored and classified once.
+ * Created with the first term and released at exit.
+ */
+static symbol_table symbols = NULL;
+
+/*! Creation of \c symbols . */
+static pthread_once_t symbols_once = PTHREAD_ONCE_INIT;
+
+/*! Interned text of \c symbol_zero . */
+static sstring text_zero = NULL;
+
+/*! Interned text of \c symbol_successor . */
+static sstring text_successor = NULL;
+
+static void symbols_release(void) { symbol_table_destroy(&symbols); }
+
+static void symbols_create(void) {
+  symbols = symbol_table_create(symbol_class_create, free);
+  sstring s = sstring_create_string(symbol_zero);
+  text_zero = symbol_table_intern(symbols, s)->text;
+  sstring_destroy(&s);
+  s = sstring_create_string(symbol_successor);
+  text_successor = symbol_table_intern(symbols, s)->text;
+  sstring_destroy(&s);
+  atexit(symbols_release);
+}
+
+/*!
+ * Set the symbol of a term to the interned copy of a symbol, with its
+ * classification.
+ * \param t term to update.
+ * \param symbol symbol to set.
+ */
+static void term_intern_symbol(term t, sstring symbol) {
+  pthread_once(&symbols_once, symbols_create);
+  symbol_entry const *entry = symbol_table_intern(symbols, symbol);
+  symbol_class const *c = entry->data;
+  t->symbol = entry->text;
+  t->kind = c->kind;
+  t->integer = c->integer;
+}
+
+/*!
+ * Create a term with no argument and the same symbol (and classification) as
+ * another one.
+ * \param t_src term to take the symbol from.
+ * \return a newly created term.
+ */
+static term term_create_same_symbol(term t_src) {
+  term t = malloc(sizeof(term_struct));
+  assert(t != NULL);
+  TERM_STATS_ADD(terms_created, 1);
+  TERM_STATS_ADD(bytes_allocated, sizeof(term_struct));
+  t->symbol = t_src->symbol;
+  t->arity = 0;
+  t->father = NULL;
+  t->argument_first = NULL;
+  t->argument_last = NULL;
+  t->successor_run = 0;
+  t->references = 0;
+  t->shared = NULL;
+  t->frozen = NULL;
+  t->kind = t_src->kind;
+  t->integer = t_src->integer;
+  return t;
 }
 
 /*!
@@ -67,23 +208,106 @@ static term_list term_list_create(term t) {
   assert(t != NULL);
   term_list tl = malloc(sizeof(struct term_list_struct));
   assert(tl != NULL);
+  TERM_STATS_ADD(bytes_allocated, sizeof(struct term_list_struct));
   tl->t = t;
   tl->previous = tl->next = NULL;
   return tl;
 }
 
 term term_create(sstring symbol) {
-  assert(symbol_is_valild(symbol));
+  CHECK(symbol_is_valild(symbol));
   term t = malloc(sizeof(term_struct));
   assert(t != NULL);
-  t->symbol = sstring_copy(symbol);
+  TERM_STATS_ADD(terms_created, 1);
+  TERM_STATS_ADD(bytes_allocated, sizeof(term_struct));
   t->arity = 0;
   t->father = NULL;
   t->argument_first = NULL;
   t->argument_last = NULL;
+  t->successor_run = 0;
+  t->references = 0;
+  t->shared = NULL;
+  t->frozen = NULL;
+  term_intern_symbol(t, symbol);
   return t;
 }
 
+term term_create_peano(long n) {
+  assert(n >= 0);
+  sstring s = sstring_create_string(n > 0 ? symbol_successor : symbol_zero);
+  term t = term_create(s);
+  sstring_destroy(&s);
+  t->successor_run = n;
+  return t;
+}
+
+static term_list term_add_argument_empty(term t, term a);
+
+/*!
+ * Create the argument of a \c S^n(0) term, if not already done.
+ * Its argument is \c S^(n-1)(0) (also stored as a run).
+ * \param t term to expand.
+ */
+static void term_expand_successor_run(term t) {
+  if (t->successor_run > 0) {
+    long n = t->successor_run - 1;
+    t->successor_run = 0;
+    term_add_argument_empty(t, term_create_peano(n));
+    if (t->frozen != NULL) {
+      t->argument_first->t->frozen = &frozen_mark;
+    }
+  }
+}
+
+static void term_expand_shared(term t);
+static void term_append_argument(term t, term a);
+
+/*!
+ * Create the arguments of a term that are not stored yet (run or shared
+ * arguments), before they are accessed.
+ * \param t term to expand.
+ */
+static void term_expand(term t) {
+  term_expand_successor_run(t);
+  term_expand_shared(t);
+}
+
+long term_get_successor_run(term t) {
+  assert(NULL != t);
+  return t->successor_run;
+}
+
+bool term_is_peano(term t, long *n_pt) {
+  assert(NULL != t);
+  assert(NULL != n_pt);
+  long n = 0;
+  while (t->successor_run == 0 && t->arity == 1 &&
+         t->symbol == text_successor) {
+    n++;
+    t = t->argument_first->t;
+  }
+  bool res = t->successor_run > 0 ||
+             (t->arity == 0 && t->kind == TERM_KIND_INTEGER && t->integer == 0 &&
+              sstring_get_length(t->symbol) == 1);
+  if (res) {
+    *n_pt = n + t->successor_run;
+  }
+  return res;
+}
+
+/*!
+ * Pre-order visitor of \c term_contains_successor_run , stops at a run.
+ */
+static term_visit term_contains_successor_run_pre(term t, int depth,
+                                                  void *data) {
+  return t->successor_run > 0 ? TERM_VISIT_STOP : TERM_VISIT_CONTINUE;
+}
+
+bool term_contains_successor_run(term t) {
+  assert(t != NULL);
+  return !term_traverse(t, term_contains_successor_run_pre, NULL, NULL);
+}
+
 /*!
  * Destroy a term_list.
  * \param tl term_list to destroy.
@@ -97,30 +321,371 @@ static void term_list_destroy(term_list *tl) {
   }
 }
 
-void term_destroy(term *t) {
+/*!
+ * Number of frames of a traversal stack stored without allocation.
+ */
+#define TRAVERSE_STACK_BASE 64
+
+/*!
+ * Frame of the explicit stack of \c term_traverse : a term and the next of its
+ * arguments to visit.
+ */
+typedef struct {
+  term t;
+  term_list next;
+} traverse_frame;
+
+bool term_traverse(term t, term_visitor pre, term_visitor post, void *data) {
   assert(t != NULL);
-  if (*t != NULL) {
-    term_list current = (*t)->argument_first;
-    term_list next = NULL;
+  traverse_frame base[TRAVERSE_STACK_BASE];
+  traverse_frame *frames = base;
+  int capacity = TRAVERSE_STACK_BASE;
+  int top = 0;
+  bool completed = true;
+  term_visit visit = pre == NULL ? TERM_VISIT_CONTINUE : pre(t, 0, data);
+  if (visit == TERM_VISIT_STOP) {
+    return false;
+  }
+  frames[0].t = t;
+  frames[0].next = visit == TERM_VISIT_SKIP ? NULL : t->argument_first;
+  while (top >= 0) {
+    term_list next = frames[top].next;
+    if (next != NULL) {
+      frames[top].next = next->next;
+      term arg = next->t;
+      visit = pre == NULL ? TERM_VISIT_CONTINUE : pre(arg, top + 1, data);
+      if (visit == TERM_VISIT_STOP) {
+        completed = false;
+        break;
+      }
+      if (top + 1 == capacity) {
+        capacity *= 2;
+        if (frames == base) {
+          frames = malloc(capacity * sizeof(traverse_frame));
+          assert(frames != NULL);
+          memcpy(frames, base, sizeof(base));
+        } else {
+          frames = realloc(frames, capacity * sizeof(traverse_frame));
+          assert(frames != NULL);
+        }
+      }
+      top++;
+      frames[top].t = arg;
+      frames[top].next = visit == TERM_VISIT_SKIP ? NULL : arg->argument_first;
+    } else {
+      term done = frames[top].t;
+      top--;
+      if (post != NULL && post(done, top + 1, data) == TERM_VISIT_STOP) {
+        completed = false;
+        break;
+      }
+    }
+  }
+  if (frames != base) {
+    free(frames);
+  }
+  return completed;
+}
+
+/*!
+ * Whether \c term_copy shares the arguments (see \c term_sharing_enable ),
+ * read and written atomically.
+ */
+static bool sharing_enabled = false;
+
+void term_sharing_enable(bool enabled) {
+  __atomic_store_n(&sharing_enabled, enabled, __ATOMIC_RELAXED);
+}
+
+bool term_sharing_is_enabled(void) {
+  return __atomic_load_n(&sharing_enabled, __ATOMIC_RELAXED);
+}
+
+/*!
+ * \return the shared term whose arguments are the ones of a term, NULL if
+ * none.
+ */
+static inline term term_get_shared(term t) {
+  return __atomic_load_n(&t->shared, __ATOMIC_ACQUIRE);
+}
+
+/*!
+ * Drop a reference to a shared term.
+ * \return true if it was the last one (then the caller destroys the term).
+ */
+static bool term_release_reference(term t) {
+  return __atomic_load_n(&t->references, __ATOMIC_ACQUIRE) == 0 ||
+         __atomic_fetch_sub(&t->references, 1, __ATOMIC_ACQ_REL) == 0;
+}
+
+/*!
+ * Drop a reference to a shared term, destroy it if it was the last one.
+ */
+static void term_release(term t) {
+  if (term_release_reference(t)) {
+    term_destroy(&t);
+  }
+}
+
+/*!
+ * State of \c term_destroy : sub-term still shared by other terms (it is
+ * skipped and not freed).
+ */
+typedef struct {
+  term kept;
+} term_destroy_state;
+
+/*!
+ * Pre-order visitor of \c term_destroy : keep the sub-terms still shared,
+ * and do not go into the arguments of a term that are shared.
+ */
+static term_visit term_destroy_pre(term t, int depth, void *data) {
+  term_destroy_state *state = data;
+  if (depth > 0 && !term_release_reference(t)) {
+    state->kept = t;
+    return TERM_VISIT_SKIP;
+  }
+  return t->shared != NULL ? TERM_VISIT_SKIP : TERM_VISIT_CONTINUE;
+}
+
+/*!
+ * Post-order visitor of \c term_destroy : the arguments are already destroyed
+ * (a kept term is visited just after its pre-order visit).
+ */
+static term_visit term_destroy_post(term t, int depth, void *data) {
+  term_destroy_state *state = data;
+  if (t == state->kept) {
+    state->kept = NULL;
+    return TERM_VISIT_CONTINUE;
+  }
+  if (t->frozen != NULL && t->frozen != &frozen_mark) {
+    term_release(t->frozen);
+  }
+  term shared = t->shared;
+  if (shared == NULL) {
+    term_list current = t->argument_first;
     while (current != NULL) {
-      next = current->next;
-      term_list_destroy(&current);
+      term_list next = current->next;
+      free(current);
       current = next;
     }
-    sstring_destroy(&(*t)->symbol);
-    free(*t);
+  }
+  free(t);
+  TERM_STATS_ADD(terms_destroyed, 1);
+  if (shared != NULL) {
+    term_release(shared);
+  }
+  return TERM_VISIT_CONTINUE;
+}
+
+void term_destroy(term *t) {
+  assert(t != NULL);
+  if (*t != NULL) {
+    term_destroy_state state = {NULL};
+    term_traverse(*t, term_destroy_pre, term_destroy_post, &state);
     *t = NULL;
   }
 }
 
+/*!
+ * Set the arguments of a term without argument to the ones of a shared term
+ * (the reference is the one of the caller).
+ * \param t term to modify.
+ * \param shared shared term.
+ */
+static void term_set_shared(term t, term shared) {
+  t->arity = shared->arity;
+  t->argument_first = shared->argument_first;
+  t->argument_last = shared->argument_last;
+  t->shared = shared;
+}
+
+/*!
+ * Set the arguments of a term without argument to the ones of a shared term
+ * (one more reference to it).
+ * \param t term to modify.
+ * \param shared shared term.
+ */
+static void term_share(term t, term shared) {
+  __atomic_fetch_add(&shared->references, 1, __ATOMIC_RELAXED);
+  term_set_shared(t, shared);
+}
+
+/*!
+ * State of \c term_copy : copy of the father of the next visited term (copies
+ * are attached to it), and finally the whole copy.
+ */
+typedef struct {
+  term current;
+} term_copy_state;
+
+static term_visit term_copy_pre(term t, int depth, void *data);
+static term_visit term_copy_post(term t, int depth, void *data);
+
+/*!
+ * Pre-order visitor of \c term_freeze : copy the term and mark it. The
+ * arguments of a term that shares them (or holds a frozen copy) are shared
+ * again instead of being copied.
+ */
+static term_visit term_freeze_pre(term t, int depth, void *data) {
+  term_copy_pre(t, depth, data);
+  term shared = term_get_shared(t);
+  if (shared == NULL && depth > 0 && t->frozen != NULL &&
+      t->frozen != &frozen_mark) {
+    shared = t->frozen;
+  }
+  if (t->frozen == NULL) {
+    t->frozen = &frozen_mark;
+  }
+  if (shared != NULL) {
+    term_share(((term_copy_state *)data)->current, shared);
+    return TERM_VISIT_SKIP;
+  }
+  return TERM_VISIT_CONTINUE;
+}
+
+/*!
+ * Return the frozen copy of a term, made (and kept in the term) if needed:
+ * a new shared term where only the sub-terms that do not share their
+ * arguments are copied. The arguments of \c t are not moved: its sub-terms
+ * stay its own and can still be modified, which drops the frozen copy (see
+ * \c term_modify ).
+ * \param t term with arguments, not sharing them.
+ * \return the frozen copy (the reference is the one of \c t ).
+ */
+static term term_freeze(term t) {
+  if (t->frozen == NULL || t->frozen == &frozen_mark) {
+    term_copy_state state = {NULL};
+    term_traverse(t, term_freeze_pre, term_copy_post, &state);
+    t->frozen = state.current;
+  }
+  return t->frozen;
+}
+
+/*!
+ * Copy of a term sharing its arguments, in O(1) once they are shared or
+ * frozen (see \c term_freeze ).
+ * \param t term to copy.
+ * \param frozen whether \c t is itself inside a shared term (then it is
+ * shared directly).
+ * \return the copy.
+ */
+static term term_copy_sharing(term t, bool frozen) {
+  term copy = term_create_same_symbol(t);
+  copy->successor_run = t->successor_run;
+  if (t->successor_run == 0 && t->arity > 0) {
+    term shared = term_get_shared(t);
+    if (shared == NULL) {
+      shared = frozen ? t : term_freeze(t);
+    }
+    term_share(copy, shared);
+  }
+  return copy;
+}
+
+/*!
+ * Drop the frozen copies that a modification of a term makes out of date: the
+ * ones of the term and of its ancestors. The walk stops at the first term
+ * that is not marked, so that it costs nothing when no copy was frozen.
+ * \param t term about to be modified.
+ */
+static void term_modify(term t) {
+  for (; t != NULL && t->frozen != NULL; t = t->father) {
+    term frozen = t->frozen;
+    t->frozen = NULL;
+    if (frozen != &frozen_mark) {
+      term_release(frozen);
+    }
+  }
+}
+
+/*!
+ * Clone the arguments of a term that shares them: each argument is a copy
+ * sharing the arguments of the shared one (see \c term_copy_sharing ).
+ * \param t term to expand.
+ */
+static void term_expand_shared(term t) {
+  term shared = t->shared;
+  if (shared != NULL) {
+    t->shared = NULL;
+    t->arity = 0;
+    t->argument_first = NULL;
+    t->argument_last = NULL;
+    for (term_list tl = shared->argument_first; tl != NULL; tl = tl->next) {
+      term copy = term_copy_sharing(tl->t, true);
+      // the value is the same, a frozen copy of an ancestor stays valid
+      copy->frozen = t->frozen != NULL ? &frozen_mark : NULL;
+      term_append_argument(t, copy);
+    }
+    term_release(shared);
+  }
+}
+
+bool term_is_shared(term t) {
+  assert(t != NULL);
+  return term_get_shared(t) != NULL;
+}
+
+/*!
+ * Pre-order visitor of \c term_contains_shared , stops at a shared term.
+ */
+static term_visit term_contains_shared_pre(term t, int depth, void *data) {
+  return term_get_shared(t) != NULL ? TERM_VISIT_STOP : TERM_VISIT_CONTINUE;
+}
+
+bool term_contains_shared(term t) {
+  assert(t != NULL);
+  return !term_traverse(t, term_contains_shared_pre, NULL, NULL);
+}
+
+/*!
+ * Pre-order visitor of \c term_unshare : the arguments are read after it.
+ */
+static term_visit term_unshare_pre(term t, int depth, void *data) {
+  term_expand_shared(t);
+  return TERM_VISIT_CONTINUE;
+}
+
+void term_unshare(term t) {
+  assert(t != NULL);
+  term_traverse(t, term_unshare_pre, NULL, NULL);
+}
+
 sstring term_get_symbol(term t) {
   assert(NULL != t);
   return t->symbol;
 }
 
+term_kind term_get_kind(term t) {
+  assert(NULL != t);
+  return t->kind;
+}
+
+sstring term_symbol_intern(sstring symbol) {
+  assert(symbol != NULL);
+  assert(symbol_is_valild(symbol));
+  pthread_once(&symbols_once, symbols_create);
+  return symbol_table_intern(symbols, symbol)->text;
+}
+
+bool term_has_symbol(term t, sstring symbol) {
+  assert(NULL != t);
+  return t->symbol == symbol;
+}
+
+bool term_get_integer(term t, int *n_pt) {
+  assert(NULL != t);
+  assert(NULL != n_pt);
+  if (t->kind == TERM_KIND_INTEGER) {
+    *n_pt = t->integer;
+    return true;
+  }
+  return false;
+}
+
 int term_get_arity(term t) {
   assert(NULL != t);
-  return t->arity;
+  return t->successor_run > 0 ? 1 : t->arity;
 }
 
 term term_get_father(term t) {
@@ -133,7 +698,7 @@ term term_get_father(term t) {
  * \param t term the parent.
  * \param a term the argument.
  */
-static inline term_list term_add_argument_empty(term t, term a) {
+static term_list term_add_argument_empty(term t, term a) {
   assert(t != NULL);
   assert(a != NULL);
   // Create term_list
@@ -155,6 +720,14 @@ static inline term_list term_list_get(term t, int pos) {
   assert(t != NULL);
   assert(pos >= 0);
   assert(pos < t->arity);
+  // walk from the nearest end
+  if (pos > t->arity / 2) {
+    term_list arg = t->argument_last;
+    for (int i = t->arity - 1; i > pos; i--) {
+      arg = arg->previous;
+    }
+    return arg;
+  }
   term_list arg = t->argument_first;
   for (int i = 1; i <= pos; i++) {
     arg = arg->next;
@@ -162,9 +735,12 @@ static inline term_list term_list_get(term t, int pos) {
   return arg;
 }
 
-void term_add_argument_last(term t, term a) {
-  assert(t != NULL);
-  assert(a != NULL);
+/*!
+ * Add an argument at the end of the stored arguments of a term.
+ * \param t term the parent (expanded).
+ * \param a term the argument.
+ */
+static void term_append_argument(term t, term a) {
   if (t->arity == 0) {
     term_add_argument_empty(t, a);
   } else {
@@ -177,9 +753,19 @@ void term_add_argument_last(term t, term a) {
   }
 }
 
+void term_add_argument_last(term t, term a) {
+  assert(t != NULL);
+  assert(a != NULL);
+  term_modify(t);
+  term_expand(t);
+  term_append_argument(t, a);
+}
+
 void term_add_argument_first(term t, term a) {
   assert(t != NULL);
   assert(a != NULL);
+  term_modify(t);
+  term_expand(t);
   if (t->arity == 0) {
     term_add_argument_empty(t, a);
   } else {
@@ -195,6 +781,8 @@ void term_add_argument_first(term t, term a) {
 void term_add_argument_position(term t, term a, int pos) {
   assert(t != NULL);
   assert(a != NULL);
+  term_modify(t);
+  term_expand(t);
   assert(pos >= 0);
   assert(pos <= t->arity);
   if (pos == 0) {
@@ -215,24 +803,36 @@ void term_add_argument_position(term t, term a, int pos) {
   }
 }
 
+/*!
+ * Pre-order visitor of \c term_contains_symbol , stops when the symbol is found.
+ */
+static term_visit term_contains_symbol_pre(term t, int depth, void *data) {
+  sstring symbol = data; // interned
+  if (t->symbol == symbol) {
+    return TERM_VISIT_STOP;
+  }
+  if (t->successor_run > 0) {
+    // only S and 0 inside
+    return symbol == text_zero ? TERM_VISIT_STOP : TERM_VISIT_SKIP;
+  }
+  return TERM_VISIT_CONTINUE;
+}
+
 bool term_contains_symbol(term t, sstring symbol) {
   assert(t != NULL);
-  assert(t->symbol != NULL);
-  if (sstring_compare(t->symbol, symbol) == 0) {
-    return true;
-  } else {
-    for (int i = 0; i < t->arity; i++) {
-      term arg = term_get_argument(t, i);
-      if (term_contains_symbol(arg, symbol)) {
-        return true;
-      }
-    }
+  assert(symbol != NULL);
+  // the symbols of all terms are interned: a symbol not in the table is in
+  // no term
+  symbol_entry const *entry = symbol_table_find(symbols, symbol);
+  if (entry == NULL) {
+    return false;
   }
-  return false;
+  return !term_traverse(t, term_contains_symbol_pre, NULL, entry->text);
 }
 
 term term_get_argument(term t, int pos) {
   assert(t != NULL);
+  term_expand(t);
   assert(pos >= 0);
   assert(pos < t->arity);
   // If no argument return NULL
@@ -242,52 +842,102 @@ term term_get_argument(term t, int pos) {
   return term_list_get(t, pos)->t;
 }
 
+/*!
+ * Remove a term_list from the arguments of a term (the term_list is not
+ * freed).
+ * \param t term the parent.
+ * \param arg term_list among the arguments of t.
+ */
+static void term_list_unlink(term t, term_list arg) {
+  if (arg->previous == NULL) {
+    t->argument_first = arg->next;
+  } else {
+    arg->previous->next = arg->next;
+  }
+  if (arg->next == NULL) {
+    t->argument_last = arg->previous;
+  } else {
+    arg->next->previous = arg->previous;
+  }
+  t->arity--;
+}
+
 term term_extract_argument(term t, int pos) {
+  return term_take_argument(t, pos);
+}
+
+term term_take_argument(term t, int pos) {
   assert(t != NULL);
+  term_modify(t);
+  term_expand(t);
   assert(pos >= 0);
   assert(pos < t->arity);
-  // If no argument return NULL
-  if (t->arity == 0) {
-    return NULL;
-  }
   term_list arg = term_list_get(t, pos);
-  if (t->arity >= 2) {
-    if (pos == 0) {
-      arg->next->previous = NULL;
-      t->argument_first = arg->next;
-    } else if (pos == t->arity - 1) {
-      arg->previous->next = NULL;
-      t->argument_last = arg->previous;
-    } else {
-      arg->next->previous = arg->previous;
-      arg->previous->next = arg->next;
-    }
-    t->arity--;
-  } else { // If is the last argument
-    t->argument_first = NULL;
-    t->argument_last = NULL;
-    t->arity = 0;
+  term_list_unlink(t, arg);
+  term a = arg->t;
+  free(arg);
+  a->father = NULL;
+  return a;
+}
+
+term term_swap_argument(term t, int pos, term a) {
+  assert(t != NULL);
+  assert(a != NULL);
+  assert(a->father == NULL);
+  term_modify(t);
+  term_expand(t);
+  assert(pos >= 0);
+  assert(pos < t->arity);
+  term_list arg = term_list_get(t, pos);
+  term old = arg->t;
+  arg->t = a;
+  a->father = t;
+  old->father = NULL;
+  return old;
+}
+
+/*!
+ * Pre-order visitor of \c term_copy : copy the term without its arguments.
+ */
+static term_visit term_copy_pre(term t, int depth, void *data) {
+  term_copy_state *state = data;
+  term new = term_create_same_symbol(t);
+  new->successor_run = t->successor_run;
+  if (depth > 0) {
+    term_add_argument_last(state->current, new);
+  }
+  state->current = new;
+  return TERM_VISIT_CONTINUE;
+}
+
+/*!
+ * Post-order visitor of \c term_copy : go back to the father of the copy.
+ */
+static term_visit term_copy_post(term t, int depth, void *data) {
+  term_copy_state *state = data;
+  if (depth > 0) {
+    state->current = state->current->father;
   }
-  term tr = term_copy(arg->t);
-  term_list_destroy(&arg);
-  return tr;
+  return TERM_VISIT_CONTINUE;
 }
 
 term term_copy(term t) {
   assert(t != NULL);
-  term new = term_create(t->symbol);
-  for (int i = 0; i < t->arity; i++) {
-    term_add_argument_last(new, term_copy(term_get_argument(t, i)));
+  if (term_sharing_is_enabled()) {
+    return term_copy_sharing(t, false);
   }
-  return new;
+  term_copy_state state = {NULL};
+  term_traverse(t, term_copy_pre, term_copy_post, &state);
+  return state.current;
 }
 
 term term_copy_translate_position(term t, term *loc) {
   assert(t != NULL);
   assert(loc != NULL);
-  term new = term_create(t->symbol);
-  for (int i = 0; i < t->arity; i++) {
-    term arg = term_get_argument(t, i);
+  term_expand(t);
+  term new = term_create_same_symbol(t);
+  for (term_list tl = t->argument_first; tl != NULL; tl = tl->next) {
+    term arg = tl->t;
     term copyarg = term_copy(arg);
 
     term_add_argument_last(new, copyarg);
@@ -300,52 +950,225 @@ term term_copy_translate_position(term t, term *loc) {
   return new;
 }
 
-void term_replace_copy(term t_loc, term t_src) {
-  assert(t_loc != NULL);
-  assert(t_src != NULL);
-  term_list current = t_loc->argument_first;
+/*!
+ * Destroy the arguments of a term (or drop the shared ones).
+ * \param t term whose arguments are destroyed (its argument fields are left
+ * as they are).
+ */
+static void term_destroy_arguments(term t) {
+  if (t->shared != NULL) {
+    term_release(t->shared);
+    t->shared = NULL;
+    return;
+  }
+  term_list current = t->argument_first;
   while (current != NULL) {
     term_list next = current->next;
     term_list_destroy(&current);
     current = next;
   }
-  sstring_destroy(&t_loc->symbol);
-  t_loc->symbol = sstring_copy(t_src->symbol);
+}
+
+void term_replace_copy(term t_loc, term t_src) {
+  assert(t_loc != NULL);
+  assert(t_src != NULL);
+  // shared (or frozen) before t_loc is modified, t_loc may be inside t_src
+  term shared = NULL;
+  if (term_sharing_is_enabled() && t_src->successor_run == 0 &&
+      t_src->arity > 0) {
+    shared = term_get_shared(t_src);
+    if (shared == NULL) {
+      shared = term_freeze(t_src);
+    }
+    __atomic_fetch_add(&shared->references, 1, __ATOMIC_RELAXED);
+  }
+  term_modify(t_loc);
+  term_destroy_arguments(t_loc);
+  t_loc->symbol = t_src->symbol;
+  t_loc->kind = t_src->kind;
+  t_loc->integer = t_src->integer;
   t_loc->arity = 0;
   t_loc->argument_first = NULL;
   t_loc->argument_last = NULL;
-  // Add src args
-  term_argument_traversal tat = term_argument_traversal_create(t_src);
-  while (term_argument_traversal_has_next(tat)) {
-    term_add_argument_last(t_loc,
-                           term_copy(term_argument_traversal_get_next(tat)));
+  t_loc->successor_run = t_src->successor_run;
+  // Add src args (none is stored for a run), they are read where they are
+  // stored: t_src is not modified
+  if (t_src->successor_run == 0 && t_src->arity > 0) {
+    if (shared != NULL) {
+      term_set_shared(t_loc, shared);
+    } else {
+      for (term_list tl = t_src->argument_first; tl != NULL; tl = tl->next) {
+        term_add_argument_last(t_loc, term_copy(tl->t));
+      }
+    }
+  }
+}
+
+/*!
+ * State of \c term_compare : \c t1 is traversed, \c t2 is followed in
+ * parallel by keeping for each depth the next argument of \c t2 to compare.
+ */
+typedef struct {
+  term t2;
+  term_list *next;
+  int capacity;
+  int compare;
+  term_list base[TRAVERSE_STACK_BASE];
+} term_compare_state;
+
+/*!
+ * Compare \c S^n(0) with a term, in the order of \c term_compare , without
+ * creating any argument.
+ * \param successor symbol of the successor.
+ * \param n number of successors.
+ * \param t term to compare with.
+ */
+static int term_compare_run(sstring successor, long n, term t) {
+  for (;; n--) {
+    if (n > 0 && t->successor_run > 0) {
+      return (n > t->successor_run) - (n < t->successor_run);
+    }
+    int compare = sstring_compare(n > 0 ? successor : text_zero, t->symbol);
+    if (compare == 0) {
+      compare = (n > 0) - term_get_arity(t);
+    }
+    if (compare != 0 || n == 0) {
+      return compare;
+    }
+    t = t->argument_first->t;
   }
-  term_argument_traversal_destroy(&tat);
+}
+
+/*!
+ * Pre-order visitor of \c term_compare : compare a term of \c t1 with the
+ * corresponding one of \c t2 , stop on the first difference.
+ * Nothing is modified (runs are not expanded, shared arguments are read where
+ * they are stored).
+ */
+static term_visit term_compare_pre(term t1, int depth, void *data) {
+  term_compare_state *state = data;
+  term t2 = state->t2;
+  if (depth > 0) {
+    t2 = state->next[depth - 1]->t;
+    state->next[depth - 1] = state->next[depth - 1]->next;
+  }
+  if (t1 == t2) {
+    state->compare = 0;
+    return TERM_VISIT_SKIP;
+  }
+  if (t1->successor_run > 0 && t2->successor_run > 0) {
+    // S^n(0) < S^m(0) iff n < m
+    state->compare = (t1->successor_run > t2->successor_run) -
+                     (t1->successor_run < t2->successor_run);
+    return state->compare == 0 ? TERM_VISIT_SKIP : TERM_VISIT_STOP;
+  }
+  state->compare = sstring_compare(t1->symbol, t2->symbol);
+  if (state->compare == 0) {
+    state->compare = term_get_arity(t1) - term_get_arity(t2);
+  }
+  if (state->compare != 0) {
+    return TERM_VISIT_STOP;
+  }
+  if (t1->successor_run > 0 || t2->successor_run > 0) {
+    // a run against a term built explicitly
+    state->compare =
+        t1->successor_run > 0
+            ? term_compare_run(t1->symbol, t1->successor_run - 1,
+                               t2->argument_first->t)
+            : -term_compare_run(t2->symbol, t2->successor_run - 1,
+                                t1->argument_first->t);
+    return state->compare == 0 ? TERM_VISIT_SKIP : TERM_VISIT_STOP;
+  }
+  term const shared = term_get_shared(t1);
+  if (shared != NULL && shared == term_get_shared(t2)) {
+    return TERM_VISIT_SKIP;
+  }
+  if (depth == state->capacity) {
+    state->capacity *= 2;
+    if (state->next == state->base) {
+      state->next = malloc(state->capacity * sizeof(term_list));
+      assert(state->next != NULL);
+      memcpy(state->next, state->base, sizeof(state->base));
+    } else {
+      state->next = realloc(state->next, state->capacity * sizeof(term_list));
+      assert(state->next != NULL);
+    }
+  }
+  state->next[depth] = t2->argument_first;
+  return TERM_VISIT_CONTINUE;
+}
+
+/*!
+ * Test whether a term is inside another one (or is it).
+ * No side effect, can be used in assert.
+ */
+static bool term_is_inside(term t, term container) {
+  for (; t != NULL; t = t->father) {
+    if (t == container) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void term_replace_move(term t_loc, term *t_src) {
+  assert(t_loc != NULL);
+  assert(t_src != NULL);
+  term src = *t_src;
+  assert(src != NULL);
+  CHECK(!term_is_inside(t_loc, src));
+  term_modify(t_loc);
+  if (src->father != NULL) {
+    term_modify(src->father);
+    term_list arg = src->father->argument_first;
+    while (arg->t != src) {
+      arg = arg->next;
+    }
+    term_list_unlink(src->father, arg);
+    free(arg);
+    src->father = NULL;
+  }
+  term_destroy_arguments(t_loc);
+  t_loc->symbol = src->symbol;
+  t_loc->kind = src->kind;
+  t_loc->integer = src->integer;
+  t_loc->arity = src->arity;
+  t_loc->argument_first = src->argument_first;
+  t_loc->argument_last = src->argument_last;
+  t_loc->successor_run = src->successor_run;
+  t_loc->shared = src->shared;
+  if (src->frozen != NULL && src->frozen != &frozen_mark) {
+    term_release(src->frozen);
+  }
+  // shared arguments are not modified (nor their father)
+  if (t_loc->shared == NULL) {
+    for (term_list tl = t_loc->argument_first; tl != NULL; tl = tl->next) {
+      tl->t->father = t_loc;
+    }
+  }
+  free(src);
+  TERM_STATS_ADD(terms_destroyed, 1);
+  *t_src = NULL;
 }
 
 int term_compare(term t1, term t2) {
   assert(t1 != NULL);
   assert(t2 != NULL);
-  int compare = sstring_compare(t1->symbol, t2->symbol);
-  if (compare == 0) {
-    compare = t1->arity - t2->arity;
-    if (compare == 0) {
-      int i = 0;
-      while (i < t1->arity && compare == 0) {
-        /*
-                compare = sstring_compare(term_get_argument(t1, i)->symbol,
-                                          term_get_argument(t2, i)->symbol);*/
-        compare =
-            term_compare(term_get_argument(t1, i), term_get_argument(t2, i));
-        i++;
-      }
-    }
+  TERM_STATS_ADD(term_compare_calls, 1);
+  term_compare_state state;
+  state.t2 = t2;
+  state.next = state.base;
+  state.capacity = TRAVERSE_STACK_BASE;
+  state.compare = 0;
+  term_traverse(t1, term_compare_pre, NULL, &state);
+  if (state.next != state.base) {
+    free(state.next);
   }
-  return compare;
+  return state.compare;
 }
 
 struct term_argument_traversal_struct {
-  term_list tls;
+  term_argument_iterator it;
 };
 
 term_argument_traversal term_argument_traversal_create(term t) {
@@ -353,32 +1176,51 @@ term_argument_traversal term_argument_traversal_create(term t) {
   term_argument_traversal tt =
       malloc(sizeof(struct term_argument_traversal_struct));
   assert(tt != NULL);
-  tt->tls = t->argument_first;
+  tt->it = term_argument_iterator_start(t);
   return tt;
 }
 
 void term_argument_traversal_destroy(term_argument_traversal *tt) {
   assert(tt != NULL);
-  if (*tt != NULL) {
-    term_list_destroy(&(*tt)->tls);
-    free(*tt);
-  }
+  free(*tt);
   *tt = NULL;
 }
 
 bool term_argument_traversal_has_next(term_argument_traversal tt) {
   assert(tt != NULL);
-  return tt->tls != NULL;
+  return term_argument_iterator_has_next(&tt->it);
 }
 
 term term_argument_traversal_get_next(term_argument_traversal tt) {
   assert(tt != NULL);
   assert(term_argument_traversal_has_next(tt));
-  term t = tt->tls->t;
-  tt->tls = tt->tls->next;
-  return t;
+  return term_argument_iterator_next(&tt->it);
 }
+
+term_argument_iterator term_argument_iterator_start(term t) {
+  assert(t != NULL);
+  term_expand(t);
+  term_argument_iterator it = {t->argument_first};
+  return it;
+}
+
+bool term_argument_iterator_has_next(term_argument_iterator const *it) {
+  assert(it != NULL);
+  return it->next != NULL;
+}
+
+term term_argument_iterator_next(term_argument_iterator *it) {
+  assert(it != NULL);
+  term_list next = it->next;
+  if (next == NULL) {
+    return NULL;
+  }
+  it->next = next->next;
+  return next->t;
+}
+
 void term_set_symbol(term t, sstring symbol) {
-  sstring_destroy(&t->symbol);
-  t->symbol = sstring_copy(symbol);
+  term_modify(t);
+  term_expand_successor_run(t);
+  term_intern_symbol(t, symbol);
 }
@@ -43,16 +43,121 @@
  */
 typedef struct term_struct *term;
 
+/*!
+ * Kind of the symbol of a term.
+ * It is computed once, when the symbol is set, so that testing it is O(1).
+ */
+typedef enum {
+  /*! any other symbol */
+  TERM_KIND_SYMBOL,
+  /*! variable (see \c term_symbol_is_variable ) */
+  TERM_KIND_VARIABLE,
+  /*! decimal integer that fits in an \c int (see \c sstring_is_integer ) */
+  TERM_KIND_INTEGER
+} term_kind;
+
 /*!
  * Return a term composed of one symbol and no argument.
  * \param s symbol for the created term.
  * \pre s is non-empty and does not contains space nor parenthesis.
  * \return a newly created term with a copy of s as a symbol and no argument.
+ * The copy is interned: terms with the same symbol share it (see
+ * \c symbol_table.h ), it is released at exit and not before, even when no
+ * term uses it any more. Terms can be created by several threads at once.
  */
 extern term term_create(sstring symbol);
 
+/*!
+ * Return the Peano numeral \c S^n(0) , i.e. \c S ( S ( … 0 … ) ) with n \c S .
+ * It is stored as a single term, the arguments are only created when they are
+ * accessed (\c term_get_argument , traversal, modification…).
+ * \param n number of successors.
+ * \pre 0 ≤ \c n
+ * \return a newly created term.
+ */
+extern term term_create_peano(long n);
+
+/*!
+ * Return the number of successors stored as a run in a term.
+ * A result n > 0 means that \c t is \c S^n(0) and that its argument is not
+ * created yet. It is intended for functions that want to avoid creating them
+ * (like printing).
+ * No side effect, can be used in assert.
+ * \param t term to query.
+ * \pre t is non NULL.
+ * \return n if t is a \c S^n(0) run, 0 otherwise.
+ */
+extern long term_get_successor_run(term t);
+
+/*!
+ * Test whether a term is a Peano numeral \c S^n(0) (stored as a run or not).
+ * If true, then n is stored in *n_pt
+ * No side effect, can be used in assert.
+ * \param t term to query.
+ * \param n_pt where to put the value.
+ * \pre t and n_pt are non NULL.
+ * \return true if t is a Peano numeral.
+ */
+extern bool term_is_peano(term t, long *n_pt);
+
+/*!
+ * Test whether a term contains a \c S^n(0) run (in any sub-term).
+ * Functions reading such a term may create the arguments of the run, so it
+ * cannot be read by several threads at once.
+ * No side effect, can be used in assert.
+ * \param t term to query.
+ * \pre t is non NULL.
+ * \return true if t contains a run.
+ */
+extern bool term_contains_successor_run(term t);
+
+/*!
+ * Turn sharing on or off (it is off by default). When it is on, \c term_copy
+ * and \c term_replace_copy share the arguments of the copied term, which are
+ * reference counted (see \c term_copy ).
+ * The mode is global and read atomically: it can be changed at any time, the
+ * terms copied before keep working either way.
+ * \param enabled whether to share.
+ */
+extern void term_sharing_enable(bool enabled);
+
+/*!
+ * \return whether sharing is on.
+ */
+extern bool term_sharing_is_enabled(void);
+
+/*!
+ * Test whether the arguments of a term are shared with other terms (see
+ * \c term_copy ).
+ * No side effect, can be used in assert.
+ * \param t term to query.
+ * \pre t is non NULL.
+ * \return true if the arguments of t are shared.
+ */
+extern bool term_is_shared(term t);
+
+/*!
+ * Test whether a term contains shared arguments (in any sub-term).
+ * Functions reading such a term may clone them, so it cannot be read by
+ * several threads at once.
+ * No side effect, can be used in assert.
+ * \param t term to query.
+ * \pre t is non NULL.
+ * \return true if t contains shared arguments.
+ */
+extern bool term_contains_shared(term t);
+
+/*!
+ * Clone all the shared arguments of a term (at any depth), so that its
+ * sub-terms can be modified while it is traversed (see \c term_traverse ).
+ * \param t term to unshare.
+ * \pre t is non NULL.
+ */
+extern void term_unshare(term t);
+
 /*!
  * Destroy a term (including all arguments recursively)
+ * Any depth can be destroyed (see \c term_traverse ).
  * \param t term to destroy.
  * \pre \c t is non NULL
  */
@@ -60,6 +165,7 @@ extern void term_destroy(term *t);
 
 /*!
  * Return the symbol of a term (and not a copy).
+ * It is shared with other terms, so it must not be modified.
  * No side effect, can be used in assert.
  * \param t term to query.
  * \pre t is non NULL.
@@ -67,6 +173,60 @@ extern void term_destroy(term *t);
  */
 extern sstring term_get_symbol(term t);
 
+/*!
+ * To test whether a symbol is the one of a variable.
+ * It is the case if:
+ * \li first char is  '\''
+ * \li the next symbol belongs to 'a'-'z' 'A'-'Z'  '_'
+ * \li every other char in 'a'-'z' 'A'-'Z' '0'-'9' '_'
+ * No side effect, can be used in assert.
+ * \param symbol sstring to test.
+ * \pre symbol is non NULL.
+ * \return true if \c symbol is the one of a variable.
+ */
+extern bool term_symbol_is_variable(sstring symbol);
+
+/*!
+ * Return the kind of the symbol of a term, in O(1).
+ * No side effect, can be used in assert.
+ * \param t term to query.
+ * \pre t is non NULL.
+ * \return the kind of the symbol.
+ */
+extern term_kind term_get_kind(term t);
+
+/*!
+ * Return the interned copy of a symbol, the one shared by all the terms with
+ * this symbol (see \c term_create ). It belongs to the terms and must not be
+ * destroyed. Modules keep the ones of their keywords to recognize them with
+ * \c term_has_symbol .
+ * \param symbol symbol to look up.
+ * \pre symbol is non-empty and does not contains space nor parenthesis.
+ * \return the interned symbol.
+ */
+extern sstring term_symbol_intern(sstring symbol);
+
+/*!
+ * Test whether a term has a given symbol, in O(1).
+ * No side effect, can be used in assert.
+ * \param t term to query.
+ * \param symbol interned symbol (see \c term_symbol_intern ).
+ * \pre t is non NULL.
+ * \return true if the symbol of \c t is \c symbol .
+ */
+extern bool term_has_symbol(term t, sstring symbol);
+
+/*!
+ * Test whether the symbol of a term is an integer (\c TERM_KIND_INTEGER ), in
+ * O(1). If true, then the value is stored in *n_pt
+ * No side effect, can be used in assert.
+ * \param t term to query.
+ * \param n_pt where to put the value.
+ * \pre t and n_pt are non NULL.
+ * \return true if the symbol is an integer.
+ */
+extern bool term_get_integer(term t, int *n_pt);
+
 /*!
  * Return the arity of a term.
  * No side effect, can be used in assert.
@@ -126,6 +286,8 @@ extern bool term_contains_symbol(term t, sstring symbol);
 
 /*!
  * Return an argument (without making any copy).
+ * If the arguments of \c t are shared, they are cloned first (one level) so
+ * that the result can be modified.
  * Arguments are numbered from 0.
  * \param t queried term.
  * \param pos number of queried argument.
@@ -139,14 +301,60 @@ extern term term_get_argument(term t, int pos);
  * Return the ith argument of the term.
  * This argument is removed from the term.
  * Arguments are numbered from 0.
+ * Same as \c term_take_argument .
  * \pre \c t is non NULL.
  * \pre 0 ≤ \c pos ≤ arity .
  * \return the arguments number i.
  */
 extern term term_extract_argument(term t, int pos);
 
+/*!
+ * Remove the ith argument of the term and return it (it is not copied, the
+ * caller now owns it).
+ * Arguments are numbered from 0.
+ * \param t term to modify.
+ * \param pos position of the argument.
+ * \pre \c t is non NULL.
+ * \pre 0 ≤ \c pos < arity .
+ * \return the former argument number i, without father.
+ */
+extern term term_take_argument(term t, int pos);
+
+/*!
+ * Replace the ith argument of the term by another term, without copying.
+ * Arguments are numbered from 0.
+ * \param t term to modify.
+ * \param pos position of the argument.
+ * \param a new argument (\c t owns it afterwards).
+ * \pre \c t and \c a are non NULL.
+ * \pre \c a has no father.
+ * \pre 0 ≤ \c pos < arity .
+ * \return the former argument number i, without father (the caller owns it).
+ */
+extern term term_swap_argument(term t, int pos, term a);
+
 /*!
  * Deep copy of term (eveything is copied).
+ * Any depth can be copied (see \c term_traverse ).
+ *
+ * If sharing is on (see \c term_sharing_enable ), the copy shares its
+ * arguments with other terms: they are stored in a shared term, reference
+ * counted, and the copy is done in O(1). If the arguments of \c t are not
+ * shared, the first copy makes a frozen copy of them (only its sub-terms that
+ * do not share their arguments are copied), kept in \c t for the next copies.
+ * The sub-terms of \c t stay its own: modifying \c t or any of its sub-terms,
+ * however they were obtained, drops the frozen copy (the copies already made
+ * do not change).
+ * Shared arguments are never modified: a term clones them (one level, its
+ * arguments sharing theirs) when its arguments are accessed or modified
+ * (\c term_get_argument , iterators, \c term_add_argument_last …). Reading
+ * functions (\c term_compare , \c term_traverse , printing…) read them where
+ * they are stored.
+ * The counts are atomic: each thread can own copies of the same term. But
+ * since copying a term keeps its frozen copy in it, and accessing the
+ * arguments of a term that shares them modifies it, a term must not be copied
+ * nor accessed by two threads at once, even to read it: give each thread its
+ * own copy.
  * \param t term to be copied.
  * \pre \c t is non NULL
  * \return independent copy of \c t
@@ -155,6 +363,7 @@ extern term term_copy(term t);
 
 /*!
  * Deep copy of term (eveything is copied).
+ * Any depth can be copied (see \c term_traverse ).
  * \param t term to be copied.
  * \param loc if (*loc) term is found, then the value is changed to the
  * corresponding term in the copy.
@@ -167,6 +376,7 @@ extern term term_copy_translate_position(term t, term *loc);
  * Deep copy of term (eveything is copied).
  * The copy replace the designated term.
  * The designated term is destroyed.
+ * If sharing is on, the arguments of \c t_src are shared (see \c term_copy ).
  * \param t_loc term to be replaced.
  * \param t_src term to be copied.
  * \pre \c t_loc and \c t_src are non NULL
@@ -189,6 +399,19 @@ extern void term_replace_copy(term t_loc, term t_src);
  */
 extern int term_compare(term t1, term t2);
 
+/*!
+ * Replace a term (anywhere in its father) by another term, without copying.
+ * The symbol and arguments of \c *t_src are moved into \c t_loc and \c *t_src
+ * is destroyed.
+ * \c *t_src can be anywhere, in particular inside \c t_loc (e.g. to replace a
+ * term by one of its arguments): it is first removed from its father.
+ * \param t_loc term to replace (its former symbol and arguments are destroyed).
+ * \param t_src (location of the) term to move, set to NULL.
+ * \pre \c t_loc , \c t_src and \c *t_src are non NULL.
+ * \pre \c t_loc is not inside \c *t_src .
+ */
+extern void term_replace_move(term t_loc, term *t_src);
+
 /*!
  * This is used to visit all the argument of a term.
  */
@@ -201,7 +424,8 @@ typedef struct term_argument_traversal_struct *term_argument_traversal;
 extern term_argument_traversal term_argument_traversal_create(term t);
 
 /*!
- * To delete an argument of the arguments of a term.
+ * To delete a traversal of the arguments of a term (the term and its
+ * arguments are not modified, even if the traversal is not finished).
  * \param tt  traversal of the arguments of a term.
  * \pre tt is not NULL.
  */
@@ -222,5 +446,104 @@ extern bool term_argument_traversal_has_next(term_argument_traversal tt);
  * \return next argument.
  */
 extern term term_argument_traversal_get_next(term_argument_traversal tt);
+
+/*!
+ * Iterator over the arguments of a term, to be used as a local variable: it
+ * needs no allocation nor destruction.
+ * Its field is private.
+ * The arguments of the term must not be removed while it is used.
+ */
+typedef struct {
+  /*! private: next argument */
+  void *next;
+} term_argument_iterator;
+
+/*!
+ * Start an iterator on the arguments of a term.
+ * If the arguments of \c t are shared, they are cloned first (one level) so
+ * that they can be modified.
+ * \param t term to run through the arguments
+ * \pre \c t is not NULL.
+ * \return iterator on the first argument.
+ */
+extern term_argument_iterator term_argument_iterator_start(term t);
+
+/*!
+ * To test whether an iterator is finished or not.
+ * No side effect, can be used in assert.
+ * \param it iterator on the arguments of a term.
+ * \pre it is not NULL.
+ * \return true if there are still argument to visit
+ */
+extern bool term_argument_iterator_has_next(term_argument_iterator const *it);
+
+/*!
+ * To get an argument and move onto the next.
+ * \param it iterator on the arguments of a term.
+ * \pre it is not NULL.
+ * \return next argument, NULL if the iterator is finished.
+ */
+extern term term_argument_iterator_next(term_argument_iterator *it);
+
+/*!
+ * Loop on the arguments of a term, \c arg being an already declared \c term
+ * variable set to each argument in turn:
+ * \code
+ * term arg;
+ * term_for_each_argument(arg, t) {
+ *   …
+ * }
+ * \endcode
+ * \c break and \c return can be used freely inside the loop.
+ */
+#define term_for_each_argument(arg, t)                                         \
+  for (term_argument_iterator arg##_iterator =                                 \
+           term_argument_iterator_start(t);                                    \
+       ((arg) = term_argument_iterator_next(&arg##_iterator)) != NULL;)
 extern void term_set_symbol(term t, sstring symbol);
+
+/*!
+ * What a visitor of \c term_traverse tells the traversal to do next.
+ */
+typedef enum {
+  /*! go on (into the arguments for a pre-order visitor) */
+  TERM_VISIT_CONTINUE,
+  /*! do not visit the arguments of this term (pre-order visitor only) */
+  TERM_VISIT_SKIP,
+  /*! stop the whole traversal */
+  TERM_VISIT_STOP
+} term_visit;
+
+/*!
+ * Visitor called by \c term_traverse .
+ * \param t visited term.
+ * \param depth depth of t (0 for the traversed term).
+ * \param data user data passed to \c term_traverse .
+ * \return what to do next.
+ */
+typedef term_visit (*term_visitor)(term t, int depth, void *data);
+
+/*!
+ * Depth first traversal of a term with an explicit stack, so that its depth
+ * is only bounded by memory (not by the C stack).
+ * \c pre is called on a term before its arguments, \c post after them (\c post
+ * is called even if \c pre returned \c TERM_VISIT_SKIP ).
+ * The arguments of a term are read after \c pre returns, so \c pre can modify
+ * them (and should skip them if it replaced the term).
+ * The traversal does not access a term after \c post returns, so \c post can
+ * destroy it (but not its father).
+ * A \c S^n(0) run (see \c term_create_peano ) is visited as a term without
+ * argument, its arguments are not created.
+ * Shared arguments (see \c term_copy ) are visited where they are stored:
+ * the visitors must not modify them (call \c term_unshare first), nor rely on
+ * their father.
+ * \param t term to traverse.
+ * \param pre pre-order visitor (can be NULL).
+ * \param post post-order visitor (can be NULL).
+ * \param data passed to the visitors.
+ * \pre t is not NULL.
+ * \return false iff a visitor returned \c TERM_VISIT_STOP .
+ */
+extern bool term_traverse(term t, term_visitor pre, term_visitor post,
+                          void *data);
 #endif
@@ -0,0 +1,347 @@
+// threads, fmemopen and open_memstream are POSIX
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "rewrite.h"
+#include "term.h"
+#include "term_io.h"
+#include "term_trace.h"
+#include "unify.h"
+#include "valuate.h"
+
+#undef NDEBUG // FORCE ASSERT ACTIVATION
+
+/*!
+ * \file
+ * \brief Pipelined batch processor of terms.
+ *
+ * Usage: \c ./term_batch [ \c -j \c workers ] [ \c -o \c operation ] [ \c file
+ * ]
+ *
+ * The input (the file or the standard input) is a sequence of terms. Three
+ * stages overlap:
+ * \li a reader thread cuts the input into top-level terms and parses them,
+ * \li workers run \c term_rewrite , \c term_unify or \c term_valuate ,
+ * \li a writer thread prints the outputs in input order.
+ *
+ * The output of each term is byte for byte the output of the corresponding
+ * test driver ( \c test_rewrite , \c test_unify or \c test_valuate ) run on
+ * this term alone.
+ *
+ * The operation is given by \c -o ( \c rewrite , \c unify or \c valuate ).
+ * Without \c -o , it is chosen for each term by its root symbol: \c rewrite ,
+ * \c unify , anything else is valuated.
+ *
+ * At most \c REORDER_CAPACITY terms are in the pipeline at once, so that a
+ * slow term does not make the finished outputs after it pile up.
+ */
+
+/*! Default number of workers. */
+#define DEFAULT_NB_WORKERS 4
+
+/*! Maximum number of terms read but not yet written. */
+#define REORDER_CAPACITY 64
+
+/*!
+ * Operation applied to a term.
+ */
+typedef enum { OP_AUTO, OP_REWRITE, OP_UNIFY, OP_VALUATE } operation;
+
+/*!
+ * Term waiting for a worker.
+ */
+typedef struct {
+  /*! index of the term in the input */
+  long index;
+  /*! parsed term (belongs to the job) */
+  term t;
+} job;
+
+/*!
+ * State shared by the stages.
+ * Terms in the pipeline are those whose index is in
+ * [ \c next_to_write , \c nb_read ), their outputs are in \c outputs at
+ * index modulo \c REORDER_CAPACITY .
+ */
+static struct {
+  pthread_mutex_t lock;
+  /*! signaled when a job is queued */
+  pthread_cond_t job_ready;
+  /*! signaled when an output is ready */
+  pthread_cond_t output_ready;
+  /*! signaled when an output is written */
+  pthread_cond_t slot_free;
+  /*! jobs waiting for a worker (at most \c REORDER_CAPACITY ) */
+  job jobs[REORDER_CAPACITY];
+  int first_job;
+  int nb_jobs;
+  /*! outputs waiting to be written, NULL if not ready */
+  char *outputs[REORDER_CAPACITY];
+  size_t sizes[REORDER_CAPACITY];
+  /*! number of terms read */
+  long nb_read;
+  /*! index of the next output to write */
+  long next_to_write;
+  /*! whether the whole input is read */
+  bool read_done;
+} pipeline = {.lock = PTHREAD_MUTEX_INITIALIZER,
+              .job_ready = PTHREAD_COND_INITIALIZER,
+              .output_ready = PTHREAD_COND_INITIALIZER,
+              .slot_free = PTHREAD_COND_INITIALIZER};
+
+/*! Operation given on the command line. */
+static operation forced_operation = OP_AUTO;
+
+/*!
+ * Read the text of the next top-level term: a symbol, followed by its
+ * arguments if the next non space char is \c ( .
+ * Unmatched \c ) between terms are skipped (the test drivers stop reading at
+ * the end of their term, some test files have extra ones).
+ * \param in stream to read from.
+ * \param size where to store the length of the text.
+ * \return the text (allocated) or NULL at the end of the input.
+ */
+static char *read_term_text(FILE *in, size_t *size) {
+  int c;
+  do {
+    c = getc(in);
+  } while (c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == ')');
+  if (c == EOF) {
+    return NULL;
+  }
+  char *text = NULL;
+  FILE *out = open_memstream(&text, size);
+  assert(out != NULL);
+  int depth = 0;
+  bool symbol_done = false;
+  while (c != EOF) {
+    if (c == '(') {
+      depth++;
+    } else if (c == ')') {
+      depth--;
+      if (depth <= 0) {
+        fputc(c, out);
+        break;
+      }
+    } else if (depth == 0 && (c == ' ' || c == '\t' || c == '\n' ||
+                              c == '\r')) {
+      symbol_done = true;
+    } else if (depth == 0 && symbol_done) {
+      // leaf term: this char starts the next term
+      ungetc(c, in);
+      break;
+    }
+    fputc(c, out);
+    c = getc(in);
+  }
+  fclose(out);
+  return text;
+}
+
+/*!
+ * Operation applied to a term.
+ */
+static operation term_operation(term t) {
+  if (forced_operation != OP_AUTO) {
+    return forced_operation;
+  }
+  sstring rewrite = sstring_create_string("rewrite");
+  sstring unify = sstring_create_string("unify");
+  operation op = sstring_equals(term_get_symbol(t), rewrite) ? OP_REWRITE
+                 : sstring_equals(term_get_symbol(t), unify) ? OP_UNIFY
+                                                             : OP_VALUATE;
+  sstring_destroy(&rewrite);
+  sstring_destroy(&unify);
+  return op;
+}
+
+/*!
+ * Print the output of the test driver of the operation.
+ * \param t term (destroyed).
+ * \param out stream to print to.
+ */
+static void term_process(term t, FILE *out) {
+  term res;
+  switch (term_operation(t)) {
+  case OP_REWRITE: // as test_rewrite
+    term_print_expanded(t, out);
+    term_print_compact(t, out);
+    fputc('\n', out);
+    res = term_rewrite(t);
+    term_destroy(&t);
+    term_print_compact(res, out);
+    fputc('\n', out);
+    break;
+  case OP_UNIFY: // as test_unify
+    term_print_expanded(t, out);
+    res = term_unify(t);
+    term_print_compact(t, out);
+    fputc('\n', out);
+    term_destroy(&t);
+    term_print_compact(res, out);
+    fprintf(out, "\n");
+    break;
+  default: // as test_valuate
+    term_print_expanded(t, out);
+    res = term_valuate(t);
+    term_print_compact(t, out);
+    fputc('\n', out);
+    term_destroy(&t);
+    term_print_compact(res, out);
+    fputc('\n', out);
+    break;
+  }
+  term_destroy(&res);
+}
+
+static void *reader_run(void *data) {
+  FILE *in = data;
+  char *text;
+  size_t size;
+  while ((text = read_term_text(in, &size)) != NULL) {
+    FILE *text_in = fmemopen(text, size, "r");
+    assert(text_in != NULL);
+    job j;
+    j.t = term_scan(text_in);
+    fclose(text_in);
+    free(text);
+    pthread_mutex_lock(&pipeline.lock);
+    while (pipeline.nb_read - pipeline.next_to_write >= REORDER_CAPACITY) {
+      pthread_cond_wait(&pipeline.slot_free, &pipeline.lock);
+    }
+    j.index = pipeline.nb_read++;
+    pipeline.jobs[(pipeline.first_job + pipeline.nb_jobs) % REORDER_CAPACITY] =
+        j;
+    pipeline.nb_jobs++;
+    pthread_cond_signal(&pipeline.job_ready);
+    pthread_mutex_unlock(&pipeline.lock);
+  }
+  pthread_mutex_lock(&pipeline.lock);
+  pipeline.read_done = true;
+  pthread_cond_broadcast(&pipeline.job_ready);
+  pthread_cond_broadcast(&pipeline.output_ready);
+  pthread_mutex_unlock(&pipeline.lock);
+  return NULL;
+}
+
+static void *worker_run(void *data) {
+  (void)data;
+  for (;;) {
+    pthread_mutex_lock(&pipeline.lock);
+    while (pipeline.nb_jobs == 0 && !pipeline.read_done) {
+      pthread_cond_wait(&pipeline.job_ready, &pipeline.lock);
+    }
+    if (pipeline.nb_jobs == 0) {
+      pthread_mutex_unlock(&pipeline.lock);
+      return NULL;
+    }
+    job j = pipeline.jobs[pipeline.first_job];
+    pipeline.first_job = (pipeline.first_job + 1) % REORDER_CAPACITY;
+    pipeline.nb_jobs--;
+    pthread_mutex_unlock(&pipeline.lock);
+
+    char *output = NULL;
+    size_t size = 0;
+    FILE *out = open_memstream(&output, &size);
+    assert(out != NULL);
+    term_process(j.t, out);
+    fclose(out);
+
+    pthread_mutex_lock(&pipeline.lock);
+    pipeline.outputs[j.index % REORDER_CAPACITY] = output;
+    pipeline.sizes[j.index % REORDER_CAPACITY] = size;
+    if (j.index == pipeline.next_to_write) {
+      pthread_cond_signal(&pipeline.output_ready);
+    }
+    pthread_mutex_unlock(&pipeline.lock);
+  }
+}
+
+static void *writer_run(void *data) {
+  FILE *out = data;
+  for (;;) {
+    pthread_mutex_lock(&pipeline.lock);
+    int slot = pipeline.next_to_write % REORDER_CAPACITY;
+    while (pipeline.outputs[slot] == NULL &&
+           !(pipeline.read_done &&
+             pipeline.next_to_write == pipeline.nb_read)) {
+      pthread_cond_wait(&pipeline.output_ready, &pipeline.lock);
+    }
+    char *output = pipeline.outputs[slot];
+    size_t size = pipeline.sizes[slot];
+    pthread_mutex_unlock(&pipeline.lock);
+    if (output == NULL) {
+      return NULL;
+    }
+    fwrite(output, 1, size, out);
+    free(output);
+    pthread_mutex_lock(&pipeline.lock);
+    pipeline.outputs[slot] = NULL;
+    pipeline.next_to_write++;
+    pthread_cond_signal(&pipeline.slot_free);
+    pthread_mutex_unlock(&pipeline.lock);
+  }
+}
+
+int main(int argc, char **argv) {
+  int nb_workers = DEFAULT_NB_WORKERS;
+  int option;
+  while ((option = getopt(argc, argv, "j:o:")) != -1) {
+    if (option == 'j' && atoi(optarg) > 0) {
+      nb_workers = atoi(optarg);
+    } else if (option == 'o' && strcmp(optarg, "rewrite") == 0) {
+      forced_operation = OP_REWRITE;
+    } else if (option == 'o' && strcmp(optarg, "unify") == 0) {
+      forced_operation = OP_UNIFY;
+    } else if (option == 'o' && strcmp(optarg, "valuate") == 0) {
+      forced_operation = OP_VALUATE;
+    } else {
+      optind = argc + 1;
+      break;
+    }
+  }
+  if (optind + 1 < argc || optind > argc) {
+    fprintf(stderr,
+            "usage: %s [-j workers] [-o rewrite|unify|valuate] [file]\n",
+            argv[0]);
+    return 1;
+  }
+  FILE *in = stdin;
+  if (optind < argc) {
+    in = fopen(argv[optind], "r");
+    if (in == NULL) {
+      perror(argv[optind]);
+      return 1;
+    }
+  }
+  // reads TERM_TRACE before the workers start
+  term_trace_is_enabled();
+
+  pthread_t reader, writer;
+  pthread_t *workers = malloc(nb_workers * sizeof(pthread_t));
+  assert(workers != NULL);
+  int error = pthread_create(&reader, NULL, reader_run, in);
+  assert(error == 0);
+  for (int i = 0; i < nb_workers; i++) {
+    error = pthread_create(&workers[i], NULL, worker_run, NULL);
+    assert(error == 0);
+  }
+  error = pthread_create(&writer, NULL, writer_run, stdout);
+  assert(error == 0);
+  pthread_join(reader, NULL);
+  for (int i = 0; i < nb_workers; i++) {
+    pthread_join(workers[i], NULL);
+  }
+  pthread_join(writer, NULL);
+  free(workers);
+  if (in != stdin) {
+    fclose(in);
+  }
+  return 0;
+}
@@ -1,6 +1,10 @@
+// fmemopen is POSIX
+#define _POSIX_C_SOURCE 200809L
+
 #include <assert.h>
 #include <ctype.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "term_io.h"
 
@@ -93,6 +97,62 @@ term term_scan(FILE *in) {
   return start;
 }
 
+bool term_text_is_term(char const *text) {
+  assert(text != NULL);
+  int depth = 0;
+  bool after_symbol = false;
+  bool done = false;
+  for (char const *c = text; *c != '\0'; c++) {
+    if (*c == ' ' || *c == '\t' || *c == '\n' || *c == '\r') {
+      continue;
+    }
+    if (done) {
+      return false;
+    }
+    if (*c == '(') {
+      if (!after_symbol) {
+        return false;
+      }
+      depth++;
+      after_symbol = false;
+    } else if (*c == ')') {
+      if (depth == 0) {
+        return false;
+      }
+      depth--;
+      after_symbol = false;
+      done = depth == 0;
+    } else {
+      if (depth == 0 && after_symbol) {
+        return false;
+      }
+      int length = 1;
+      while (c[1] != '\0' && c[1] != '(' && c[1] != ')' && c[1] != ' ' &&
+             c[1] != '\t' && c[1] != '\n' && c[1] != '\r') {
+        c++;
+        length++;
+      }
+      if (length > SYMBOL_STRING_LENGHT_BASE - 1) {
+        return false;
+      }
+      after_symbol = true;
+    }
+  }
+  return depth == 0 && (done || after_symbol);
+}
+
+term term_scan_text(char const *text) {
+  assert(text != NULL);
+  if (!term_text_is_term(text)) {
+    return NULL;
+  }
+  FILE *in = fmemopen((void *)text, strlen(text), "r");
+  assert(in != NULL);
+  term t = term_scan(in);
+  fclose(in);
+  return t;
+}
+
 /*!
  * To add spaces to a stream.
  * \param n half the number of spaces to add.
@@ -105,53 +165,98 @@ static inline void add_space_prefix(int n, FILE *out) {
 }
 
 /*!
- * Recursive function called by \c  term_print_expanded .
+ * Pre-order visitor of \c term_print_expanded : symbol and opening
+ * parenthesis.
  * \param t (sub-)term to print
- * \param out output stream to print to.
  * \param depth nesting inside the main term. It is used to handle indentation.
+ * \param data output stream to print to.
  */
-static void term_print_expanded_rec(term const t, FILE *const out,
-                                    int const depth) {
-  assert(t != NULL);
+static term_visit term_print_expanded_pre(term t, int depth, void *data) {
+  FILE *const out = data;
+  long run = term_get_successor_run(t);
+  if (run > 0) {
+    // S^run(0) printed without creating the arguments
+    for (long i = 0; i < run; i++) {
+      add_space_prefix(depth + i, out);
+      fprintf(out, "S (\n");
+    }
+    add_space_prefix(depth + run, out);
+    fprintf(out, "0\n");
+    for (long i = run - 1; i >= 0; i--) {
+      add_space_prefix(depth + i, out);
+      fprintf(out, i > 0 ? ")\n" : ")");
+    }
+    fprintf(out, "\n");
+    return TERM_VISIT_SKIP;
+  }
   add_space_prefix(depth, out);
   sstring_print(term_get_symbol(t), out);
-  if (term_get_arity(t)) {
-    fprintf(out, " (\n");
-    for (int i = 0; i < term_get_arity(t); i++) {
-      term_print_expanded_rec(term_get_argument(t, i), out, depth + 1);
-    }
+  fprintf(out, term_get_arity(t) ? " (\n" : "\n");
+  return TERM_VISIT_CONTINUE;
+}
+
+/*!
+ * Post-order visitor of \c term_print_expanded : closing parenthesis.
+ */
+static term_visit term_print_expanded_post(term t, int depth, void *data) {
+  FILE *const out = data;
+  if (term_get_successor_run(t) == 0 && term_get_arity(t)) {
     add_space_prefix(depth, out);
-    fprintf(out, ")");
+    fprintf(out, ")\n");
   }
-  fprintf(out, "\n");
+  return TERM_VISIT_CONTINUE;
 }
 
 void term_print_expanded(term t, FILE *out) {
   assert(NULL != t);
   assert(NULL != out);
-  term_print_expanded_rec(t, out, 0);
+  term_traverse(t, term_print_expanded_pre, term_print_expanded_post, out);
 }
 
 /*!
- * Recursive function called by \c term_print_compact .
+ * Pre-order visitor of \c term_print_compact : symbol and opening parenthesis.
  * \param t (sub-)term to print
- * \param out output stream to print to.
+ * \param depth nesting inside the main term.
+ * \param data output stream to print to.
  */
-static void term_print_compact_rec(term const t, FILE *const out) {
-  assert(t != NULL);
+static term_visit term_print_compact_pre(term t, int depth, void *data) {
+  FILE *const out = data;
+  long run = term_get_successor_run(t);
+  if (run > 0) {
+    // S^run(0) printed without creating the arguments
+    for (long i = 0; i < run; i++) {
+      fputs("S ( ", out);
+    }
+    fputs("0", out);
+    for (long i = 0; i < run; i++) {
+      fputs(" )", out);
+    }
+    return TERM_VISIT_SKIP;
+  }
   sstring_print(term_get_symbol(t), out);
   if (term_get_arity(t)) {
     fprintf(out, " ( ");
-    for (int i = 0; i < term_get_arity(t); i++) {
-      term_print_compact_rec(term_get_argument(t, i), out);
-      fprintf(out, " ");
-    }
+  }
+  return TERM_VISIT_CONTINUE;
+}
+
+/*!
+ * Post-order visitor of \c term_print_compact : closing parenthesis and
+ * separator after an argument.
+ */
+static term_visit term_print_compact_post(term t, int depth, void *data) {
+  FILE *const out = data;
+  if (term_get_successor_run(t) == 0 && term_get_arity(t)) {
     fprintf(out, ")");
   }
+  if (depth > 0) {
+    fprintf(out, " ");
+  }
+  return TERM_VISIT_CONTINUE;
 }
 
 void term_print_compact(term t, FILE *out) {
   assert(NULL != t);
   assert(NULL != out);
-  term_print_compact_rec(t, out);
+  term_traverse(t, term_print_compact_pre, term_print_compact_post, out);
 }
@@ -30,6 +30,24 @@
  */
 extern term term_scan(FILE *in);
 
+/*!
+ * Check that a text is exactly one term in the syntax of \c term_scan :
+ * \verbatim term := symbol [ ( term* ) ] \endverbatim
+ * with symbols that \c term_scan reads in one piece (at most 29 chars).
+ * \param text text to check.
+ * \pre \c text is non NULL.
+ * \return whether \c term_scan can read it.
+ */
+extern bool term_text_is_term(char const *text);
+
+/*!
+ * Read a term from a text, checked with \c term_text_is_term first.
+ * \param text text to read.
+ * \pre \c text is non NULL.
+ * \return read term, or NULL if \c text is not exactly one term.
+ */
+extern term term_scan_text(char const *text);
+
 /*!
  * Print a term on a stream.
  * It is printed is expanded format: line breaking and indentation like in:
@@ -0,0 +1,267 @@
+#include <assert.h>
+#include <stdlib.h>
+
+#include "check.h"
+#include "scheduler.h"
+#include "term_parallel.h"
+#include "term_stats.h"
+
+#undef NDEBUG // FORCE ASSERT ACTIVATION
+
+/*!
+ * Number of levels from which the sequential functions are used (so that
+ * chains of unary terms do not make the recursion too deep).
+ */
+#define PARALLEL_MAX_LEVELS 64
+
+/*!
+ * Chunk of consecutive arguments, processed by one task.
+ */
+typedef struct {
+  /*! number of splits still allowed below the arguments */
+  int splits_left;
+  /*! depth of the arguments */
+  int level;
+  /*! arguments (of the first term for compare) */
+  term *args;
+  /*! copies of the arguments (copy) or arguments of the second term
+   * (compare) */
+  term *others;
+  /*! number of arguments */
+  int nb;
+  /*! result of compare */
+  int compare;
+} chunk;
+
+/*!
+ * Chunks of a node, given to \c scheduler_parallel_for .
+ */
+typedef struct {
+  /*! function processing a chunk */
+  void (*run)(chunk *c);
+  chunk *chunks;
+} chunk_set;
+
+/*!
+ * State of \c term_size_bounded .
+ */
+typedef struct {
+  long count;
+  long bound;
+} size_state;
+
+static term_visit size_pre(term t, int depth, void *data) {
+  size_state *state = data;
+  state->count++;
+  return state->count >= state->bound ? TERM_VISIT_STOP : TERM_VISIT_CONTINUE;
+}
+
+/*!
+ * Number of nodes of a term (a run counts for one), stopping at \c bound .
+ * \return the number of nodes if it is less than \c bound , \c bound otherwise.
+ */
+static long term_size_bounded(term t, long bound) {
+  size_state state = {0, bound};
+  term_traverse(t, size_pre, NULL, &state);
+  return state.count;
+}
+
+/*!
+ * Test whether a term is inside another one (or is it).
+ * No side effect, can be used in assert.
+ */
+static bool term_is_inside(term t, term container) {
+  for (; t != NULL; t = term_get_father(t)) {
+    if (t == container) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/*!
+ * Whether the parallel code is worth running on a term (see
+ * \c term_parallel.h ).
+ */
+static bool parallel_is_useful(term t) {
+  return scheduler_get_current_nb_workers() > 1 && !term_stats_is_enabled() &&
+         !term_sharing_is_enabled() &&
+         term_size_bounded(t, PARALLEL_MIN_NODES) >= PARALLEL_MIN_NODES;
+}
+
+static void chunk_set_run(void *data, int i) {
+  chunk_set *set = data;
+  set->run(&set->chunks[i]);
+}
+
+/*!
+ * Split the arguments of a term into chunks of consecutive arguments (within
+ * the budget of splits), run them as tasks and wait for them.
+ * \param args arguments.
+ * \param others array of the same length as \c args given to the chunks (can
+ * be NULL).
+ * \return the first non zero \c compare of the chunks, 0 if none.
+ */
+static int chunks_run(int splits_left, int level, void (*run)(chunk *c),
+                      term *args, term *others, int nb) {
+  int const nb_chunks = scheduler_split(&splits_left, nb);
+  chunk *chunks = malloc(nb_chunks * sizeof(chunk));
+  assert(chunks != NULL);
+  for (int i = 0; i < nb_chunks; i++) {
+    int const first = (long)i * nb / nb_chunks;
+    chunk *c = &chunks[i];
+    c->splits_left = splits_left;
+    c->level = level;
+    c->args = args + first;
+    c->others = others == NULL ? NULL : others + first;
+    c->nb = (long)(i + 1) * nb / nb_chunks - first;
+    c->compare = 0;
+  }
+  chunk_set set = {run, chunks};
+  scheduler_parallel_for(nb_chunks, chunk_set_run, &set);
+  int compare = 0;
+  for (int i = 0; i < nb_chunks && compare == 0; i++) {
+    compare = chunks[i].compare;
+  }
+  free(chunks);
+  return compare;
+}
+
+/*!
+ * Whether a term is handled by the sequential functions.
+ */
+static bool node_is_sequential(term t, int splits_left, int level) {
+  return splits_left <= 0 || level >= PARALLEL_MAX_LEVELS ||
+         term_get_successor_run(t) > 0 || term_get_arity(t) == 0 ||
+         term_is_shared(t);
+}
+
+/*!
+ * Arguments of a term, in an allocated array.
+ * \param t term (not a run).
+ * \param extra number of additional cells at the end of the array.
+ */
+static term *term_arguments(term t, int extra) {
+  term *args = malloc((term_get_arity(t) + extra) * sizeof(term));
+  assert(args != NULL);
+  int i = 0;
+  term arg;
+  term_for_each_argument(arg, t) { args[i++] = arg; }
+  return args;
+}
+
+static term copy_node(term t, int splits_left, int level);
+
+static void copy_chunk(chunk *c) {
+  for (int i = 0; i < c->nb; i++) {
+    c->others[i] = copy_node(c->args[i], c->splits_left, c->level);
+  }
+}
+
+static term copy_node(term t, int splits_left, int level) {
+  if (node_is_sequential(t, splits_left, level)) {
+    return term_copy(t);
+  }
+  int const arity = term_get_arity(t);
+  term *args = term_arguments(t, arity);
+  term *copies = args + arity;
+  chunks_run(splits_left, level + 1, copy_chunk, args, copies, arity);
+  term copy = term_create(term_get_symbol(t));
+  for (int i = 0; i < arity; i++) {
+    term_add_argument_last(copy, copies[i]);
+  }
+  free(args);
+  return copy;
+}
+
+static int compare_node(term t1, term t2, int splits_left, int level);
+
+static void compare_chunk(chunk *c) {
+  for (int i = 0; i < c->nb && c->compare == 0; i++) {
+    c->compare =
+        compare_node(c->args[i], c->others[i], c->splits_left, c->level);
+  }
+}
+
+static int compare_node(term t1, term t2, int splits_left, int level) {
+  if (node_is_sequential(t1, splits_left, level) ||
+      term_get_successor_run(t2) > 0 || term_is_shared(t2)) {
+    return term_compare(t1, t2);
+  }
+  // same order as term_compare
+  int compare = sstring_compare(term_get_symbol(t1), term_get_symbol(t2));
+  if (compare == 0) {
+    compare = term_get_arity(t1) - term_get_arity(t2);
+  }
+  int const arity = term_get_arity(t1);
+  if (compare != 0 || arity == 0) {
+    return compare;
+  }
+  term *args = term_arguments(t1, arity);
+  term *others = args + arity;
+  int i = 0;
+  term arg;
+  term_for_each_argument(arg, t2) { others[i++] = arg; }
+  compare =
+      chunks_run(splits_left, level + 1, compare_chunk, args, others, arity);
+  free(args);
+  return compare;
+}
+
+static void destroy_node(term t, int splits_left, int level);
+
+static void destroy_chunk(chunk *c) {
+  for (int i = 0; i < c->nb; i++) {
+    destroy_node(c->args[i], c->splits_left, c->level);
+  }
+}
+
+/*!
+ * Destroy a term: its arguments are detached, then destroyed by chunks.
+ */
+static void destroy_node(term t, int splits_left, int level) {
+  if (node_is_sequential(t, splits_left, level)) {
+    term_destroy(&t);
+    return;
+  }
+  int const arity = term_get_arity(t);
+  term *args = malloc(arity * sizeof(term));
+  assert(args != NULL);
+  for (int i = 0; i < arity; i++) {
+    args[i] = term_take_argument(t, 0);
+  }
+  term_destroy(&t);
+  chunks_run(splits_left, level + 1, destroy_chunk, args, NULL, arity);
+  free(args);
+}
+
+term term_copy_parallel(term t) {
+  assert(t != NULL);
+  if (!parallel_is_useful(t)) {
+    return term_copy(t);
+  }
+  return copy_node(t, scheduler_get_current_split_depth(), 0);
+}
+
+int term_compare_parallel(term t1, term t2) {
+  assert(t1 != NULL);
+  assert(t2 != NULL);
+  if (!parallel_is_useful(t1)) {
+    return term_compare(t1, t2);
+  }
+  if (t1 == t2) {
+    return 0;
+  }
+  CHECK(!term_is_inside(t1, t2) && !term_is_inside(t2, t1));
+  return compare_node(t1, t2, scheduler_get_current_split_depth(), 0);
+}
+
+void term_destroy_parallel(term *t) {
+  assert(t != NULL);
+  if (*t == NULL || !parallel_is_useful(*t)) {
+    term_destroy(t);
+    return;
+  }
+  destroy_node(*t, scheduler_get_current_split_depth(), 0);
+  *t = NULL;
+}
@@ -0,0 +1,60 @@
+#ifndef __TERM_PARALLEL_H
+#define __TERM_PARALLEL_H
+
+#include "term.h"
+
+/*!
+ * \file
+ * \brief Multi-threaded versions of \c term_copy , \c term_compare and
+ * \c term_destroy for huge terms.
+ *
+ * The arguments of a term are split into chunks of consecutive arguments, and
+ * the arguments of the arguments likewise, until there are enough chunks to
+ * balance the work (see \c scheduler_split ). The chunks are run as tasks by
+ * the workers of the scheduler the calling thread is in (see
+ * \c scheduler.h ), each allocates its own nodes (the \c malloc arenas are per
+ * thread).
+ *
+ * The results are exactly those of the sequential functions, which are used
+ * instead when:
+ * \li the calling thread is not in a scheduler with at least 2 workers,
+ * \li the term has less than \c PARALLEL_MIN_NODES nodes,
+ * \li counting is on (see \c term_stats.h , counters are not thread-safe),
+ * \li sharing is on (see \c term_sharing_enable , a copy is then in O(1)).
+ *
+ * Sub-terms with shared arguments are handled by the sequential functions.
+ *
+ * Terms given to these functions must not be accessed by other threads during
+ * the call.
+ */
+
+/*!
+ * Minimum number of nodes of a term for the threads to be used.
+ */
+#define PARALLEL_MIN_NODES 8192
+
+/*!
+ * Same as \c term_copy , with the workers of the current scheduler.
+ * \param t term to be copied.
+ * \pre \c t is non NULL
+ * \return independent copy of \c t
+ */
+extern term term_copy_parallel(term t);
+
+/*!
+ * Same as \c term_compare , with the workers of the current scheduler.
+ * \param t1,t2 term to be compared.
+ * \pre \c t1 and \c t2 are non NULL and either the same term or with no
+ * common node.
+ * \return same as \c term_compare
+ */
+extern int term_compare_parallel(term t1, term t2);
+
+/*!
+ * Same as \c term_destroy , with the workers of the current scheduler.
+ * \param t pointer to the term to destroy (set to NULL).
+ * \pre \c t is non NULL.
+ */
+extern void term_destroy_parallel(term *t);
+
+#endif
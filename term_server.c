@@ -0,0 +1,539 @@
+// sockets, threads, getline, fmemopen and open_memstream are POSIX
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "expression.h"
+#include "peano.h"
+#include "rewrite.h"
+#include "term.h"
+#include "term_io.h"
+#include "term_trace.h"
+#include "term_variable.h"
+#include "unify.h"
+#include "valuate.h"
+
+#undef NDEBUG // FORCE ASSERT ACTIVATION
+
+/*!
+ * \file
+ * \brief Long-running rewrite / unify / valuate / expression / peano service.
+ *
+ * Usage: \c ./term_server [ \c -j \c workers ] [ \c -s \c socket_path ]
+ *
+ * Without \c -s , requests are read on the standard input and responses are
+ * written on the standard output; the server stops at the end of the input
+ * once every request is answered.
+ * With \c -s , the server listens on a Unix domain socket and serves each
+ * connection the same way, until it is killed.
+ *
+ * A request is one line: an operation and a term (on the same line)
+ * \verbatim <operation> <term> \endverbatim
+ * where the operation is \c rewrite , \c unify , \c valuate , \c expression or
+ * \c peano . Empty lines are ignored.
+ *
+ * Requests are served concurrently by a fixed pool of workers, so responses
+ * may come out of order. Each response is one line that starts with the
+ * number of the request on its connection (from 0):
+ * \verbatim <number> ok <compact result>
+ <number> error <message> \endverbatim
+ *
+ * Each worker keeps its evaluation contexts between requests. Rule sets are
+ * not kept: a \c rewrite request carries its rules, which are parsed and
+ * checked with the rest of its term each time.
+ * Symbols are interned until the server stops (see \c term_create ), so its
+ * memory grows with the number of distinct symbols of all the requests.
+ *
+ * Requests are checked (syntax, depth and shape of the term for the
+ * operation) before being run, so that a malformed request does not stop the
+ * server. Terms deeper than \c REQUEST_MAX_DEPTH are refused.
+ * Expressions are valuated exactly, a division by zero is an error. Peano
+ * results greater than \c PEANO_MAX are an overflow error.
+ */
+
+/*! Default number of workers. */
+#define DEFAULT_NB_WORKERS 4
+
+/*!
+ * Greatest value of a peano result: \c S^n(0) is printed with 6 characters
+ * per successor.
+ */
+#define PEANO_MAX 100000
+
+/*!
+ * Maximum depth of the term of a request. Some engines recurse on the depth
+ * of the terms they build (valuate, rewrite, expression compilation).
+ */
+#define REQUEST_MAX_DEPTH 10000
+
+/*!
+ * Stack size of the workers, room for the recursion of the engines on terms
+ * deeper than the requests (results of valuate or rewrite).
+ */
+#define WORKER_STACK_SIZE (64 * 1024 * 1024)
+
+/*! Maximum number of requests waiting for a worker. */
+#define QUEUE_CAPACITY 256
+
+/*!
+ * Client connection (or standard input / output).
+ * It is closed once it is read to the end and every request is answered.
+ */
+typedef struct connection_struct {
+  /*! stream requests are read from */
+  FILE *in;
+  /*! file descriptor responses are written to */
+  int out;
+  /*! serializes the responses */
+  pthread_mutex_t lock;
+  /*! number of requests read but not answered */
+  long pending;
+  /*! whether the whole input is read */
+  bool read_done;
+  /*! whether \c in and \c out are closed with the connection */
+  bool owns_streams;
+} connection_struct, *connection;
+
+/*!
+ * Request waiting for a worker.
+ */
+typedef struct {
+  /*! connection to answer on */
+  connection conn;
+  /*! number of the request on its connection */
+  long number;
+  /*! request line (allocated) */
+  char *line;
+} request;
+
+/*!
+ * Bounded queue of requests shared by the readers and the workers.
+ */
+static struct {
+  request requests[QUEUE_CAPACITY];
+  int first;
+  int size;
+  pthread_mutex_t lock;
+  pthread_cond_t not_empty;
+  pthread_cond_t not_full;
+} queue = {.first = 0,
+           .size = 0,
+           .lock = PTHREAD_MUTEX_INITIALIZER,
+           .not_empty = PTHREAD_COND_INITIALIZER,
+           .not_full = PTHREAD_COND_INITIALIZER};
+
+/*!
+ * State kept warm by a worker between requests.
+ */
+typedef struct {
+  pthread_t thread;
+  valuate_context valuate;
+  expression_context expression;
+  peano_context peano;
+} worker;
+
+static connection connection_create(FILE *in, int out, bool owns_streams) {
+  connection conn = malloc(sizeof(connection_struct));
+  assert(conn != NULL);
+  conn->in = in;
+  conn->out = out;
+  pthread_mutex_init(&conn->lock, NULL);
+  conn->pending = 0;
+  conn->read_done = false;
+  conn->owns_streams = owns_streams;
+  return conn;
+}
+
+/*!
+ * Release a connection if it is finished.
+ * \pre the lock of the connection is held, it is released.
+ */
+static void connection_release(connection conn) {
+  bool const finished = conn->read_done && conn->pending == 0;
+  pthread_mutex_unlock(&conn->lock);
+  if (finished) {
+    if (conn->owns_streams) {
+      fclose(conn->in);
+      close(conn->out);
+    }
+    pthread_mutex_destroy(&conn->lock);
+    free(conn);
+  }
+}
+
+static void queue_push(request r) {
+  pthread_mutex_lock(&queue.lock);
+  while (queue.size == QUEUE_CAPACITY) {
+    pthread_cond_wait(&queue.not_full, &queue.lock);
+  }
+  queue.requests[(queue.first + queue.size) % QUEUE_CAPACITY] = r;
+  queue.size++;
+  pthread_cond_signal(&queue.not_empty);
+  pthread_mutex_unlock(&queue.lock);
+}
+
+static request queue_pop(void) {
+  pthread_mutex_lock(&queue.lock);
+  while (queue.size == 0) {
+    pthread_cond_wait(&queue.not_empty, &queue.lock);
+  }
+  request r = queue.requests[queue.first];
+  queue.first = (queue.first + 1) % QUEUE_CAPACITY;
+  queue.size--;
+  pthread_cond_signal(&queue.not_full);
+  pthread_mutex_unlock(&queue.lock);
+  return r;
+}
+
+/*!
+ * Test the symbol of a term against a C-string.
+ */
+static bool term_symbol_is(term t, char const *const symbol) {
+  sstring s = sstring_create_string(symbol);
+  bool res = sstring_equals(term_get_symbol(t), s);
+  sstring_destroy(&s);
+  return res;
+}
+
+/*!
+ * Check the shape required by \c term_rewrite .
+ */
+static bool rewrite_is_valid(term t) {
+  int arity = term_get_arity(t);
+  if (!term_symbol_is(t, "rewrite") || arity < 1) {
+    return false;
+  }
+  int factor;
+  term first = term_get_argument(t, 0);
+  int start = term_get_integer(first, &factor) && factor > 1 ? 1 : 0;
+  if (arity - 1 < start) {
+    return false;
+  }
+  for (int i = start; i < arity - 1; i++) {
+    term rule = term_get_argument(t, i);
+    if (!term_symbol_is(rule, "->") || term_get_arity(rule) != 2) {
+      return false;
+    }
+  }
+  return !term_symbol_is(term_get_argument(t, arity - 1), "->");
+}
+
+/*!
+ * Check the shape required by \c term_unify .
+ */
+static bool unify_is_valid(term t) {
+  if (!term_symbol_is(t, "unify") || term_get_arity(t) < 1) {
+    return false;
+  }
+  term equality;
+  term_for_each_argument(equality, t) {
+    if (!term_symbol_is(equality, "=") || term_get_arity(equality) != 2) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*!
+ * Pre-order visitor of \c valuate_is_valid : every \c set has a variable and
+ * a value to bind it to, and a body.
+ */
+static term_visit valuate_check_set(term t, int depth, void *data) {
+  (void)depth;
+  if (term_symbol_is(t, "set") &&
+      (term_get_arity(t) != 3 ||
+       !term_is_variable(term_get_argument(t, 0)))) {
+    *(bool *)data = false;
+    return TERM_VISIT_STOP;
+  }
+  return TERM_VISIT_CONTINUE;
+}
+
+/*!
+ * Check the shape required by \c term_valuate .
+ */
+static bool valuate_is_valid(term t) {
+  bool valid = true;
+  term_traverse(t, valuate_check_set, NULL, &valid);
+  return valid;
+}
+
+/*!
+ * Pre-order visitor of \c term_is_deeper , stops below the maximum depth.
+ */
+static term_visit term_depth_check(term t, int depth, void *data) {
+  (void)t;
+  return depth > *(int *)data ? TERM_VISIT_STOP : TERM_VISIT_CONTINUE;
+}
+
+/*!
+ * Test whether a term is deeper than a limit (a run is a single term).
+ */
+static bool term_is_deeper(term t, int max_depth) {
+  return !term_traverse(t, term_depth_check, NULL, &max_depth);
+}
+
+/*!
+ * Run a request.
+ * \param w worker running the request.
+ * \param line request line.
+ * \param out stream to write the compact result to.
+ * \return NULL on success, an error message otherwise.
+ */
+static char const *request_run(worker *w, char *line, FILE *out) {
+  char *operation = line + strspn(line, " \t");
+  char *text = operation + strcspn(operation, " \t\n\r");
+  if (*text != '\0') {
+    *text++ = '\0';
+  }
+  term t = term_scan_text(text);
+  if (t == NULL) {
+    return "malformed term";
+  }
+  if (term_is_deeper(t, REQUEST_MAX_DEPTH)) {
+    term_destroy(&t);
+    return "term too deep";
+  }
+  char const *error = NULL;
+  term res = NULL;
+  if (strcmp(operation, "rewrite") == 0) {
+    if (rewrite_is_valid(t)) {
+      res = term_rewrite(t);
+    } else {
+      error = "not a rewrite term";
+    }
+  } else if (strcmp(operation, "unify") == 0) {
+    if (unify_is_valid(t)) {
+      res = term_unify(t);
+    } else {
+      error = "not a unify term";
+    }
+  } else if (strcmp(operation, "valuate") == 0) {
+    if (valuate_is_valid(t)) {
+      res = term_valuate_with_context(w->valuate, t);
+    } else {
+      error = "not a valuate term";
+    }
+  } else if (strcmp(operation, "expression") == 0) {
+    if (expression_is_valid_with_context(w->expression, t)) {
+      bignum value = expression_valuate_exact_with_context(w->expression, t);
+      if (value != NULL) {
+        bignum_print(value, out);
+        bignum_destroy(&value);
+      } else {
+        error = "division by zero";
+      }
+    } else {
+      error = "not an expression";
+    }
+  } else if (strcmp(operation, "peano") == 0) {
+    if (peano_is_valid_with_context(w->peano, t)) {
+      res = peano_valuate_bounded_with_context(w->peano, t, PEANO_MAX);
+      if (res == NULL) {
+        error = "overflow";
+      }
+    } else {
+      error = "not a peano term";
+    }
+  } else {
+    error = "unknown operation";
+  }
+  if (res != NULL) {
+    term_print_compact(res, out);
+    term_destroy(&res);
+  }
+  term_destroy(&t);
+  return error;
+}
+
+/*!
+ * Write a whole buffer to a file descriptor.
+ */
+static void write_all(int fd, char const *buffer, size_t size) {
+  while (size > 0) {
+    ssize_t n = write(fd, buffer, size);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return; // the client is gone, the response is dropped
+    }
+    buffer += n;
+    size -= n;
+  }
+}
+
+static void *worker_run(void *data) {
+  worker *w = data;
+  for (;;) {
+    request r = queue_pop();
+    if (r.conn == NULL) {
+      return NULL;
+    }
+    char *result = NULL;
+    size_t result_size = 0;
+    FILE *result_out = open_memstream(&result, &result_size);
+    assert(result_out != NULL);
+    char const *error = request_run(w, r.line, result_out);
+    fclose(result_out);
+    char *response = NULL;
+    size_t size = 0;
+    FILE *out = open_memstream(&response, &size);
+    assert(out != NULL);
+    if (error == NULL) {
+      fprintf(out, "%ld ok %s\n", r.number, result);
+    } else {
+      fprintf(out, "%ld error %s\n", r.number, error);
+    }
+    fclose(out);
+    pthread_mutex_lock(&r.conn->lock);
+    write_all(r.conn->out, response, size);
+    r.conn->pending--;
+    connection_release(r.conn);
+    free(result);
+    free(response);
+    free(r.line);
+  }
+}
+
+/*!
+ * Read the requests of a connection and queue them.
+ */
+static void *connection_read(void *data) {
+  connection conn = data;
+  char *line = NULL;
+  size_t capacity = 0;
+  long number = 0;
+  while (getline(&line, &capacity, conn->in) > 0) {
+    if (line[strspn(line, " \t\r\n")] == '\0') {
+      continue;
+    }
+    request r;
+    r.conn = conn;
+    r.number = number++;
+    r.line = strdup(line);
+    assert(r.line != NULL);
+    pthread_mutex_lock(&conn->lock);
+    conn->pending++;
+    pthread_mutex_unlock(&conn->lock);
+    queue_push(r);
+  }
+  free(line);
+  pthread_mutex_lock(&conn->lock);
+  conn->read_done = true;
+  connection_release(conn);
+  return NULL;
+}
+
+/*!
+ * Accept connections on a Unix domain socket, forever.
+ * \return false if the socket cannot be set up.
+ */
+static bool serve_socket(char const *const path) {
+  int server = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (server < 0) {
+    perror("socket");
+    return false;
+  }
+  struct sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (strlen(path) >= sizeof(address.sun_path)) {
+    fprintf(stderr, "socket path too long: %s\n", path);
+    return false;
+  }
+  strcpy(address.sun_path, path);
+  unlink(path);
+  if (bind(server, (struct sockaddr *)&address, sizeof(address)) < 0 ||
+      listen(server, 16) < 0) {
+    perror(path);
+    close(server);
+    return false;
+  }
+  for (;;) {
+    int client = accept(server, NULL, NULL);
+    if (client < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      perror("accept");
+      break;
+    }
+    int out = dup(client);
+    FILE *in = fdopen(client, "r");
+    assert(out >= 0 && in != NULL);
+    pthread_t reader;
+    int error = pthread_create(&reader, NULL, connection_read,
+                               connection_create(in, out, true));
+    assert(error == 0);
+    pthread_detach(reader);
+  }
+  close(server);
+  return false;
+}
+
+int main(int argc, char **argv) {
+  int nb_workers = DEFAULT_NB_WORKERS;
+  char const *socket_path = NULL;
+  int option;
+  while ((option = getopt(argc, argv, "j:s:")) != -1) {
+    if (option == 'j' && atoi(optarg) > 0) {
+      nb_workers = atoi(optarg);
+    } else if (option == 's') {
+      socket_path = optarg;
+    } else {
+      fprintf(stderr, "usage: %s [-j workers] [-s socket_path]\n", argv[0]);
+      return 1;
+    }
+  }
+  // a client closing its connection must not kill the server
+  signal(SIGPIPE, SIG_IGN);
+  // reads TERM_TRACE before the workers start
+  term_trace_is_enabled();
+
+  worker *workers = malloc(nb_workers * sizeof(worker));
+  assert(workers != NULL);
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr, WORKER_STACK_SIZE);
+  for (int i = 0; i < nb_workers; i++) {
+    workers[i].valuate = valuate_context_create();
+    workers[i].expression = expression_context_create();
+    workers[i].peano = peano_context_create();
+    int error =
+        pthread_create(&workers[i].thread, &attr, worker_run, &workers[i]);
+    assert(error == 0);
+  }
+  pthread_attr_destroy(&attr);
+
+  int status = 0;
+  if (socket_path != NULL) {
+    status = serve_socket(socket_path) ? 0 : 1;
+  } else {
+    connection conn = connection_create(stdin, STDOUT_FILENO, false);
+    connection_read(conn);
+  }
+
+  // an empty request stops a worker, once the queue is emptied
+  for (int i = 0; i < nb_workers; i++) {
+    request stop = {NULL, 0, NULL};
+    queue_push(stop);
+  }
+  for (int i = 0; i < nb_workers; i++) {
+    pthread_join(workers[i].thread, NULL);
+    valuate_context_destroy(&workers[i].valuate);
+    expression_context_destroy(&workers[i].expression);
+    peano_context_destroy(&workers[i].peano);
+  }
+  free(workers);
+  return status;
+}
@@ -0,0 +1,123 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "term_stats.h"
+
+#undef NDEBUG // FORCE ASSERT ACTIVATION
+
+bool term_stats_enabled = false;
+
+term_stats term_stats_counters;
+
+/*!
+ * Counters of a rewriting rule.
+ */
+typedef struct {
+  unsigned long attempts;
+  unsigned long successes;
+} rule_stats;
+
+/*! Per rule counters, indexed by rule. */
+static rule_stats *rules = NULL;
+
+/*! Number of rules with counters. */
+static int nb_rules = 0;
+
+/*! Allocated size of \c rules . */
+static int rules_capacity = 0;
+
+void term_stats_enable(bool enabled) { term_stats_enabled = enabled; }
+
+bool term_stats_is_enabled(void) { return term_stats_enabled; }
+
+term_stats term_stats_get(void) { return term_stats_counters; }
+
+void term_stats_reset(void) {
+  memset(&term_stats_counters, 0, sizeof(term_stats));
+  free(rules);
+  rules = NULL;
+  nb_rules = rules_capacity = 0;
+}
+
+int term_stats_get_nb_rules(void) { return nb_rules; }
+
+void term_stats_get_rule(int rule, unsigned long *attempts,
+                         unsigned long *successes) {
+  assert(0 <= rule && rule < nb_rules);
+  assert(attempts != NULL);
+  assert(successes != NULL);
+  *attempts = rules[rule].attempts;
+  *successes = rules[rule].successes;
+}
+
+void term_stats_count_match(int rule, bool success) {
+  if (!term_stats_enabled) {
+    return;
+  }
+  assert(0 <= rule);
+  if (rule >= rules_capacity) {
+    int capacity = rules_capacity == 0 ? 8 : rules_capacity;
+    while (capacity <= rule) {
+      capacity *= 2;
+    }
+    rules = realloc(rules, capacity * sizeof(rule_stats));
+    assert(rules != NULL);
+    memset(rules + rules_capacity, 0,
+           (capacity - rules_capacity) * sizeof(rule_stats));
+    rules_capacity = capacity;
+  }
+  if (rule >= nb_rules) {
+    nb_rules = rule + 1;
+  }
+  rules[rule].attempts++;
+  term_stats_counters.match_attempts++;
+  if (success) {
+    rules[rule].successes++;
+    term_stats_counters.match_successes++;
+  }
+}
+
+/*!
+ * Names and values of the counters, in printing order.
+ */
+#define TERM_STATS_FIELDS(F)                                                   \
+  F(terms_created)                                                             \
+  F(terms_destroyed)                                                           \
+  F(bytes_allocated)                                                           \
+  F(term_compare_calls)                                                        \
+  F(sstring_compare_calls)                                                     \
+  F(match_attempts)                                                            \
+  F(match_successes)                                                           \
+  F(unify_equations)                                                           \
+  F(unify_substitutions)                                                       \
+  F(valuate_lookups)
+
+void term_stats_print(FILE *out) {
+  assert(out != NULL);
+#define PRINT_TEXT(field)                                                      \
+  fprintf(out, "%s %lu\n", #field, term_stats_counters.field);
+  TERM_STATS_FIELDS(PRINT_TEXT)
+#undef PRINT_TEXT
+  for (int i = 0; i < nb_rules; i++) {
+    fprintf(out, "rule %d match_attempts %lu match_successes %lu\n", i,
+            rules[i].attempts, rules[i].successes);
+  }
+}
+
+void term_stats_print_json(FILE *out) {
+  assert(out != NULL);
+  fprintf(out, "{");
+#define PRINT_JSON(field)                                                      \
+  fprintf(out, "\"%s\": %lu, ", #field, term_stats_counters.field);
+  TERM_STATS_FIELDS(PRINT_JSON)
+#undef PRINT_JSON
+  fprintf(out, "\"rules\": [");
+  for (int i = 0; i < nb_rules; i++) {
+    fprintf(out,
+            "%s{\"rule\": %d, \"match_attempts\": %lu, "
+            "\"match_successes\": %lu}",
+            i == 0 ? "" : ", ", i, rules[i].attempts, rules[i].successes);
+  }
+  fprintf(out, "]}\n");
+}
@@ -0,0 +1,134 @@
+#ifndef __TERM_STATS_H
+#define __TERM_STATS_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+/*!
+ * \file
+ * \brief Counters of the work done by the engines (opt-in).
+ *
+ * Counting is disabled by default; \c term_stats_enable turns it on. When
+ * disabled, each counting point is a single test of a global flag.
+ *
+ * Counters are global to the process and are not protected against
+ * concurrent updates: enable them on a single thread.
+ *
+ * Typical use, to attribute a slow request to its input and rules:
+ * \verbatim
+ term_stats_reset();
+ term_stats_enable(true);
+ term res = term_rewrite(t);
+ term_stats_enable(false);
+ term_stats_print_json(stderr);
+ \endverbatim
+ */
+
+/*!
+ * Values of the counters.
+ * \param terms_created terms allocated (create, copy, expansion of runs…)
+ * \param terms_destroyed terms freed
+ * \param bytes_allocated bytes requested for terms, argument cells and
+ * sstrings (temporary buffers of traversals are not counted)
+ * \param term_compare_calls calls to \c term_compare
+ * \param sstring_compare_calls calls to \c sstring_compare and
+ * \c sstring_equals
+ * \param match_attempts pattern match attempts in \c term_rewrite (all rules)
+ * \param match_successes successful matches in \c term_rewrite (all rules)
+ * \param unify_equations equations processed by \c term_unify
+ * \param unify_substitutions variable substitutions done by \c term_unify
+ * \param valuate_lookups variable lookups in \c term_valuate and
+ * \c valuate_dag_create
+ */
+typedef struct {
+  unsigned long terms_created;
+  unsigned long terms_destroyed;
+  unsigned long bytes_allocated;
+  unsigned long term_compare_calls;
+  unsigned long sstring_compare_calls;
+  unsigned long match_attempts;
+  unsigned long match_successes;
+  unsigned long unify_equations;
+  unsigned long unify_substitutions;
+  unsigned long valuate_lookups;
+} term_stats;
+
+/*!
+ * Turn counting on or off. Counters keep their values.
+ * \param enabled whether to count.
+ */
+extern void term_stats_enable(bool enabled);
+
+/*!
+ * \return whether counting is on.
+ */
+extern bool term_stats_is_enabled(void);
+
+/*!
+ * \return a copy of the counters.
+ */
+extern term_stats term_stats_get(void);
+
+/*!
+ * Set all counters (including per rule ones) to 0.
+ */
+extern void term_stats_reset(void);
+
+/*!
+ * \return number of rules with counters: 1 + the greatest rule index seen by
+ * \c term_rewrite since the last reset.
+ */
+extern int term_stats_get_nb_rules(void);
+
+/*!
+ * Get the counters of a rewriting rule.
+ * Rules are numbered from 0 in the order of the \c rewrite term (the factor
+ * is not counted).
+ * \param rule index of the rule.
+ * \param attempts where to store the number of match attempts.
+ * \param successes where to store the number of successful matches.
+ * \pre 0 ≤ \c rule < \c term_stats_get_nb_rules() .
+ * \pre \c attempts and \c successes are non NULL.
+ */
+extern void term_stats_get_rule(int rule, unsigned long *attempts,
+                                unsigned long *successes);
+
+/*!
+ * Print the counters as text, one \c name \c value per line.
+ * \param out stream to print to.
+ */
+extern void term_stats_print(FILE *out);
+
+/*!
+ * Print the counters as a JSON object (on one line, with a final line return).
+ * Per rule counters are in the \c "rules" array.
+ * \param out stream to print to.
+ */
+extern void term_stats_print_json(FILE *out);
+
+/*!
+ * Count a match attempt of a rewriting rule.
+ * For the instrumentation of the modules.
+ * \param rule index of the rule.
+ * \param success whether the pattern matched.
+ */
+extern void term_stats_count_match(int rule, bool success);
+
+/*! Whether counting is on. For the instrumentation of the modules. */
+extern bool term_stats_enabled;
+
+/*! The counters. For the instrumentation of the modules. */
+extern term_stats term_stats_counters;
+
+/*!
+ * Add \c n to a counter if counting is on.
+ * For the instrumentation of the modules.
+ */
+#define TERM_STATS_ADD(field, n)                                               \
+  do {                                                                         \
+    if (term_stats_enabled) {                                                  \
+      term_stats_counters.field += (n);                                        \
+    }                                                                          \
+  } while (0)
+
+#endif
@@ -0,0 +1,174 @@
+// clock_gettime, CLOCK_MONOTONIC and threads are POSIX
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "term_trace.h"
+
+#undef NDEBUG // FORCE ASSERT ACTIVATION
+
+/*! File the trace is written to, NULL if tracing is off (set under
+ * \c trace_mutex , read atomically). */
+static FILE *trace_file = NULL;
+
+/*! Whether an event has already been written (for the separators). */
+static bool trace_not_empty = false;
+
+/*! Whether the trace was opened by \c term_trace_open before \c TERM_TRACE
+ * has been looked at, which is then ignored. */
+static bool trace_opened = false;
+
+/*! Serializes the writes to \c trace_file . */
+static pthread_mutex_t trace_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*! Looking at \c TERM_TRACE , once. */
+static pthread_once_t trace_once = PTHREAD_ONCE_INIT;
+
+/*! Number of the calling thread in the trace (see \c trace_thread_id ). */
+static pthread_key_t trace_thread_key;
+
+/*! Number of threads that have written an event. */
+static long trace_nb_threads = 0;
+
+/*!
+ * Close the trace file.
+ * \pre \c trace_mutex is locked.
+ */
+static void trace_close_locked(void) {
+  if (trace_file != NULL) {
+    fprintf(trace_file, "\n]\n");
+    fclose(trace_file);
+    __atomic_store_n(&trace_file, NULL, __ATOMIC_RELEASE);
+  }
+}
+
+/*!
+ * Open a trace file.
+ * \pre \c trace_mutex is locked.
+ */
+static bool trace_open_locked(char const *const file_name) {
+  trace_close_locked();
+  FILE *file = fopen(file_name, "w");
+  if (file == NULL) {
+    return false;
+  }
+  fprintf(file, "[");
+  trace_not_empty = false;
+  __atomic_store_n(&trace_file, file, __ATOMIC_RELEASE);
+  return true;
+}
+
+/*!
+ * Open the file named by \c TERM_TRACE the first time tracing is queried,
+ * unless a trace has already been opened.
+ */
+static void term_trace_initialize(void) {
+  int error = pthread_key_create(&trace_thread_key, NULL);
+  assert(error == 0);
+  pthread_mutex_lock(&trace_mutex);
+  bool opened = false;
+  if (!trace_opened) {
+    char const *const file_name = getenv("TERM_TRACE");
+    opened = file_name != NULL && *file_name != '\0' &&
+             trace_open_locked(file_name);
+  }
+  pthread_mutex_unlock(&trace_mutex);
+  if (opened) {
+    atexit(term_trace_close);
+  }
+}
+
+bool term_trace_open(char const *const file_name) {
+  assert(file_name != NULL);
+  pthread_mutex_lock(&trace_mutex);
+  trace_opened = true;
+  pthread_mutex_unlock(&trace_mutex);
+  pthread_once(&trace_once, term_trace_initialize);
+  pthread_mutex_lock(&trace_mutex);
+  bool res = trace_open_locked(file_name);
+  pthread_mutex_unlock(&trace_mutex);
+  return res;
+}
+
+void term_trace_close(void) {
+  pthread_mutex_lock(&trace_mutex);
+  trace_close_locked();
+  pthread_mutex_unlock(&trace_mutex);
+}
+
+bool term_trace_is_enabled(void) {
+  pthread_once(&trace_once, term_trace_initialize);
+  return __atomic_load_n(&trace_file, __ATOMIC_ACQUIRE) != NULL;
+}
+
+double term_trace_now(void) {
+  struct timespec now;
+  int error = clock_gettime(CLOCK_MONOTONIC, &now);
+  assert(error == 0);
+  return (double)now.tv_sec * 1e6 + (double)now.tv_nsec / 1e3;
+}
+
+double term_trace_start(void) {
+  return term_trace_is_enabled() ? term_trace_now() : -1;
+}
+
+/*!
+ * Number of the calling thread in the trace: threads are numbered from 1 in the
+ * order of their first event.
+ * \return the number of the thread.
+ */
+static long trace_thread_id(void) {
+  long id = (long)(intptr_t)pthread_getspecific(trace_thread_key);
+  if (id == 0) {
+    id = __atomic_add_fetch(&trace_nb_threads, 1, __ATOMIC_RELAXED);
+    int error = pthread_setspecific(trace_thread_key, (void *)(intptr_t)id);
+    assert(error == 0);
+  }
+  return id;
+}
+
+void term_trace_event(char const *const name, double start,
+                      char const *const args, ...) {
+  assert(name != NULL);
+  assert(args != NULL);
+  if (start < 0 || !term_trace_is_enabled()) {
+    return;
+  }
+  double const end = term_trace_now();
+  // the arguments are formatted first, the event is written at once
+  char buffer[256];
+  char *members = buffer;
+  va_list values;
+  va_start(values, args);
+  int length = vsnprintf(buffer, sizeof(buffer), args, values);
+  va_end(values);
+  assert(length >= 0);
+  if ((size_t)length >= sizeof(buffer)) {
+    members = malloc(length + 1);
+    assert(members != NULL);
+    va_start(values, args);
+    vsnprintf(members, length + 1, args, values);
+    va_end(values);
+  }
+  long const tid = trace_thread_id();
+  pthread_mutex_lock(&trace_mutex);
+  if (trace_file != NULL) {
+    fprintf(trace_file,
+            "%s\n{\"name\": \"%s\", \"cat\": \"term\", \"ph\": \"X\", "
+            "\"pid\": 1, \"tid\": %ld, \"ts\": %.3f, \"dur\": %.3f, "
+            "\"args\": {%s}}",
+            trace_not_empty ? "," : "", name, tid, start, end - start,
+            members);
+    trace_not_empty = true;
+  }
+  pthread_mutex_unlock(&trace_mutex);
+  if (members != buffer) {
+    free(members);
+  }
+}
@@ -0,0 +1,67 @@
+#ifndef __TERM_TRACE_H
+#define __TERM_TRACE_H
+
+#include <stdbool.h>
+
+/*!
+ * \file
+ * \brief Timing trace of the engines, in Chrome trace-event JSON.
+ *
+ * When tracing is on, \c term_rewrite , \c term_unify and \c term_valuate
+ * write one event per call and per phase (rewriting step, unification round)
+ * to a side file. The file can be loaded in a trace viewer (\c chrome://tracing
+ * , Perfetto…).
+ *
+ * Tracing is turned on either by \c term_trace_open or, without changing the
+ * program, by setting the environment variable \c TERM_TRACE to the name of
+ * the file (it is then closed at exit).
+ * When tracing is off, each trace point costs a test.
+ *
+ * Times come from a monotonic clock and are in micro-seconds.
+ * Threads can write events at once: each event is written whole, with the
+ * number of its thread (from 1, in the order of their first event) as \c tid .
+ */
+
+/*!
+ * Start writing the trace to a file (any previous trace is closed).
+ * \param file_name name of the file (overwritten).
+ * \pre \c file_name is non NULL.
+ * \return false if the file cannot be opened (tracing is then off).
+ */
+extern bool term_trace_open(char const *const file_name);
+
+/*!
+ * Finish the trace file and turn tracing off (does nothing if it is off).
+ */
+extern void term_trace_close(void);
+
+/*!
+ * \return whether tracing is on.
+ */
+extern bool term_trace_is_enabled(void);
+
+/*!
+ * \return the current time of the monotonic clock, in micro-seconds.
+ */
+extern double term_trace_now(void);
+
+/*!
+ * Start a traced phase.
+ * \return the start time to give to \c term_trace_event , or a negative value
+ * if tracing is off.
+ */
+extern double term_trace_start(void);
+
+/*!
+ * Write a complete event for a phase (does nothing if \c start is negative).
+ * \param name name of the phase.
+ * \param start value returned by \c term_trace_start at the beginning of the
+ * phase.
+ * \param args \c printf format of the members of the \c args object of the
+ * event (e.g. \c "\"size\": %d" ), followed by the values.
+ * \pre \c name and \c args are non NULL.
+ */
+extern void term_trace_event(char const *const name, double start,
+                             char const *const args, ...);
+
+#endif
@@ -2,6 +2,7 @@
 #include <ctype.h>
 #include <stdlib.h>
 
+#include "check.h"
 #include "term_io.h"
 #include "term_variable.h"
 
@@ -11,23 +12,11 @@
  * \return true if \c variable is in correct format to be a valid variable.
  */
 static bool variable_is_valide(sstring variable) {
-  if (sstring_get_length(variable) > 1) {
-    if (sstring_get_char(variable, 0) == '\'') {
-      for (int i = 1; i < sstring_get_length(variable); i++) {
-        char c = sstring_get_char(variable, i);
-        if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
-              (c >= '0' && c <= '9' && i > 1) || c == '_')) {
-          return false;
-        }
-      }
-      return true;
-    }
-  }
-  return false;
+  return term_symbol_is_variable(variable);
 }
 
 bool term_is_variable(term t) {
-  bool result = variable_is_valide(term_get_symbol(t));
+  bool result = term_get_kind(t) == TERM_KIND_VARIABLE;
   if (result)
     assert(term_get_arity(t) == 0);
   return result;
@@ -36,24 +25,39 @@ bool term_is_variable(term t) {
 void term_replace_if_variable(term t, sstring variable, term value) {
   assert(t != NULL);
   assert(value != NULL);
-  assert(variable_is_valide(variable));
+  CHECK(variable_is_valide(variable));
   if (sstring_compare(term_get_symbol(t), variable) == 0) {
     term_replace_copy(t, value);
   }
 }
 
+/*!
+ * What \c term_replace_variable replaces.
+ */
+typedef struct {
+  sstring variable;
+  term value;
+} replace_variable_state;
+
+/*!
+ * Pre-order visitor of \c term_replace_variable , the value that replaced the
+ * variable is not visited.
+ */
+static term_visit term_replace_variable_pre(term t, int depth, void *data) {
+  replace_variable_state *state = data;
+  if (sstring_equals(term_get_symbol(t), state->variable)) {
+    term_replace_copy(t, state->value);
+    return TERM_VISIT_SKIP;
+  }
+  return TERM_VISIT_CONTINUE;
+}
+
 void term_replace_variable(term t, sstring variable, term value) {
   assert(t != NULL);
   assert(value != NULL);
-  assert(variable_is_valide(variable));
-  if (sstring_compare(term_get_symbol(t), variable) == 0) {
-    term_replace_copy(t, value);
-  } else {
-    term_argument_traversal tat = term_argument_traversal_create(t);
-    while (term_argument_traversal_has_next(tat)) {
-      term arg = term_argument_traversal_get_next(tat);
-      term_replace_variable(arg, variable, value);
-    }
-    term_argument_traversal_destroy(&tat);
-  }
+  CHECK(variable_is_valide(variable));
+  replace_variable_state state = {variable, value};
+  // occurrences are replaced while traversing
+  term_unshare(t);
+  term_traverse(t, term_replace_variable_pre, NULL, &state);
 }
@@ -0,0 +1,98 @@
+#include <assert.h>
+#include <stdio.h>
+
+#include "bignum.h"
+#include "sstring.h"
+
+#undef NDEBUG // FORCE ASSERT ACTIVATION
+
+/*!
+ * \file
+ * \brief Basic tests for \c bignum.
+ *
+ * This should also be used to test for memory leak.
+ *
+ * assert is enforced.
+ */
+
+/*!
+ * Create a \c bignum from a C-string of digits, possibly starting with '-'.
+ * \param st C-string to convert
+ * \return new bignum
+ */
+static bignum bignum_from_string(char const *const st) {
+  bool negative = st[0] == '-';
+  sstring ss = sstring_create_string(negative ? st + 1 : st);
+  bignum b = bignum_create_sstring(ss);
+  sstring_destroy(&ss);
+  if (negative) {
+    bignum zero = bignum_create_int64(0);
+    bignum tmp = bignum_subtract(zero, b);
+    bignum_destroy(&zero);
+    bignum_destroy(&b);
+    b = tmp;
+  }
+  return b;
+}
+
+/*!
+ * Print the four operations and the comparison of two \c bignum.
+ * \param st1 1st operand (C-string)
+ * \param st2 2nd operand (C-string)
+ */
+static void test_operations(char const *const st1, char const *const st2) {
+  bignum b1 = bignum_from_string(st1);
+  bignum b2 = bignum_from_string(st2);
+  bignum res[4] = {bignum_add(b1, b2), bignum_subtract(b1, b2),
+                   bignum_multiply(b1, b2),
+                   bignum_is_zero(b2) ? NULL : bignum_divide(b1, b2)};
+  char const *const ops = "+-*/";
+  puts("---------------");
+  for (int i = 0; i < 4; i++) {
+    if (res[i] != NULL) {
+      bignum_print(b1, stdout);
+      printf(" %c ", ops[i]);
+      bignum_print(b2, stdout);
+      printf(" = ");
+      bignum_print(res[i], stdout);
+      putchar('\n');
+      bignum_destroy(&res[i]);
+    }
+  }
+  printf("compare = %d\n", bignum_compare(b1, b2));
+  bignum_destroy(&b1);
+  bignum_destroy(&b2);
+}
+
+/*!
+ * Print whether a \c bignum fits in an \c int64_t .
+ * \param st C-string to convert
+ */
+static void test_int64(char const *const st) {
+  bignum b = bignum_from_string(st);
+  int64_t n;
+  if (bignum_is_int64(b, &n)) {
+    printf("%s fits: %lld\n", st, (long long)n);
+  } else {
+    printf("%s does not fit\n", st);
+  }
+  bignum_destroy(&b);
+}
+
+int main(void) {
+  test_operations("0", "7");
+  test_operations("123456789", "-1000000000");
+  test_operations("9223372036854775807", "1");
+  test_operations("-9223372036854775808", "-1");
+  test_operations("123456789012345678901234567890", "987654321");
+  test_operations("-123456789012345678901234567890",
+                  "1000000000000000000000000000000");
+  test_operations("1000000000000000000000000000000000000",
+                  "-999999999999999999");
+  test_int64("9223372036854775807");
+  test_int64("9223372036854775808");
+  test_int64("-9223372036854775808");
+  test_int64("-9223372036854775809");
+  test_int64("000000000000000000000000000012");
+  return 0;
+}
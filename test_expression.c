@@ -1,4 +1,8 @@
+#include <assert.h>
+#include <limits.h>
+#include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 #include "expression.h"
 #include "term.h"
@@ -17,9 +21,133 @@ static void test_file(char const *const file_name) {
   fclose(in);
 }
 
+static void test_file_exact(char const *const file_name) {
+  FILE *in = fopen(file_name, "r");
+  term t = term_scan(in);
+  term_print_compact(t, stdout);
+  printf("\n");
+  bignum b = expression_valuate_exact(t);
+  bignum_print(b, stdout);
+  printf("\n");
+  bignum_destroy(&b);
+  term_destroy(&t);
+  fclose(in);
+}
+
+/*!
+ * Replace a variable by an integer value.
+ * \param t term to modify.
+ * \param variable variable to replace.
+ * \param value value of the variable.
+ */
+static void replace_by_integer(term t, sstring variable, int value) {
+  char buffer[16];
+  sprintf(buffer, "%d", value);
+  sstring s = sstring_create_string(buffer);
+  term v = term_create(s);
+  sstring_destroy(&s);
+  term_replace_variable(t, variable, v);
+  term_destroy(&v);
+}
+
+/*!
+ * Evaluate an expression with variables over many rows at once and check each
+ * row against the valuation of the expression where variables are replaced.
+ */
+static void test_batch(char const *const file_name, int nb_rows) {
+  FILE *in = fopen(file_name, "r");
+  assert(NULL != in);
+  term t = term_scan(in);
+  fclose(in);
+  term_print_compact(t, stdout);
+  printf("\n");
+
+  expression_context ctx = expression_context_create();
+  expression_code code = expression_compile(ctx, t);
+  int nb_variables = expression_code_get_nb_variables(code);
+  int **columns = malloc(nb_variables * sizeof(int *));
+  for (int i = 0; i < nb_variables; i++) {
+    sstring_print(expression_code_get_variable(code, i), stdout);
+    printf(" ");
+    columns[i] = malloc(nb_rows * sizeof(int));
+    for (int r = 0; r < nb_rows; r++) {
+      columns[i][r] = (r * (i + 3)) % (7 + 2 * i) + i;
+    }
+  }
+  printf("\n");
+  int *results = malloc(nb_rows * sizeof(int));
+  int nb_undefined = expression_code_run_batch(
+      code, (int const *const *)columns, nb_rows, results, NULL);
+  assert(nb_undefined == 0);
+
+  int nb_errors = 0;
+  for (int r = 0; r < nb_rows; r++) {
+    term row = term_copy(t);
+    for (int i = 0; i < nb_variables; i++) {
+      replace_by_integer(row, expression_code_get_variable(code, i),
+                         columns[i][r]);
+    }
+    if (expression_valuate_with_context(ctx, row) != results[r]) {
+      nb_errors++;
+    }
+    term_destroy(&row);
+  }
+  printf("%d rows: %d %d %d … %d, %d errors\n", nb_rows, results[0],
+         results[1], results[2], results[nb_rows - 1], nb_errors);
+
+  for (int i = 0; i < nb_variables; i++) {
+    free(columns[i]);
+  }
+  free(columns);
+  free(results);
+  expression_code_destroy(&code);
+  expression_context_destroy(&ctx);
+  term_destroy(&t);
+}
+
+/*!
+ * Rows that divide by zero or overflow have no value, the other ones are not
+ * affected.
+ */
+static void test_batch_undefined(char const *const text, int nb_rows,
+                                 int const *values) {
+  term t = term_scan_text(text);
+  assert(t != NULL);
+  expression_context ctx = expression_context_create();
+  expression_code code = expression_compile(ctx, t);
+  assert(expression_code_get_nb_variables(code) == 1);
+  int results[8];
+  bool undefined[8];
+  assert(nb_rows <= 8);
+  int nb_undefined = expression_code_run_batch(code, &values, nb_rows,
+                                               results, undefined);
+  printf("%s:", text);
+  for (int r = 0; r < nb_rows; r++) {
+    if (undefined[r]) {
+      printf(" undefined");
+    } else {
+      printf(" %d", results[r]);
+    }
+  }
+  printf(" (%d undefined)\n", nb_undefined);
+  expression_code_destroy(&code);
+  expression_context_destroy(&ctx);
+  term_destroy(&t);
+}
+
 int main(void) {
   test_file("DATA/Terms/t_expression_0.term");
   test_file("DATA/Terms/t_expression_1.term");
   test_file("DATA/Terms/t_expression_2.term");
+  test_file("DATA/Terms/t_expression_3.term");
+  test_file_exact("DATA/Terms/t_expression_3.term");
+  test_file_exact("DATA/Terms/t_expression_4.term");
+  test_batch("DATA/Terms/t_expression_batch.term", 1000);
+  int const divisors[] = {2, 0, 5, -1};
+  test_batch_undefined("/ ( 10 'x )", 4, divisors);
+  int const factors[] = {10, 1000, 100000, -10};
+  test_batch_undefined("* ( 'x 'x 'x 'x )", 4, factors);
+  int const terms[] = {1, INT_MAX, INT_MIN, -1};
+  test_batch_undefined("+ ( 'x 1 )", 4, terms);
   return 0;
 }
@@ -1,3 +1,4 @@
+#include <assert.h>
 #include <stdio.h>
 
 #include "peano.h"
@@ -12,14 +13,22 @@ static void test_file(char const *const file_name) {
   term t_copy = peano_valuate(t);
   term_print_compact(t_copy, stdout);
   printf("\n");
+  term t_normal = peano_normalize(t);
+  assert(term_compare(t_normal, t_copy) == 0);
+  term t_stepwise = peano_normalize_stepwise(t);
+  assert(term_compare(t_stepwise, t_copy) == 0);
+  assert(term_get_successor_run(t_stepwise) == 0);
   term_destroy(&t);
   term_destroy(&t_copy);
+  term_destroy(&t_normal);
+  term_destroy(&t_stepwise);
   fclose(in);
 }
 
 int main(void) {
   test_file("DATA/Terms/t_peano_0.term");
   test_file("DATA/Terms/t_peano_1.term");
+  test_file("DATA/Terms/t_peano_2.term");
 
   return 0;
 }
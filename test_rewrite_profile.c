@@ -0,0 +1,91 @@
+#include <assert.h>
+#include <stdio.h>
+
+#include "rewrite.h"
+#include "term.h"
+#include "term_io.h"
+
+#undef NDEBUG // FORCE ASSERT ACTIVATION
+
+/*! Rewriting problems counted into the profile. */
+static char const *const files[] = {
+    "DATA/Terms/t_rewrite_03.term", "DATA/Terms/t_rewrite_05.term",
+    "DATA/Terms/t_rewrite_07.term", "DATA/Terms/t_rewrite_11.term",
+    "DATA/Terms/t_rewrite_15.term", "DATA/Terms/t_rewrite_19.term",
+};
+
+#define NB_FILES (sizeof(files) / sizeof(files[0]))
+
+/*! Saved profiles that are not in the format of \c rewrite_profile_save . */
+static char const *const invalid[] = {
+    "1 1 f ( a b )\n", "1 2\n",          "1 2 )\n",
+    "1 2 -> ( a b\n",  "1 2 -> ( a b ) c\n", "-1 0 -> ( a b )\n",
+    "2 1 -> a\n",      "1 2 -> ( a b )\n",  "1\n",
+};
+
+#define NB_INVALID (sizeof(invalid) / sizeof(invalid[0]))
+
+/*!
+ * Rewrite a file with and without the profile: results must be the same.
+ */
+static void test_file(rewrite_profile p, char const *const file_name) {
+  FILE *in = fopen(file_name, "r");
+  assert(in != NULL);
+  term t = term_scan(in);
+  fclose(in);
+  term expected = term_rewrite(t);
+  term res = term_rewrite_with_profile(p, t);
+  assert(term_compare(expected, res) == 0);
+  term_destroy(&expected);
+  term_destroy(&res);
+  term_destroy(&t);
+}
+
+int main(void) {
+  rewrite_profile p = rewrite_profile_create();
+  // the second pass finds the rules counted by the first one
+  for (int pass = 0; pass < 2; pass++) {
+    for (unsigned i = 0; i < NB_FILES; i++) {
+      test_file(p, files[i]);
+    }
+  }
+  rewrite_profile_save(p, stdout);
+
+  // the next run starts with the saved counts
+  FILE *saved = tmpfile();
+  assert(saved != NULL);
+  rewrite_profile_save(p, saved);
+  rewind(saved);
+  rewrite_profile q = rewrite_profile_create();
+  bool ok = rewrite_profile_load(q, saved);
+  assert(ok);
+  fclose(saved);
+  assert(rewrite_profile_get_nb_rules(q) == rewrite_profile_get_nb_rules(p));
+  for (int i = 0; i < rewrite_profile_get_nb_rules(p); i++) {
+    unsigned long attempts_p, hits_p, attempts_q, hits_q;
+    term rule_p = rewrite_profile_get_rule(p, i, &attempts_p, &hits_p);
+    term rule_q = rewrite_profile_get_rule(q, i, &attempts_q, &hits_q);
+    assert(term_compare(rule_p, rule_q) == 0);
+    assert(attempts_p == attempts_q && hits_p == hits_q);
+  }
+  test_file(q, files[0]);
+  rewrite_profile_destroy(&p);
+  rewrite_profile_destroy(&q);
+  assert(q == NULL);
+
+  // not a profile: truncated, unbalanced, not a rule, extra term…
+  for (unsigned i = 0; i < NB_INVALID; i++) {
+    saved = tmpfile();
+    assert(saved != NULL);
+    fputs(invalid[i], saved);
+    rewind(saved);
+    q = rewrite_profile_create();
+    ok = rewrite_profile_load(q, saved);
+    assert(!ok);
+    assert(rewrite_profile_get_nb_rules(q) == 0);
+    fclose(saved);
+    rewrite_profile_destroy(&q);
+  }
+  printf("%d invalid profiles rejected\n", (int)NB_INVALID);
+  return 0;
+}
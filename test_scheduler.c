@@ -0,0 +1,249 @@
+// fmemopen is POSIX
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "rewrite.h"
+#include "scheduler.h"
+#include "term.h"
+#include "term_io.h"
+#include "valuate.h"
+
+#undef NDEBUG // FORCE ASSERT ACTIVATION
+
+/*! Numbers of workers tested. */
+static int const nb_workers[] = {1, 2, 4, 8};
+
+#define NB_WORKERS (sizeof(nb_workers) / sizeof(nb_workers[0]))
+
+/*!
+ * Fibonacci with a task per call (a deep fork-join recursion).
+ */
+typedef struct {
+  int n;
+  long res;
+} fib_call;
+
+static void fib(void *data) {
+  fib_call *call = data;
+  if (call->n < 2) {
+    call->res = call->n;
+    return;
+  }
+  fib_call a = {call->n - 1, 0};
+  fib_call b = {call->n - 2, 0};
+  scheduler_task task;
+  scheduler_spawn(&task, fib, &a);
+  fib(&b);
+  scheduler_sync(&task);
+  call->res = a.res + b.res;
+}
+
+/*!
+ * Cells of a \c scheduler_parallel_for , each set from its index, and a nested
+ * loop for the first ones.
+ */
+typedef struct {
+  long *cells;
+  int nb_nested;
+} loop_data;
+
+static void loop_nested(void *data, int i) {
+  int *cells = data;
+  cells[i] = i;
+}
+
+static void loop_cell(void *data, int i) {
+  loop_data *loop = data;
+  loop->cells[i] = 3L * i + 1;
+  if (i < loop->nb_nested) {
+    int cells[100];
+    scheduler_parallel_for(100, loop_nested, cells);
+    for (int k = 0; k < 100; k++) {
+      assert(cells[k] == k);
+    }
+  }
+}
+
+static void test_loop(int n, int nb_nested) {
+  loop_data loop = {calloc(n, sizeof(long)), nb_nested};
+  assert(loop.cells != NULL);
+  scheduler_parallel_for(n, loop_cell, &loop);
+  for (int i = 0; i < n; i++) {
+    assert(loop.cells[i] == 3L * i + 1);
+  }
+  free(loop.cells);
+}
+
+/*!
+ * Out of a scheduler, everything is run at once on the calling thread.
+ */
+static void test_outside() {
+  assert(scheduler_get_current_nb_workers() == 1);
+  assert(scheduler_get_current_split_depth() == 0);
+  fib_call call = {20, 0};
+  fib(&call);
+  assert(call.res == 6765);
+  test_loop(1000, 10);
+  int splits_left = scheduler_get_current_split_depth();
+  assert(scheduler_split(&splits_left, 1000) == 1);
+  printf("outside: ok\n");
+}
+
+static void test_split() {
+  int splits_left = 4;
+  assert(scheduler_split(&splits_left, 0) == 0);
+  assert(scheduler_split(&splits_left, 1) == 1 && splits_left == 4);
+  assert(scheduler_split(&splits_left, 2) == 2 && splits_left == 3);
+  assert(scheduler_split(&splits_left, 3) == 3 && splits_left == 1);
+  assert(scheduler_split(&splits_left, 1000) == 2 && splits_left == 0);
+  assert(scheduler_split(&splits_left, 1000) == 1 && splits_left == 0);
+  splits_left = 4;
+  assert(scheduler_split(&splits_left, 1000) == 16 && splits_left == 0);
+  printf("split: ok\n");
+}
+
+static void test_tasks(int n) {
+  scheduler s = scheduler_create(n);
+  assert(scheduler_get_nb_workers(s) == n);
+  // a scheduler can be entered many times
+  for (int round = 0; round < 3; round++) {
+    scheduler_enter(s);
+    assert(scheduler_get_current_nb_workers() == n);
+    assert(n == 1 || (1 << scheduler_get_current_split_depth()) >= 4 * n);
+    fib_call call = {22, 0};
+    fib(&call);
+    assert(call.res == 17711);
+    test_loop(100000, 50);
+    test_loop(0, 0);
+    scheduler_leave(s);
+    assert(scheduler_get_current_nb_workers() == 1);
+  }
+  scheduler_destroy(&s);
+  assert(s == NULL);
+  printf("tasks %d: ok\n", n);
+}
+
+static term scan_file(char const *const file_name) {
+  FILE *in = fopen(file_name, "r");
+  if (in == NULL) {
+    return NULL;
+  }
+  term t = term_scan(in);
+  fclose(in);
+  return t;
+}
+
+/*!
+ * The engines give the same results in a scheduler.
+ * \param format name of the test files, with the number of the file.
+ * \param engine engine to run.
+ */
+static void test_engine(char const *const name, char const *const format,
+                        term (*engine)(term t)) {
+  for (int i = 0;; i++) {
+    char file_name[64];
+    snprintf(file_name, sizeof(file_name), format, i);
+    term t = scan_file(file_name);
+    if (t == NULL) {
+      break;
+    }
+    term expected = engine(t);
+    for (unsigned k = 0; k < NB_WORKERS; k++) {
+      scheduler s = scheduler_create(nb_workers[k]);
+      scheduler_enter(s);
+      term res = engine(t);
+      scheduler_leave(s);
+      scheduler_destroy(&s);
+      assert(term_compare(expected, res) == 0);
+      term_destroy(&res);
+    }
+    term_destroy(&expected);
+    term_destroy(&t);
+  }
+  printf("%s: ok\n", name);
+}
+
+/*!
+ * \c set ( \c 'd0 \c a \c set ( \c 'd1 \c f ( \c 'd0 \c 'd0 ) … \c 'dn ) )
+ * whose value is a complete binary tree with 2^n leaves.
+ */
+static term create_double(int n) {
+  char text[1024];
+  int length = snprintf(text, sizeof(text), "set ( 'd0 a ");
+  for (int i = 1; i <= n; i++) {
+    length += snprintf(text + length, sizeof(text) - length,
+                       "set ( 'd%d f ( 'd%d 'd%d ) ", i, i - 1, i - 1);
+  }
+  length += snprintf(text + length, sizeof(text) - length, "'d%d", n);
+  for (int i = 0; i <= n; i++) {
+    length += snprintf(text + length, sizeof(text) - length, " )");
+  }
+  assert(length < (int)sizeof(text));
+  FILE *in = fmemopen(text, length, "r");
+  assert(in != NULL);
+  term t = term_scan(in);
+  fclose(in);
+  return t;
+}
+
+static void test_valuate_large() {
+  term t = create_double(14);
+  term expected = term_valuate(t);
+  scheduler s = scheduler_create(4);
+  scheduler_enter(s);
+  term res = term_valuate(t);
+  scheduler_leave(s);
+  scheduler_destroy(&s);
+  assert(term_compare(expected, res) == 0);
+  term_destroy(&res);
+  term_destroy(&expected);
+  term_destroy(&t);
+  printf("valuate large: ok\n");
+}
+
+/*!
+ * The counts of a profile learned in a scheduler are those learned
+ * sequentially.
+ */
+static void test_profile() {
+  term t = scan_file("DATA/Terms/t_rewrite_11.term");
+  assert(t != NULL);
+  rewrite_profile expected = rewrite_profile_create();
+  rewrite_profile p = rewrite_profile_create();
+  term res = term_rewrite_with_profile(expected, t);
+  term_destroy(&res);
+  scheduler s = scheduler_create(4);
+  scheduler_enter(s);
+  res = term_rewrite_with_profile(p, t);
+  scheduler_leave(s);
+  scheduler_destroy(&s);
+  term_destroy(&res);
+  assert(rewrite_profile_get_nb_rules(p) ==
+         rewrite_profile_get_nb_rules(expected));
+  for (int i = 0; i < rewrite_profile_get_nb_rules(p); i++) {
+    unsigned long attempts, hits, attempts_expected, hits_expected;
+    rewrite_profile_get_rule(p, i, &attempts, &hits);
+    rewrite_profile_get_rule(expected, i, &attempts_expected, &hits_expected);
+    assert(attempts == attempts_expected && hits == hits_expected);
+  }
+  rewrite_profile_destroy(&p);
+  rewrite_profile_destroy(&expected);
+  term_destroy(&t);
+  printf("profile: ok\n");
+}
+
+int main(void) {
+  test_outside();
+  test_split();
+  for (unsigned k = 0; k < NB_WORKERS; k++) {
+    test_tasks(nb_workers[k]);
+  }
+  test_engine("rewrite", "DATA/Terms/t_rewrite_%02d.term", term_rewrite);
+  test_engine("valuate", "DATA/Terms/t_valuate_%d.term", term_valuate);
+  test_valuate_large();
+  test_profile();
+  return 0;
+}
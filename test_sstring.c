@@ -159,6 +159,49 @@ static void test_sstring(char const *const st1, char const *const st2) {
   sstring_destroy(&ss3);
 }
 
+/*!
+ * Check that a \c sstring holds the same chars as a C-string.
+ */
+static bool sstring_equals_string(sstring ss, char const *const st) {
+  if ((size_t)sstring_get_length(ss) != strlen(st)) {
+    return false;
+  }
+  for (int i = 0; i < sstring_get_length(ss); i++) {
+    if (sstring_get_char(ss, i) != st[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*!
+ * Test concatenation and copy across the size of the inline storage,
+ * including concatenation of a \c sstring with itself.
+ */
+static void test_sstring_growth(void) {
+  char expected[300] = "";
+  sstring ss = sstring_create_empty();
+  for (int i = 0; i < 100; i++) {
+    sstring one = sstring_create_string(i % 2 ? "b" : "a");
+    sstring_concatenate(ss, one);
+    sstring_destroy(&one);
+    strcat(expected, i % 2 ? "b" : "a");
+    assert(sstring_equals_string(ss, expected));
+  }
+  sstring copy = sstring_copy(ss);
+  assert(sstring_equals_string(copy, expected));
+  sstring_concatenate(copy, copy);
+  memcpy(expected + 100, expected, 100);
+  expected[200] = '\0';
+  assert(sstring_equals_string(copy, expected));
+  sstring small = sstring_create_string("0123456789");
+  sstring_concatenate(small, small);
+  assert(sstring_equals_string(small, "01234567890123456789"));
+  sstring_destroy(&small);
+  sstring_destroy(&copy);
+  sstring_destroy(&ss);
+}
+
 /*!
  * Launch \link\c test_sstring_test() \enlink on various cases including empty
  * C-string.
@@ -174,9 +217,14 @@ int main(void) {
   TEST_IS_INT(5678987);
   TEST_IS_INT(1);
   TEST_IS_INT(0);
+  TEST_IS_INT(2147483647);
   TEST_IS_NOT_INT("zer");
   TEST_IS_NOT_INT("");
   TEST_IS_NOT_INT("12r");
   TEST_IS_NOT_INT("0x");
+  TEST_IS_NOT_INT("x0");
+  TEST_IS_NOT_INT("2147483648");
+  TEST_IS_NOT_INT("123456789012345678901234567890");
+  test_sstring_growth();
   return 0;
 }
@@ -0,0 +1,171 @@
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "symbol_table.h"
+#include "term.h"
+
+#undef NDEBUG // FORCE ASSERT ACTIVATION
+
+/*! Number of threads of the concurrent tests. */
+#define NB_THREADS 8
+
+/*! Number of symbols of the concurrent tests. */
+#define NB_SYMBOLS 20000
+
+static sstring create_numbered(char const *const prefix, int i) {
+  char text[32];
+  snprintf(text, sizeof(text), "%s%d", prefix, i);
+  return sstring_create_string(text);
+}
+
+/*!
+ * Data of a symbol: its length.
+ */
+static void *length_create(sstring text) {
+  int *length = malloc(sizeof(int));
+  assert(length != NULL);
+  *length = sstring_get_length(text);
+  return length;
+}
+
+static void test_sequential() {
+  symbol_table st = symbol_table_create(length_create, free);
+  sstring a = sstring_create_string("a");
+  assert(symbol_table_find(st, a) == NULL);
+  symbol_entry const *entry = symbol_table_intern(st, a);
+  assert(entry->id == 0);
+  assert(entry->text != a && sstring_equals(entry->text, a));
+  assert(*(int *)entry->data == 1);
+  assert(symbol_table_intern(st, a) == entry);
+  assert(symbol_table_find(st, a) == entry);
+  sstring_destroy(&a);
+  // the table grows many times
+  for (int i = 0; i < NB_SYMBOLS; i++) {
+    sstring s = create_numbered("s", i);
+    entry = symbol_table_intern(st, s);
+    assert(entry->id == i + 1);
+    assert(*(int *)entry->data == sstring_get_length(s));
+    sstring_destroy(&s);
+  }
+  for (int i = 0; i < NB_SYMBOLS; i++) {
+    sstring s = create_numbered("s", i);
+    entry = symbol_table_find(st, s);
+    assert(entry != NULL && entry->id == i + 1);
+    assert(symbol_table_intern(st, s) == entry);
+    sstring_destroy(&s);
+  }
+  assert(symbol_table_get_size(st) == NB_SYMBOLS + 1);
+  symbol_table_destroy(&st);
+  assert(st == NULL);
+  printf("sequential: ok\n");
+}
+
+/*!
+ * Work of a thread of \c test_concurrent .
+ */
+typedef struct {
+  symbol_table st;
+  int first;
+  /*! entry of each symbol */
+  symbol_entry const **entries;
+} intern_data;
+
+static void *intern_thread(void *data) {
+  intern_data *d = data;
+  for (int k = 0; k < NB_SYMBOLS; k++) {
+    int const i = (d->first + k) % NB_SYMBOLS;
+    sstring s = create_numbered("c", i);
+    d->entries[i] = symbol_table_intern(d->st, s);
+    assert(sstring_equals(d->entries[i]->text, s));
+    sstring_destroy(&s);
+  }
+  return NULL;
+}
+
+/*!
+ * Threads add the same symbols (from different starts): each symbol is added
+ * once.
+ */
+static void test_concurrent() {
+  symbol_table st = symbol_table_create(NULL, NULL);
+  pthread_t threads[NB_THREADS];
+  intern_data data[NB_THREADS];
+  for (int t = 0; t < NB_THREADS; t++) {
+    data[t].st = st;
+    data[t].first = t * NB_SYMBOLS / NB_THREADS;
+    data[t].entries = malloc(NB_SYMBOLS * sizeof(symbol_entry *));
+    assert(data[t].entries != NULL);
+    int error = pthread_create(&threads[t], NULL, intern_thread, &data[t]);
+    assert(error == 0);
+  }
+  for (int t = 0; t < NB_THREADS; t++) {
+    pthread_join(threads[t], NULL);
+  }
+  assert(symbol_table_get_size(st) == NB_SYMBOLS);
+  bool *seen = calloc(NB_SYMBOLS, sizeof(bool));
+  assert(seen != NULL);
+  for (int i = 0; i < NB_SYMBOLS; i++) {
+    symbol_entry const *entry = data[0].entries[i];
+    for (int t = 1; t < NB_THREADS; t++) {
+      assert(data[t].entries[i] == entry);
+    }
+    assert(0 <= entry->id && entry->id < NB_SYMBOLS && !seen[entry->id]);
+    seen[entry->id] = true;
+  }
+  free(seen);
+  for (int t = 0; t < NB_THREADS; t++) {
+    free(data[t].entries);
+  }
+  symbol_table_destroy(&st);
+  printf("concurrent: ok\n");
+}
+
+static void *create_thread(void *data) {
+  int const first = *(int *)data;
+  char const *const texts[] = {"42", "'x", "set", "f"};
+  term_kind const kinds[] = {TERM_KIND_INTEGER, TERM_KIND_VARIABLE,
+                             TERM_KIND_SYMBOL, TERM_KIND_SYMBOL};
+  for (int k = 0; k < NB_SYMBOLS / 10; k++) {
+    sstring s = create_numbered("t", (first + k) % (NB_SYMBOLS / 10));
+    term t = term_create(s);
+    term_add_argument_last(t, term_create(s));
+    sstring_destroy(&s);
+    int const j = k % 4;
+    s = sstring_create_string(texts[j]);
+    term u = term_create(s);
+    assert(term_has_symbol(u, term_symbol_intern(s)));
+    sstring_destroy(&s);
+    assert(term_get_kind(u) == kinds[j]);
+    // arguments share the symbol
+    assert(term_get_symbol(t) == term_get_symbol(term_get_argument(t, 0)));
+    term_destroy(&u);
+    term_destroy(&t);
+  }
+  return NULL;
+}
+
+/*!
+ * Threads create terms at once: symbols are classified as usual.
+ */
+static void test_terms() {
+  pthread_t threads[NB_THREADS];
+  int first[NB_THREADS];
+  for (int t = 0; t < NB_THREADS; t++) {
+    first[t] = t * 100;
+    int error = pthread_create(&threads[t], NULL, create_thread, &first[t]);
+    assert(error == 0);
+  }
+  for (int t = 0; t < NB_THREADS; t++) {
+    pthread_join(threads[t], NULL);
+  }
+  printf("terms: ok\n");
+}
+
+int main(void) {
+  test_sequential();
+  test_concurrent();
+  test_terms();
+  return 0;
+}
@@ -4,6 +4,7 @@
 #include "sstring.h"
 #include "term.h"
 #include "term_io.h"
+#include "term_variable.h"
 
 #undef NDEBUG // FORCE ASSERT ACTIVATION
 
@@ -209,6 +210,191 @@ static void test_traversal() {
   term_destroy(&t);
 }
 
+/*! S^n(0) stored as a run, compared with the same term built explicitly. */
+static void test_peano_run() {
+  term t = term_create_peano(4);
+  term copy = term_copy(t);
+  sstring s = sstring_create_string("S");
+  term u = term_create(s);
+  term v = u;
+  for (int i = 1; i < 4; i++) {
+    term_add_argument_last(v, term_create(s));
+    v = term_get_argument(v, 0);
+  }
+  sstring_destroy(&s);
+  s = sstring_create_string("0");
+  term_add_argument_last(v, term_create(s));
+  sstring_destroy(&s);
+  long n;
+  printf("run %ld, arity %d, peano %d\n", term_get_successor_run(t),
+         term_get_arity(t), term_is_peano(u, &n) ? (int)n : -1);
+  term_print_compact(t, stdout);
+  putchar('\n');
+  term_print_expanded(t, stdout);
+  printf("Comparaison avec le terme construit %d\n", term_compare(t, u));
+  term arg = term_get_argument(copy, 0);
+  printf("run %ld, argument run %ld\n", term_get_successor_run(copy),
+         term_get_successor_run(arg));
+  printf("Comparaison apres acces %d\n", term_compare(copy, u));
+  term_add_argument_last(arg, term_create_peano(1));
+  printf("Comparaison apres modification %d\n", term_compare(copy, u));
+  term_print_compact(copy, stdout);
+  putchar('\n');
+  term_destroy(&t);
+  term_destroy(&u);
+  term_destroy(&copy);
+}
+
+/*! Print the kind and integer value of a term. */
+static void test_print_kind(term t) {
+  int n = -1;
+  bool integer = term_get_integer(t, &n);
+  sstring_print(term_get_symbol(t), stdout);
+  printf(" : kind %d, integer %d (%d)\n", term_get_kind(t), integer, n);
+}
+
+/*! Kind of the symbol after creation, renaming, copy and replacement. */
+static void test_kind() {
+  char const *const symbols[] = {"'x",  "'_1",  "'1", "x",     "42",
+                                 "007", "2147483648", "set", "true",
+                                 "S",   "&&"};
+  for (unsigned int i = 0; i < sizeof(symbols) / sizeof(symbols[0]); i++) {
+    sstring s = sstring_create_string(symbols[i]);
+    term t = term_create(s);
+    sstring_destroy(&s);
+    test_print_kind(t);
+    term_destroy(&t);
+  }
+  sstring s = sstring_create_string("if");
+  term t = term_create(s);
+  sstring_destroy(&s);
+  s = sstring_create_string("'y");
+  term_set_symbol(t, s);
+  sstring_destroy(&s);
+  test_print_kind(t);
+  term copy = term_copy(t);
+  test_print_kind(copy);
+  term peano = term_create_peano(2);
+  term_replace_copy(copy, term_get_argument(term_get_argument(peano, 0), 0));
+  test_print_kind(copy);
+  term_destroy(&t);
+  term_destroy(&copy);
+  term_destroy(&peano);
+}
+
+/*!
+ * Build \c f ( f ( … leaf … ) ) with depth \c f .
+ */
+static term test_build_deep(int depth, char const *const leaf) {
+  sstring s = sstring_create_string(leaf);
+  term t = term_create(s);
+  sstring_destroy(&s);
+  s = sstring_create_string("f");
+  for (int i = 0; i < depth; i++) {
+    term u = term_create(s);
+    term_add_argument_last(u, t);
+    t = u;
+  }
+  sstring_destroy(&s);
+  return t;
+}
+
+/*! Operations on a term too deep for recursive functions. */
+static void test_deep() {
+  int const depth = 300000;
+  term t = test_build_deep(depth, "'x");
+  term copy = term_copy(t);
+  printf("deep: compare with copy %d\n", term_compare(t, copy));
+  sstring x = sstring_create_string("'x");
+  sstring a = sstring_create_string("a");
+  printf("deep: contains 'x %d, contains a %d\n", term_contains_symbol(t, x),
+         term_contains_symbol(t, a));
+  term value = term_create(a);
+  term_replace_variable(copy, x, value);
+  printf("deep: compare after replacement %d, contains a %d\n",
+         term_compare(t, copy), term_contains_symbol(copy, a));
+  term expected = test_build_deep(depth, "a");
+  printf("deep: compare with expected %d\n", term_compare(copy, expected));
+  FILE *out = tmpfile();
+  assert(out != NULL);
+  term_print_compact(copy, out);
+  printf("deep: compact print of %ld chars\n", ftell(out));
+  fclose(out);
+  sstring_destroy(&x);
+  sstring_destroy(&a);
+  term_destroy(&value);
+  term_destroy(&expected);
+  term_destroy(&copy);
+  term_destroy(&t);
+}
+
+/*! Leaving a loop on the arguments early does not modify the term. */
+static void test_iterator() {
+  FILE *in = tmpfile();
+  assert(in != NULL);
+  fputs("f ( a b c )", in);
+  rewind(in);
+  term t = term_scan(in);
+  fclose(in);
+  term arg;
+  term_for_each_argument(arg, t) {
+    sstring_print(term_get_symbol(arg), stdout);
+    if (sstring_get_char(term_get_symbol(arg), 0) == 'b') {
+      break;
+    }
+  }
+  putchar('\n');
+  term_argument_traversal tat = term_argument_traversal_create(t);
+  term_argument_traversal_get_next(tat);
+  term_argument_traversal_destroy(&tat);
+  term_print_compact(t, stdout);
+  putchar('\n');
+  term_destroy(&t);
+}
+
+static term test_scan_string(char const *const text) {
+  FILE *in = tmpfile();
+  assert(in != NULL);
+  fputs(text, in);
+  rewind(in);
+  term t = term_scan(in);
+  fclose(in);
+  return t;
+}
+
+static void test_move() {
+  term t = test_scan_string("f ( a g ( b c ) d )");
+  term g = term_take_argument(t, 1);
+  assert(term_get_father(g) == NULL);
+  term_print_compact(t, stdout);
+  putchar(' ');
+  term_print_compact(g, stdout);
+  putchar('\n');
+  term a = term_swap_argument(t, 0, g);
+  assert(term_get_father(g) == t);
+  term_print_compact(t, stdout);
+  putchar(' ');
+  term_print_compact(a, stdout);
+  putchar('\n');
+  // replace by a descendant: g ( b c ) becomes c
+  term c = term_get_argument(g, 1);
+  term_replace_move(g, &c);
+  assert(c == NULL);
+  assert(term_get_father(g) == t);
+  term_print_compact(t, stdout);
+  putchar('\n');
+  // replace by an unrelated term, its arguments change father
+  term_replace_move(t, &a);
+  term_print_compact(t, stdout);
+  putchar('\n');
+  term h = test_scan_string("h ( S ( S ( 0 ) ) e )");
+  term_replace_move(t, &h);
+  assert(term_get_father(term_get_argument(t, 1)) == t);
+  term_print_compact(t, stdout);
+  putchar('\n');
+  term_destroy(&t);
+}
+
 int main(void) {
   test_example_1();
   test_example_2();
@@ -217,5 +403,10 @@ int main(void) {
   test_example_5();
   test_ajout_i();
   test_traversal();
+  test_peano_run();
+  test_kind();
+  test_deep();
+  test_iterator();
+  test_move();
   return 0;
 }
@@ -0,0 +1,149 @@
+#include <assert.h>
+#include <stdio.h>
+
+#include "term.h"
+#include "term_io.h"
+#include "scheduler.h"
+#include "term_parallel.h"
+#include "term_stats.h"
+
+#undef NDEBUG // FORCE ASSERT ACTIVATION
+
+/*! Numbers of workers tested. */
+static int const nb_workers[] = {1, 2, 4, 8};
+
+static term scan_file(char const *const file_name) {
+  FILE *in = fopen(file_name, "r");
+  assert(in != NULL);
+  term t = term_scan(in);
+  fclose(in);
+  return t;
+}
+
+static term create_symbol(char const *const name) {
+  sstring s = sstring_create_string(name);
+  term t = term_create(s);
+  sstring_destroy(&s);
+  return t;
+}
+
+/*!
+ * Complete binary tree of \c f with \c a leaves.
+ */
+static term create_tree(int depth) {
+  if (depth == 0) {
+    return create_symbol("a");
+  }
+  term t = create_symbol("f");
+  term_add_argument_last(t, create_tree(depth - 1));
+  term_add_argument_last(t, create_tree(depth - 1));
+  return t;
+}
+
+/*!
+ * \c g with \c size arguments alternating \c a and \c h ( \c b \c c ).
+ */
+static term create_wide(int size) {
+  term t = create_symbol("g");
+  for (int i = 0; i < size; i++) {
+    if (i % 2 == 0) {
+      term_add_argument_last(t, create_symbol("a"));
+    } else {
+      term h = create_symbol("h");
+      term_add_argument_last(h, create_symbol("b"));
+      term_add_argument_last(h, create_symbol("c"));
+      term_add_argument_last(t, h);
+    }
+  }
+  return t;
+}
+
+/*!
+ * Chain of \c depth unary \c u above a term.
+ */
+static term create_chain(int depth, term bottom) {
+  for (int i = 0; i < depth; i++) {
+    term u = create_symbol("u");
+    term_add_argument_last(u, bottom);
+    bottom = u;
+  }
+  return bottom;
+}
+
+static int sign(int n) { return (n > 0) - (n < 0); }
+
+/*!
+ * Last leaf of a term (in pre-order).
+ */
+static term last_leaf(term t) {
+  while (term_get_arity(t) > 0) {
+    t = term_get_argument(t, term_get_arity(t) - 1);
+  }
+  return t;
+}
+
+/*!
+ * Check the parallel functions against the sequential ones on a term and on
+ * a copy with its last leaf changed (the difference is found last).
+ * \param t term (destroyed).
+ */
+static void test_term(char const *const name, term t) {
+  for (unsigned i = 0; i < sizeof(nb_workers) / sizeof(nb_workers[0]); i++) {
+    scheduler s = scheduler_create(nb_workers[i]);
+    scheduler_enter(s);
+    term copy = term_copy_parallel(t);
+    assert(term_compare(t, copy) == 0);
+    assert(term_compare_parallel(t, copy) == 0);
+    assert(term_compare_parallel(t, t) == 0);
+    sstring z = sstring_create_string("z");
+    term_set_symbol(last_leaf(copy), z);
+    sstring_destroy(&z);
+    int const expected = term_compare(t, copy);
+    assert(expected != 0);
+    assert(term_compare_parallel(t, copy) == expected);
+    assert(sign(term_compare_parallel(copy, t)) == -sign(expected));
+    term_destroy_parallel(&copy);
+    assert(copy == NULL);
+    scheduler_leave(s);
+    scheduler_destroy(&s);
+  }
+  printf("%s: ok\n", name);
+  term_destroy_parallel(&t);
+}
+
+/*!
+ * With counting on, the sequential functions are used and every term is
+ * counted.
+ */
+static void test_counted() {
+  term t = create_tree(14);
+  scheduler s = scheduler_create(4);
+  scheduler_enter(s);
+  term_stats_reset();
+  term_stats_enable(true);
+  term copy = term_copy_parallel(t);
+  assert(term_compare_parallel(t, copy) == 0);
+  term_destroy_parallel(&copy);
+  term_stats_enable(false);
+  scheduler_leave(s);
+  scheduler_destroy(&s);
+  term_stats stats = term_stats_get();
+  assert(stats.terms_created == stats.terms_destroyed);
+  assert(stats.terms_created == (1 << 15) - 1);
+  assert(stats.term_compare_calls == 1);
+  printf("counted: ok\n");
+  term_destroy(&t);
+}
+
+int main(void) {
+  test_term("small", scan_file("DATA/Terms/t_rewrite_05.term"));
+  test_term("tree", create_tree(16));
+  test_term("wide", create_wide(30000));
+  test_term("chain", create_chain(100, create_tree(14)));
+  term runs = create_wide(20000);
+  term_add_argument_first(runs, term_create_peano(100000));
+  term_add_argument_last(runs, term_create_peano(100000));
+  test_term("runs", runs);
+  test_counted();
+  return 0;
+}
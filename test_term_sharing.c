@@ -0,0 +1,302 @@
+// fmemopen is POSIX
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "rewrite.h"
+#include "term.h"
+#include "term_io.h"
+#include "term_stats.h"
+#include "unify.h"
+#include "valuate.h"
+
+#undef NDEBUG // FORCE ASSERT ACTIVATION
+
+/*! Number of threads of the concurrent tests. */
+#define NB_THREADS 8
+
+static term scan_string(char const *const text) {
+  FILE *in = fmemopen((void *)text, strlen(text), "r");
+  assert(in != NULL);
+  term t = term_scan(in);
+  fclose(in);
+  return t;
+}
+
+static term scan_file(char const *const file_name) {
+  FILE *in = fopen(file_name, "r");
+  if (in == NULL) {
+    return NULL;
+  }
+  term t = term_scan(in);
+  fclose(in);
+  return t;
+}
+
+static term create_symbol(char const *const name) {
+  sstring s = sstring_create_string(name);
+  term t = term_create(s);
+  sstring_destroy(&s);
+  return t;
+}
+
+/*!
+ * Complete binary tree of \c f with \c a leaves.
+ */
+static term create_tree(int depth) {
+  if (depth == 0) {
+    return create_symbol("a");
+  }
+  term t = create_symbol("f");
+  term_add_argument_last(t, create_tree(depth - 1));
+  term_add_argument_last(t, create_tree(depth - 1));
+  return t;
+}
+
+static void print(char const *const name, term t) {
+  printf("%s: ", name);
+  term_print_compact(t, stdout);
+  printf("\n");
+}
+
+/*!
+ * A copy and its original share their arguments until one of them is
+ * modified, the other one does not change.
+ */
+static void test_copy() {
+  term t = scan_string("f ( g ( a b ) h ( c ) S ( S ( 0 ) ) )");
+  term reference = term_copy(t);
+  term_sharing_enable(true);
+  term copy = term_copy(t);
+  assert(!term_contains_shared(t) && term_is_shared(copy));
+  assert(!term_is_shared(reference));
+  assert(term_compare(t, copy) == 0);
+  // a copy of a copy shares the same arguments
+  term copy2 = term_copy(copy);
+  assert(term_is_shared(copy2) && term_compare(copy2, t) == 0);
+  // modified deep inside
+  term g = term_get_argument(copy, 0);
+  assert(!term_is_shared(copy) && term_is_shared(g));
+  term_add_argument_last(g, create_symbol("x"));
+  sstring s = sstring_create_string("k");
+  term_set_symbol(term_get_argument(copy, 1), s);
+  sstring_destroy(&s);
+  print("copy", copy);
+  print("original", t);
+  assert(term_compare(t, reference) == 0);
+  assert(term_compare(copy2, reference) == 0);
+  // the original is modified, its copy does not change
+  term_destroy(&copy);
+  term_replace_copy(term_get_argument(t, 2), term_get_argument(t, 0));
+  print("modified", t);
+  print("copy2", copy2);
+  assert(term_compare(copy2, reference) == 0);
+  // the last one owning the shared arguments
+  term_destroy(&t);
+  term other = term_copy(copy2);
+  term_destroy(&copy2);
+  assert(term_compare(other, reference) == 0);
+  term_unshare(other);
+  assert(!term_contains_shared(other));
+  assert(term_compare(other, reference) == 0);
+  term_destroy(&other);
+  term_destroy(&reference);
+  term_sharing_enable(false);
+  printf("copy: ok\n");
+}
+
+/*!
+ * Sub-terms obtained before a copy stay the ones of the copied term: they
+ * can be modified, moved or destroyed without changing the copy.
+ */
+static void test_argument_before_copy() {
+  term t = scan_string("f ( g ( a ) h ( b ) c )");
+  term reference = term_copy(t);
+  term_sharing_enable(true);
+  term g = term_get_argument(t, 0);
+  term h = term_get_argument(t, 1);
+  term copy = term_copy(t);
+  term_add_argument_last(g, create_symbol("x"));
+  assert(term_get_argument(t, 0) == g);
+  assert(term_compare(copy, reference) == 0);
+  term x = create_symbol("y");
+  term_replace_move(x, &h);
+  term_destroy(&x);
+  term c = term_take_argument(t, 1);
+  term_destroy(&c);
+  print("modified", t);
+  print("copy", copy);
+  assert(term_compare(copy, reference) == 0);
+  term_destroy(&t);
+  assert(term_compare(copy, reference) == 0);
+  term_destroy(&copy);
+  term_destroy(&reference);
+  term_sharing_enable(false);
+  printf("argument before copy: ok\n");
+}
+
+/*!
+ * Number of terms created by a copy of a term (destroyed at once).
+ */
+static unsigned long copy_cost(term t) {
+  term_stats_reset();
+  term_stats_enable(true);
+  term copy = term_copy(t);
+  term_stats_enable(false);
+  unsigned long created = term_stats_get().terms_created;
+  term_destroy(&copy);
+  return created;
+}
+
+/*!
+ * The copies of a term share the same frozen copy of its arguments, until
+ * the term (or any of its sub-terms, however they were obtained) is modified.
+ */
+static void test_frozen_copy() {
+  term t = create_tree(8);
+  term_sharing_enable(true);
+  term leaf = t;
+  while (term_get_arity(leaf) > 0) {
+    leaf = term_get_argument(leaf, 1);
+  }
+  assert(copy_cost(t) > 256);
+  assert(copy_cost(t) == 1);
+  assert(copy_cost(term_get_argument(t, 0)) > 1);
+  assert(copy_cost(term_get_argument(t, 0)) == 1);
+  term before = term_copy(t);
+  term_add_argument_last(leaf, create_symbol("x"));
+  term after = term_copy(t);
+  assert(term_compare(before, after) != 0 && term_compare(after, t) == 0);
+  assert(copy_cost(t) == 1);
+  // a shared sub-term cloned by an access is part of the term too
+  term_replace_copy(term_get_argument(t, 0), before);
+  term_destroy(&after);
+  after = term_copy(t);
+  term sub = term_get_argument(term_get_argument(t, 0), 0);
+  term_set_symbol(sub, term_get_symbol(leaf));
+  assert(term_compare(after, t) != 0);
+  term_destroy(&after);
+  after = term_copy(t);
+  assert(term_compare(after, t) == 0);
+  assert(copy_cost(t) == 1);
+  term_destroy(&after);
+  term_destroy(&before);
+  term_destroy(&t);
+  term_sharing_enable(false);
+  printf("frozen copy: ok\n");
+}
+
+/*!
+ * Runs are compared with terms built explicitly without being expanded.
+ */
+static void test_compare_runs() {
+  term t = scan_string("f ( S ( S ( S ( 0 ) ) ) S ( 0 ) )");
+  term u = create_symbol("f");
+  term_add_argument_last(u, term_create_peano(3));
+  term_add_argument_last(u, term_create_peano(1));
+  assert(term_compare(t, u) == 0 && term_compare(u, t) == 0);
+  assert(term_get_successor_run(term_get_argument(u, 0)) == 3);
+  term v = create_symbol("f");
+  term_add_argument_last(v, term_create_peano(2));
+  term_add_argument_last(v, term_create_peano(1));
+  assert(term_compare(t, v) > 0 && term_compare(v, t) < 0);
+  term_destroy(&v);
+  term_destroy(&u);
+  term_destroy(&t);
+  printf("compare runs: ok\n");
+}
+
+/*!
+ * Work of a thread of \c test_threads : copy the shared tree, modify the copy
+ * deep inside, check and destroy it.
+ */
+typedef struct {
+  term shared;
+  term reference;
+  int rank;
+} thread_data;
+
+static void *copy_modify(void *data) {
+  thread_data *d = data;
+  for (int round = 0; round < 20; round++) {
+    term copy = term_copy(d->shared);
+    term sub = copy;
+    for (int depth = 0; depth < 6; depth++) {
+      sub = term_get_argument(sub, (d->rank >> (depth % 3)) & 1);
+    }
+    term_add_argument_last(sub, create_symbol("x"));
+    assert(term_compare(copy, d->reference) != 0);
+    term_destroy(&copy);
+  }
+  assert(term_compare(d->shared, d->reference) == 0);
+  term_destroy(&d->shared);
+  return NULL;
+}
+
+/*!
+ * Threads modify and destroy their copies of the same term at once.
+ */
+static void test_threads() {
+  term t = create_tree(10);
+  term reference = term_copy(t);
+  term_sharing_enable(true);
+  pthread_t threads[NB_THREADS];
+  thread_data data[NB_THREADS];
+  for (int i = 0; i < NB_THREADS; i++) {
+    data[i].shared = term_copy(t);
+    data[i].reference = reference;
+    data[i].rank = i;
+  }
+  for (int i = 0; i < NB_THREADS; i++) {
+    int error = pthread_create(&threads[i], NULL, copy_modify, &data[i]);
+    assert(error == 0);
+  }
+  term_destroy(&t);
+  for (int i = 0; i < NB_THREADS; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  term_sharing_enable(false);
+  term_destroy(&reference);
+  printf("threads: ok\n");
+}
+
+/*!
+ * The engines give the same results with sharing.
+ * \param format name of the test files, with the number of the file.
+ * \param engine engine to run.
+ */
+static void test_engine(char const *const name, char const *const format,
+                        term (*engine)(term t)) {
+  for (int i = 0;; i++) {
+    char file_name[64];
+    snprintf(file_name, sizeof(file_name), format, i);
+    term t = scan_file(file_name);
+    if (t == NULL) {
+      break;
+    }
+    term expected = engine(t);
+    term_sharing_enable(true);
+    term res = engine(t);
+    term_sharing_enable(false);
+    assert(term_compare(expected, res) == 0);
+    term_destroy(&res);
+    term_destroy(&expected);
+    term_destroy(&t);
+  }
+  printf("%s: ok\n", name);
+}
+
+int main(void) {
+  test_copy();
+  test_argument_before_copy();
+  test_frozen_copy();
+  test_compare_runs();
+  test_threads();
+  test_engine("rewrite", "DATA/Terms/t_rewrite_%02d.term", term_rewrite);
+  test_engine("unify", "DATA/Terms/t_unify_%d.term", term_unify);
+  test_engine("valuate", "DATA/Terms/t_valuate_%d.term", term_valuate);
+  return 0;
+}
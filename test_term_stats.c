@@ -0,0 +1,93 @@
+#include <assert.h>
+#include <stdio.h>
+
+#include "rewrite.h"
+#include "term.h"
+#include "term_io.h"
+#include "term_stats.h"
+#include "unify.h"
+#include "valuate.h"
+
+#undef NDEBUG // FORCE ASSERT ACTIVATION
+
+static term scan_file(char const *const file_name) {
+  FILE *in = fopen(file_name, "r");
+  assert(in != NULL);
+  term t = term_scan(in);
+  fclose(in);
+  return t;
+}
+
+/*!
+ * Run an engine on a file with counting on, check that every term created is
+ * destroyed and print the counters.
+ */
+static void test_file(char const *const file_name, term (*engine)(term),
+                      bool json) {
+  term t = scan_file(file_name);
+  term_stats_reset();
+  term_stats_enable(true);
+  term res = engine(t);
+  term_destroy(&res);
+  term_stats_enable(false);
+  term_stats stats = term_stats_get();
+  assert(stats.terms_created == stats.terms_destroyed);
+  assert(stats.bytes_allocated > 0);
+  printf("== %s\n", file_name);
+  if (json) {
+    term_stats_print_json(stdout);
+  } else {
+    term_stats_print(stdout);
+  }
+  term_destroy(&t);
+}
+
+static void test_disabled() {
+  term_stats_reset();
+  assert(!term_stats_is_enabled());
+  term t = scan_file("DATA/Terms/t_rewrite_05.term");
+  term res = term_rewrite(t);
+  term_destroy(&res);
+  term_destroy(&t);
+  term_stats stats = term_stats_get();
+  assert(stats.terms_created == 0);
+  assert(stats.bytes_allocated == 0);
+  assert(stats.sstring_compare_calls == 0);
+  assert(term_stats_get_nb_rules() == 0);
+}
+
+static void test_rules() {
+  term t = scan_file("DATA/Terms/t_rewrite_07.term");
+  term_stats_reset();
+  term_stats_enable(true);
+  term res = term_rewrite(t);
+  term_stats_enable(false);
+  term_destroy(&res);
+  term_destroy(&t);
+  assert(term_stats_get_nb_rules() == 2);
+  unsigned long attempts = 0;
+  unsigned long successes = 0;
+  for (int i = 0; i < term_stats_get_nb_rules(); i++) {
+    unsigned long a, s;
+    term_stats_get_rule(i, &a, &s);
+    attempts += a;
+    successes += s;
+  }
+  term_stats stats = term_stats_get();
+  assert(attempts == stats.match_attempts);
+  assert(successes == stats.match_successes);
+  term_stats_reset();
+  assert(term_stats_get_nb_rules() == 0);
+}
+
+int main(void) {
+  test_disabled();
+  test_rules();
+  test_file("DATA/Terms/t_rewrite_05.term", term_rewrite, false);
+  test_file("DATA/Terms/t_rewrite_07.term", term_rewrite, true);
+  test_file("DATA/Terms/t_unify_5.term", term_unify, false);
+  test_file("DATA/Terms/t_unify_6.term", term_unify, true);
+  test_file("DATA/Terms/t_valuate_3.term", term_valuate, true);
+  term_stats_reset();
+  return 0;
+}
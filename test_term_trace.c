@@ -0,0 +1,127 @@
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rewrite.h"
+#include "term.h"
+#include "term_io.h"
+#include "term_trace.h"
+#include "unify.h"
+#include "valuate.h"
+
+#undef NDEBUG // FORCE ASSERT ACTIVATION
+
+/*! Side file of the test. */
+#define TRACE_FILE "DATA/Results/test_term_trace.json"
+
+/*! Number of threads writing events at once. */
+#define NB_THREADS 4
+
+static void run_file(char const *const file_name, term (*engine)(term)) {
+  FILE *in = fopen(file_name, "r");
+  assert(in != NULL);
+  term t = term_scan(in);
+  fclose(in);
+  term res = engine(t);
+  term_destroy(&res);
+  term_destroy(&t);
+}
+
+/*!
+ * Print the name of each event of the trace (times change from run to run).
+ */
+static void print_events(void) {
+  FILE *in = fopen(TRACE_FILE, "r");
+  assert(in != NULL);
+  char line[1024];
+  char const *const key = "{\"name\": \"";
+  int nb_lines = 0;
+  while (fgets(line, sizeof(line), in) != NULL) {
+    nb_lines++;
+    char *name = strstr(line, key);
+    if (name != NULL) {
+      name += strlen(key);
+      *strchr(name, '"') = '\0';
+      printf("%s\n", name);
+    }
+  }
+  fclose(in);
+  assert(nb_lines >= 2);
+}
+
+static void *run_thread(void *data) {
+  (void)data;
+  for (int i = 0; i < 50; i++) {
+    run_file("DATA/Terms/t_valuate_5.term", term_valuate);
+    run_file("DATA/Terms/t_unify_6.term", term_unify);
+  }
+  return NULL;
+}
+
+/*!
+ * Threads write events at once: each event is a whole line of the array, with
+ * the number of its thread.
+ */
+static void test_threads(void) {
+  bool ok = term_trace_open(TRACE_FILE);
+  assert(ok);
+  pthread_t threads[NB_THREADS];
+  for (int i = 0; i < NB_THREADS; i++) {
+    int error = pthread_create(&threads[i], NULL, run_thread, NULL);
+    assert(error == 0);
+  }
+  for (int i = 0; i < NB_THREADS; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  term_trace_close();
+  FILE *in = fopen(TRACE_FILE, "r");
+  assert(in != NULL);
+  char line[1024];
+  char *res = fgets(line, sizeof(line), in);
+  assert(res != NULL && strcmp(line, "[\n") == 0);
+  int nb_events = 0;
+  bool seen[NB_THREADS + 2] = {false};
+  bool last = false;
+  while (fgets(line, sizeof(line), in) != NULL && strcmp(line, "]\n") != 0) {
+    assert(!last);
+    size_t length = strlen(line);
+    assert(line[0] == '{');
+    last = strcmp(line + length - 4, "}},\n") != 0;
+    assert(!last || strcmp(line + length - 3, "}}\n") == 0);
+    long tid = 0;
+    char *member = strstr(line, "\"tid\": ");
+    assert(member != NULL);
+    tid = strtol(member + strlen("\"tid\": "), NULL, 10);
+    // the main thread is the first one
+    assert(2 <= tid && tid <= NB_THREADS + 1);
+    seen[tid] = true;
+    nb_events++;
+  }
+  assert(last);
+  fclose(in);
+  int nb_threads = 0;
+  for (int i = 0; i < NB_THREADS + 2; i++) {
+    nb_threads += seen[i];
+  }
+  printf("threads: %d events from %d threads\n", nb_events, nb_threads);
+}
+
+int main(void) {
+  assert(!term_trace_is_enabled());
+  assert(term_trace_start() < 0);
+  bool ok = term_trace_open(TRACE_FILE);
+  assert(ok);
+  assert(term_trace_is_enabled());
+  run_file("DATA/Terms/t_rewrite_05.term", term_rewrite);
+  run_file("DATA/Terms/t_unify_6.term", term_unify);
+  run_file("DATA/Terms/t_valuate_5.term", term_valuate);
+  term_trace_close();
+  assert(!term_trace_is_enabled());
+  // not traced
+  run_file("DATA/Terms/t_rewrite_07.term", term_rewrite);
+  print_events();
+  test_threads();
+  return 0;
+}
@@ -0,0 +1,28 @@
+#include <stdio.h>
+
+#include "term.h"
+#include "term_io.h"
+#include "valuate.h"
+
+#undef NDEBUG // FORCE ASSERT ACTIVATION
+
+/*!
+ * \file
+ * \brief Run shared valuate on input term.
+ *
+ * Output is the same as \c test_valuate .
+ * This should also be used to test for memory leak.
+ */
+
+int main(void) {
+  term t = term_scan(stdin);
+  term_print_expanded(t, stdout);
+  valuate_dag d = valuate_dag_create(t);
+  term_print_compact(t, stdout);
+  putchar('\n');
+  term_destroy(&t);
+  valuate_dag_print_compact(d, stdout);
+  putchar('\n');
+  valuate_dag_destroy(&d);
+  return 0;
+}
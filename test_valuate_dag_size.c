@@ -0,0 +1,148 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "term.h"
+#include "term_io.h"
+#include "valuate.h"
+
+#undef NDEBUG // FORCE ASSERT ACTIVATION
+
+/*!
+ * \file
+ * \brief Check the number of nodes of shared valuations.
+ *
+ * The expansion of a variable is shared whenever the bindings it can see are
+ * the same, so that the size of the DAG only grows linearly on chains of
+ * definitions that use each other more than once.
+ */
+
+static term create_symbol(char const *const name) {
+  sstring s = sstring_create_string(name);
+  term t = term_create(s);
+  sstring_destroy(&s);
+  return t;
+}
+
+static term create_variable(char const *const prefix, int i) {
+  char name[32];
+  snprintf(name, sizeof(name), "'%s%d", prefix, i);
+  return create_symbol(name);
+}
+
+static term create_set(term variable, term value, term body) {
+  term t = create_symbol("set");
+  term_add_argument_last(t, variable);
+  term_add_argument_last(t, value);
+  term_add_argument_last(t, body);
+  return t;
+}
+
+/*!
+ * Diamond chain: 'x_i = A ( 'y_i 'z_i ), 'y_i = B ( 'x_i+1 ) and
+ * 'z_i = C ( 'x_i+1 ) with 'x_n = L. Fully expanded, the value of 'x_0 has
+ * 2^(n+2) - 3 nodes.
+ * \param n length of the chain.
+ * \return term valuating 'x_0 .
+ */
+static term create_diamond(int n) {
+  term t = create_variable("x", 0);
+  for (int i = n - 1; i >= 0; i--) {
+    term a = create_symbol("A");
+    term_add_argument_last(a, create_variable("y", i));
+    term_add_argument_last(a, create_variable("z", i));
+    t = create_set(create_variable("x", i), a, t);
+    term c = create_symbol("C");
+    term_add_argument_last(c, create_variable("x", i + 1));
+    t = create_set(create_variable("z", i), c, t);
+    term b = create_symbol("B");
+    term_add_argument_last(b, create_variable("x", i + 1));
+    t = create_set(create_variable("y", i), b, t);
+  }
+  return create_set(create_variable("x", n), create_symbol("L"), t);
+}
+
+/*!
+ * Build the DAG of a term and return its size.
+ * \param t term to valuate.
+ * \param check whether to check the expansion against \c term_valuate .
+ * \return number of nodes of the DAG.
+ */
+static long dag_size(term t, bool check) {
+  valuate_dag d = valuate_dag_create(t);
+  if (check) {
+    term expanded = valuate_dag_expand(d);
+    term expected = term_valuate(t);
+    assert(term_compare(expanded, expected) == 0);
+    term_destroy(&expected);
+    term_destroy(&expanded);
+  }
+  long size = valuate_dag_get_size(d);
+  valuate_dag_destroy(&d);
+  return size;
+}
+
+/*!
+ * Build \c F ( F ( … L … ) ) with depth \c depth .
+ */
+static term create_deep(int depth) {
+  term t = create_symbol("L");
+  for (int i = 0; i < depth; i++) {
+    term u = create_symbol("F");
+    term_add_argument_last(u, t);
+    t = u;
+  }
+  return t;
+}
+
+/*!
+ * DAG of a term too deep for recursive functions: 'x = F^depth ( L ) used
+ * twice under \c depth nested definitions.
+ */
+static void test_deep(void) {
+  int const depth = 300000;
+  term t = create_symbol("G");
+  term_add_argument_last(t, create_symbol("'x"));
+  term_add_argument_last(t, create_symbol("'x"));
+  for (int i = 0; i < depth; i++) {
+    t = create_set(create_variable("y", i), create_symbol("L"), t);
+  }
+  t = create_set(create_symbol("'x"), create_deep(depth), t);
+  valuate_dag d = valuate_dag_create(t);
+  printf("deep: %ld nodes\n", valuate_dag_get_size(d));
+  term expected = create_symbol("G");
+  term_add_argument_last(expected, create_deep(depth));
+  term_add_argument_last(expected, create_deep(depth));
+  term expanded = valuate_dag_expand(d);
+  printf("deep: compare with expected %d\n", term_compare(expanded, expected));
+  FILE *out = tmpfile();
+  assert(out != NULL);
+  valuate_dag_print_compact(d, out);
+  printf("deep: compact print of %ld chars\n", ftell(out));
+  fclose(out);
+  term_destroy(&expanded);
+  term_destroy(&expected);
+  valuate_dag_destroy(&d);
+  term_destroy(&t);
+}
+
+int main(void) {
+  FILE *in = fopen("DATA/Terms/t_valuate_5.term", "r");
+  assert(in != NULL);
+  term t = term_scan(in);
+  fclose(in);
+  long size = dag_size(t, true);
+  printf("t_valuate_5: %ld nodes\n", size);
+  assert(size == 4);
+  term_destroy(&t);
+
+  for (int n = 4; n <= 256; n *= 2) {
+    t = create_diamond(n);
+    size = dag_size(t, n <= 12);
+    printf("diamond %d: %ld nodes\n", n, size);
+    assert(size == 3 * n + 1);
+    term_destroy(&t);
+  }
+  test_deep();
+  return 0;
+}
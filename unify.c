@@ -4,6 +4,9 @@
 
 #undef NDEBUG // FORCE ASSERT ACTIVATION
 
+#include "check.h"
+#include "term_stats.h"
+#include "term_trace.h"
 #include "term_variable.h"
 #include "unify.h"
 
@@ -73,31 +76,36 @@ static term term_create_equality(const term leftTerm, const term rightTerm) {
   bool_incompatible = true;
 
 /*!
-* \brief Make assertions to test if a term is a unify.
+* \brief Test if a term is a unify with at least one equality and only
+* equalities (of arity 2) as arguments.
+* Equalities created during unification are well formed by construction, so
+* the input is checked once, before the loop.
+* Should be used for CHECK only.
 */
-#define TEST_TERM_IS_UNIFY(term)                                               \
-  sstring stringUnify = sstring_create_string(symbol_unify);                   \
-  assert(sstring_compare(term_get_symbol(t), stringUnify) == 0);               \
-  assert(term_get_arity(t) > 0);                                               \
+static bool unify_is_well_formed(const term t) {
+  sstring stringUnify = sstring_create_string(symbol_unify);
+  sstring stringEquality = sstring_create_string(symbol_equal);
+  bool ok = sstring_equals(term_get_symbol(t), stringUnify) &&
+            term_get_arity(t) > 0;
+  term equality;
+  term_for_each_argument(equality, t) {
+    ok = ok && sstring_equals(term_get_symbol(equality), stringEquality) &&
+         term_get_arity(equality) == 2;
+  }
   sstring_destroy(&stringUnify);
-
-/*!
-* \brief Make assertions to test if a term is an equality.
-*/
-#define TEST_TERM_IS_EQUALITY(term)                                            \
-  sstring stringEquality = sstring_create_string(symbol_equal);                \
-  assert(!sstring_compare(term_get_symbol(equality), stringEquality));         \
-  assert(term_get_arity(equality) == 2);                                       \
   sstring_destroy(&stringEquality);
+  return ok;
+}
 
 /*!
 * \brief Create equalities between each index corresponding arguments of both
 * terms and add these equalities as argument of the given sequence (term).
 */
 #define CREATE_EQUALITIES_FOR_TERMS_AND_ADD_THEM_TO(termA, termB, sequence)    \
-  for (int i = 0; i < term_get_arity(termA); i++) {                            \
-    term tLeft = term_get_argument(termA, i);                                  \
-    term tRight = term_get_argument(termB, i);                                 \
+  term_argument_iterator rightIterator = term_argument_iterator_start(termB);   \
+  term tLeft;                                                                  \
+  term_for_each_argument(tLeft, termA) {                                       \
+    term tRight = term_argument_iterator_next(&rightIterator);                 \
     term newEquality = term_create_equality(tLeft, tRight);                    \
     term_add_argument_last(sequence, newEquality);                             \
   }
@@ -136,7 +144,11 @@ static term term_create_val_for_variable(term termA, term termB) {
 }
 
 term term_unify(const term t) {
-  TEST_TERM_IS_UNIFY(t);
+  CHECK(unify_is_well_formed(t));
+  double const trace_start = term_trace_start();
+  double round_start = trace_start;
+  int round = 0;
+  long substitutions = 0;
   sstring resSymbol = sstring_create_string(symbol_solution);
   term res = term_create(resSymbol);
   sstring_destroy(&resSymbol);
@@ -144,11 +156,11 @@ term term_unify(const term t) {
   sstring unify = sstring_create_string(symbol_unify);
   term nextSequenceToUnify = term_create(unify);
   bool incompatible = false;
-  term_argument_traversal equalityTraversal =
-      term_argument_traversal_create(sequenceToUnify);
-  while (term_argument_traversal_has_next(equalityTraversal) && !incompatible) {
-    term equality = term_argument_traversal_get_next(equalityTraversal);
-    TEST_TERM_IS_EQUALITY(equality);
+  term_argument_iterator equalityIterator =
+      term_argument_iterator_start(sequenceToUnify);
+  while (term_argument_iterator_has_next(&equalityIterator) && !incompatible) {
+    term equality = term_argument_iterator_next(&equalityIterator);
+    TERM_STATS_ADD(unify_equations, 1);
     term leftTerm = term_get_argument(equality, 0);
     term rightTerm = term_get_argument(equality, 1);
     if (term_is_variable(leftTerm) || term_is_variable(rightTerm)) {
@@ -162,6 +174,8 @@ term term_unify(const term t) {
       } else { // term left not in term right and terms not equal
         // So we get the value of this variable and replace it
         term tVal = term_create_val_for_variable(leftTerm, rightTerm);
+        TERM_STATS_ADD(unify_substitutions, 1);
+        substitutions++;
         term_replace_variable(sequenceToUnify,
                               term_get_symbol(term_get_argument(tVal, 0)),
                               term_get_argument(tVal, 1));
@@ -185,19 +199,30 @@ term term_unify(const term t) {
                                                     nextSequenceToUnify);
       }
     }
-    if (!term_argument_traversal_has_next(equalityTraversal) &&
+    if (!term_argument_iterator_has_next(&equalityIterator) &&
         term_get_arity(nextSequenceToUnify) > 0) {
+      term_trace_event("unify round", round_start,
+                       "\"round\": %d, \"queue\": %d, \"next_queue\": %d",
+                       round, term_get_arity(sequenceToUnify),
+                       term_get_arity(nextSequenceToUnify));
+      round++;
+      round_start = term_trace_start();
       term_destroy(&sequenceToUnify);
-      sequenceToUnify = term_copy(nextSequenceToUnify);
-      term_argument_traversal_destroy(&equalityTraversal);
-      equalityTraversal = term_argument_traversal_create(sequenceToUnify);
-      term_destroy(&nextSequenceToUnify);
+      sequenceToUnify = nextSequenceToUnify;
+      equalityIterator = term_argument_iterator_start(sequenceToUnify);
       nextSequenceToUnify = term_create(unify);
     }
   }
+  term_trace_event("unify round", round_start,
+                   "\"round\": %d, \"queue\": %d, \"next_queue\": %d", round,
+                   term_get_arity(sequenceToUnify),
+                   term_get_arity(nextSequenceToUnify));
+  term_trace_event("term_unify", trace_start,
+                   "\"rounds\": %d, \"substitutions\": %ld, "
+                   "\"incompatible\": %s",
+                   round + 1, substitutions, incompatible ? "true" : "false");
   sstring_destroy(&unify);
   term_destroy(&sequenceToUnify);
   term_destroy(&nextSequenceToUnify);
-  term_argument_traversal_destroy(&equalityTraversal);
   return res;
 }
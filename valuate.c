@@ -2,114 +2,1124 @@
 #include <assert.h>
 #include <ctype.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #undef NDEBUG // FORCE ASSERT ACTIVATION
+#include "scheduler.h"
+#include "term_stats.h"
+#include "term_trace.h"
 #include "term_variable.h"
 #include "valuate.h"
 
-/*! Symbol key-word for setting a variable term. */
-static char const *const symbol_set = "set";
+/*! Initial number of buckets of a \c valuate_environment. */
+#define ENVIRONMENT_BUCKETS_BASE 16
 
 /*!
- * Used as a stack to record the values of the variable being replaced.
+ * Definition of a variable by a \c set term.
+ * Nothing is copied: symbol and value belong to the term being valuated.
+ * Bindings live on the stack of \c term_valuate_inner (on the heap while a DAG
+ * is built) for the duration of the \c set body.
  */
-typedef struct variable_definition_list_struct {
+typedef struct variable_binding_struct {
   /*! variable symbol */
   sstring variable;
-  /*! variable value */
+  /*! variable value (not valuated) */
   term value;
-  /*! link to next valuation */
-  struct variable_definition_list_struct *next;
-} * variable_definition_list;
+  /*! true while the value is being valuated, the binding is then hidden */
+  bool expanding;
+  /*! number identifying the binding while a DAG is built (0 otherwise) */
+  unsigned long id;
+  /*! link to next binding in the same bucket */
+  struct variable_binding_struct *next;
+} variable_binding_struct, *variable_binding;
 
 /*!
- * Used to store the symbol for setting a variable.
- * Global variable to avoid to have to redefined it at every call to \c
- * term_valuate_inner
+ * Scoped environment: hash of variable symbol to binding.
+ * Inside a bucket, a binding is always before the bindings it shadows.
  */
-static sstring ss_set = NULL;
+typedef struct valuate_environment_struct {
+  /*! bucket heads */
+  variable_binding *buckets;
+  /*! number of buckets (a power of 2) */
+  unsigned int nb_buckets;
+  /*! number of bindings currently in the environment */
+  unsigned int nb_bindings;
+} valuate_environment_struct, *valuate_environment;
+
+/*!
+ * Valuation context: environment of the variables.
+ * It is kept between calls to avoid to have to recreate it.
+ */
+struct valuate_context_struct {
+  /*! interned \c set symbol (see \c term_symbol_intern ) */
+  sstring symbol_set;
+  /*! variables currently defined (empty between calls) */
+  valuate_environment env;
+  /*! deepest nesting of \c set during the current call (traced) */
+  unsigned int max_depth;
+  /*! terms created for the result during the current call (traced) */
+  unsigned long nb_created;
+  /*! budget of splits of the arguments into tasks (see \c scheduler_split ) */
+  int splits_left;
+};
+
+/*!
+ * Create an empty environment.
+ * \return empty environment.
+ */
+static valuate_environment environment_create(void) {
+  valuate_environment env = malloc(sizeof(valuate_environment_struct));
+  assert(env != NULL);
+  env->nb_buckets = ENVIRONMENT_BUCKETS_BASE;
+  env->nb_bindings = 0;
+  env->buckets = calloc(env->nb_buckets, sizeof(variable_binding));
+  assert(env->buckets != NULL);
+  return env;
+}
+
+/*!
+ * Destroy an environment. Bindings are not owned by the environment.
+ * \param env pointer on the environment to destroy.
+ */
+static void environment_destroy(valuate_environment *env) {
+  assert(env != NULL);
+  if (*env != NULL) {
+    free((*env)->buckets);
+    free(*env);
+    *env = NULL;
+  }
+}
+
+/*!
+ * Double the number of buckets.
+ * Each old bucket is moved from last to first binding and bindings are added in
+ * front, so that shadowing order is preserved.
+ * \param env environment to grow.
+ */
+static void environment_grow(valuate_environment env) {
+  unsigned int nb_buckets = env->nb_buckets * 2;
+  variable_binding *buckets = calloc(nb_buckets, sizeof(variable_binding));
+  assert(buckets != NULL);
+  for (unsigned int i = 0; i < env->nb_buckets; i++) {
+    while (env->buckets[i] != NULL) {
+      variable_binding *last = &env->buckets[i];
+      while ((*last)->next != NULL) {
+        last = &(*last)->next;
+      }
+      variable_binding b = *last;
+      *last = NULL;
+      unsigned int h = sstring_hash(b->variable) & (nb_buckets - 1);
+      b->next = buckets[h];
+      buckets[h] = b;
+    }
+  }
+  free(env->buckets);
+  env->buckets = buckets;
+  env->nb_buckets = nb_buckets;
+}
+
+/*!
+ * Add a binding, it shadows any previous binding of the same variable.
+ * \param env environment to add to.
+ * \param b binding to add.
+ */
+static void environment_push(valuate_environment env, variable_binding b) {
+  if (env->nb_bindings >= 2 * env->nb_buckets) {
+    environment_grow(env);
+  }
+  unsigned int h = sstring_hash(b->variable) & (env->nb_buckets - 1);
+  b->next = env->buckets[h];
+  env->buckets[h] = b;
+  env->nb_bindings++;
+}
+
 /*!
- * pop variable of a list function
- * \param ls pointer on a variable stack being reduced.
+ * Remove a binding.
+ * \param env environment to remove from.
+ * \param b binding to remove.
+ * \pre \c b is in \c env
  */
-static void pop_variable(variable_definition_list *ls) {
-  assert(ls != NULL);
-  if (*ls != NULL) {
-    term_destroy(&((*ls)->value));
-    sstring_destroy(&((*ls)->variable));
-    variable_definition_list next = (*ls)->next;
-    free(*ls);
-    *ls = next;
+static void environment_pop(valuate_environment env, variable_binding b) {
+  unsigned int h = sstring_hash(b->variable) & (env->nb_buckets - 1);
+  variable_binding *loc = &env->buckets[h];
+  while (*loc != b) {
+    assert(*loc != NULL);
+    loc = &(*loc)->next;
   }
+  *loc = b->next;
+  env->nb_bindings--;
 }
+
 /*!
- * push back in a list function
- * \param ls pointer on a variable stack being modified.
- * \param  variable sstring variable to add in the stack
- * \param  value term variable to add in the stack
+ * Find the innermost visible binding of a variable.
+ * \param env environment to look into.
+ * \param variable symbol of the variable.
+ * \return the binding or NULL if the variable is not defined.
  */
-static void push_back_variable(variable_definition_list *ls, sstring variable,
-                               term value) {
-  variable_definition_list vdl = (variable_definition_list)malloc(
-      sizeof(struct variable_definition_list_struct));
-  vdl->value = term_copy(value);
-  vdl->variable = sstring_copy(variable);
-  vdl->next = *ls;
-  *ls = vdl;
+static variable_binding environment_lookup(valuate_environment env,
+                                           sstring variable) {
+  TERM_STATS_ADD(valuate_lookups, 1);
+  unsigned int h = sstring_hash(variable) & (env->nb_buckets - 1);
+  for (variable_binding b = env->buckets[h]; b != NULL; b = b->next) {
+    if (!b->expanding && sstring_equals(b->variable, variable)) {
+      return b;
+    }
+  }
+  return NULL;
 }
+
+/*!
+ * Copy an environment for another thread: the bindings are copied too, so that
+ * their \c expanding flags are independent. Shadowing order is preserved.
+ * \param env environment to copy.
+ * \param bindings where to put the copies of the bindings
+ * ( \c env->nb_bindings of them).
+ * \return copy of the environment.
+ */
+static valuate_environment environment_copy(valuate_environment env,
+                                            variable_binding_struct *bindings) {
+  valuate_environment copy = malloc(sizeof(valuate_environment_struct));
+  assert(copy != NULL);
+  copy->nb_buckets = env->nb_buckets;
+  copy->nb_bindings = env->nb_bindings;
+  copy->buckets = calloc(copy->nb_buckets, sizeof(variable_binding));
+  assert(copy->buckets != NULL);
+  for (unsigned int i = 0; i < env->nb_buckets; i++) {
+    variable_binding *last = &copy->buckets[i];
+    for (variable_binding b = env->buckets[i]; b != NULL; b = b->next) {
+      *bindings = *b;
+      bindings->next = NULL;
+      *last = bindings;
+      last = &bindings->next;
+      bindings++;
+    }
+  }
+  return copy;
+}
+
+valuate_context valuate_context_create(void) {
+  valuate_context ctx = malloc(sizeof(struct valuate_context_struct));
+  assert(ctx != NULL);
+  sstring s = sstring_create_string("set");
+  ctx->symbol_set = term_symbol_intern(s);
+  sstring_destroy(&s);
+  ctx->env = environment_create();
+  ctx->max_depth = 0;
+  ctx->nb_created = 0;
+  ctx->splits_left = 0;
+  return ctx;
+}
+
+void valuate_context_destroy(valuate_context *ctx) {
+  assert(ctx != NULL);
+  if (*ctx != NULL) {
+    environment_destroy(&(*ctx)->env);
+    free(*ctx);
+    *ctx = NULL;
+  }
+}
+
 /*!
  * term is set function
+ * \param ctx valuation context
  * \param t term to check
  * \return bool to know if term is a right set
  */
-static bool term_is_set(term t) {
-  return (sstring_compare(term_get_symbol(t), ss_set) == 0) &&
+static bool term_is_set(valuate_context ctx, term t) {
+  return term_has_symbol(t, ctx->symbol_set) &&
          (term_get_arity(t) == 3) &&
          (term_is_variable(term_get_argument(t, 0)));
 }
 
+static term term_valuate_inner(valuate_context ctx, term t);
+
+/*!
+ * Arguments of a term split into chunks of consecutive arguments, each
+ * valuated with its own context.
+ */
+typedef struct {
+  /*! context of the term */
+  valuate_context ctx;
+  /*! arguments of the term */
+  term *args;
+  /*! valuated arguments */
+  term *values;
+  int nb_args;
+  int nb_chunks;
+  /*! context of each chunk */
+  struct valuate_context_struct *contexts;
+} valuate_chunks;
+
+static void valuate_chunk_run(void *data, int i) {
+  valuate_chunks *chunks = data;
+  valuate_context ctx = &chunks->contexts[i];
+  variable_binding_struct *bindings =
+      malloc(chunks->ctx->env->nb_bindings * sizeof(variable_binding_struct));
+  assert(chunks->ctx->env->nb_bindings == 0 || bindings != NULL);
+  ctx->env = environment_copy(chunks->ctx->env, bindings);
+  int const first = (long)i * chunks->nb_args / chunks->nb_chunks;
+  int const last = (long)(i + 1) * chunks->nb_args / chunks->nb_chunks;
+  for (int k = first; k < last; k++) {
+    chunks->values[k] = term_valuate_inner(ctx, chunks->args[k]);
+  }
+  environment_destroy(&ctx->env);
+  free(bindings);
+}
+
+/*!
+ * Valuate the arguments of a term and add them to the valuated term.
+ * Within the budget of splits of the context, the arguments are split into
+ * chunks run as tasks, each with a copy of the environment.
+ * \param ctx valuation context.
+ * \param t term whose arguments are valuated.
+ * \param res valuated term.
+ */
+static void term_valuate_arguments(valuate_context ctx, term t, term res) {
+  int splits_left = ctx->splits_left;
+  int const nb_chunks = scheduler_split(&splits_left, term_get_arity(t));
+  if (nb_chunks <= 1) {
+    term arg;
+    term_for_each_argument(arg, t) {
+      term_add_argument_last(res, term_valuate_inner(ctx, arg));
+    }
+    return;
+  }
+  valuate_chunks chunks;
+  chunks.ctx = ctx;
+  chunks.nb_args = term_get_arity(t);
+  chunks.nb_chunks = nb_chunks;
+  chunks.args = malloc(2 * chunks.nb_args * sizeof(term));
+  chunks.contexts = malloc(nb_chunks * sizeof(struct valuate_context_struct));
+  assert(chunks.args != NULL && chunks.contexts != NULL);
+  chunks.values = chunks.args + chunks.nb_args;
+  int k = 0;
+  term arg;
+  term_for_each_argument(arg, t) { chunks.args[k++] = arg; }
+  for (int i = 0; i < nb_chunks; i++) {
+    chunks.contexts[i].symbol_set = ctx->symbol_set;
+    chunks.contexts[i].max_depth = ctx->max_depth;
+    chunks.contexts[i].nb_created = 0;
+    chunks.contexts[i].splits_left = splits_left;
+  }
+  scheduler_parallel_for(nb_chunks, valuate_chunk_run, &chunks);
+  for (k = 0; k < chunks.nb_args; k++) {
+    term_add_argument_last(res, chunks.values[k]);
+  }
+  for (int i = 0; i < nb_chunks; i++) {
+    if (chunks.contexts[i].max_depth > ctx->max_depth) {
+      ctx->max_depth = chunks.contexts[i].max_depth;
+    }
+    ctx->nb_created += chunks.contexts[i].nb_created;
+  }
+  free(chunks.args);
+  free(chunks.contexts);
+}
+
 /*!
  * Recursive valuating function.
+ * The valuated term is built while \c t is walked, \c t is not modified.
+ * A variable is replaced by its value, valuated in the environment where the
+ * variable appears.
+ * \param ctx valuation context (holds the variables currently defined).
  * \param t term being valuated.
- * \param t_res valuated variable stack (list of active variables).
+ * \return valuated term.
  */
-static term term_valuate_inner(term t, variable_definition_list var_list) {
+static term term_valuate_inner(valuate_context ctx, term t) {
   assert(t != NULL);
-  if (term_is_set(t)) {
-    term variable = term_extract_argument(t, 0);
-    term value = term_extract_argument(t, 0);
-    term arg = term_extract_argument(t, 0);
+  valuate_environment env = ctx->env;
+  if (term_is_set(ctx, t)) {
+    variable_binding_struct binding;
+    binding.variable = term_get_symbol(term_get_argument(t, 0));
+    binding.value = term_get_argument(t, 1);
+    binding.expanding = false;
+    binding.id = 0;
+    environment_push(env, &binding);
+    if (env->nb_bindings > ctx->max_depth) {
+      ctx->max_depth = env->nb_bindings;
+    }
+    term res = term_valuate_inner(ctx, term_get_argument(t, 2));
+    environment_pop(env, &binding);
+    return res;
+  }
+  if (term_is_variable(t)) {
+    variable_binding b = environment_lookup(env, term_get_symbol(t));
+    if (b != NULL) {
+      b->expanding = true;
+      term res = term_valuate_inner(ctx, b->value);
+      b->expanding = false;
+      return res;
+    }
+  }
+  term res = term_create(term_get_symbol(t));
+  ctx->nb_created++;
+  term_valuate_arguments(ctx, t, res);
+  return res;
+}
+
+term term_valuate_with_context(valuate_context ctx, term t) {
+  assert(ctx != NULL);
+  assert(t != NULL);
+  double const trace_start = term_trace_start();
+  ctx->max_depth = 0;
+  ctx->nb_created = 0;
+  // tasks only in a scheduler, counters are not thread-safe and reading a run
+  // or shared arguments creates arguments
+  bool const parallel =
+      scheduler_get_current_nb_workers() > 1 && !term_stats_is_enabled() &&
+      !term_sharing_is_enabled() && !term_contains_successor_run(t) &&
+      !term_contains_shared(t);
+  ctx->splits_left = parallel ? scheduler_get_current_split_depth() : 0;
+  term res = term_valuate_inner(ctx, t);
+  term_trace_event("term_valuate", trace_start,
+                   "\"set_depth\": %u, \"terms_created\": %lu",
+                   ctx->max_depth, ctx->nb_created);
+  return res;
+}
+
+term term_valuate(term t) {
+  valuate_context ctx = valuate_context_create();
+  term res = term_valuate_with_context(ctx, t);
+  valuate_context_destroy(&ctx);
+  return res;
+}
+
+/*!
+ * Node of a shared valuated term.
+ * A node may be the argument of many nodes: the value of a variable is built
+ * once for a given environment and then referenced.
+ */
+typedef struct valuate_dag_node_struct {
+  /*! symbol (not a copy, belongs to the source of the DAG) */
+  sstring symbol;
+  /*! number of arguments */
+  int arity;
+  /*! arguments, possibly shared */
+  struct valuate_dag_node_struct **arguments;
+  /*! link to the next allocated node, to release all nodes exactly once */
+  struct valuate_dag_node_struct *allocated_next;
+} valuate_dag_node_struct, *valuate_dag_node;
+
+/*!
+ * Shared valuated term.
+ */
+struct valuate_dag_struct {
+  /*! copy of the initial term, all symbols are taken from it */
+  term source;
+  /*! root node */
+  valuate_dag_node root;
+  /*! all allocated nodes */
+  valuate_dag_node allocated;
+  /*! number of allocated nodes */
+  long nb_nodes;
+};
+
+/*!
+ * Variable defined by some \c set of the source of a DAG.
+ */
+typedef struct {
+  /*! variable symbol (belongs to the source) */
+  sstring variable;
+  /*! variables met in the values of its definitions (indices, with repeats) */
+  int *uses;
+  /*! number of used variables */
+  int nb_uses;
+  /*! allocated size of \c uses */
+  int size_uses;
+  /*! variables that may be looked up while its value is expanded (sorted
+   * indices), NULL until needed */
+  int *scope;
+  /*! number of variables in the scope */
+  int nb_scope;
+  /*! last traversal that met the variable */
+  unsigned int mark;
+  /*! next variable in the same bucket (index, -1 for none) */
+  int next;
+} dag_variable_struct;
+
+/*!
+ * Memorized expansion of a variable.
+ * The expansion of a value only depends on the bindings that can be found while
+ * it is expanded: for each variable of the scope of its definition, the
+ * visible bindings in shadowing order.
+ */
+typedef struct expansion_struct {
+  /*! value of the variable */
+  term value;
+  /*! identifiers of the visible bindings, 0 ends the ones of a variable */
+  unsigned long *key;
+  /*! length of \c key */
+  unsigned int key_length;
+  /*! hash of value and key */
+  unsigned int hash;
+  /*! shared expansion */
+  valuate_dag_node node;
+  /*! link to next expansion in the same bucket */
+  struct expansion_struct *next;
+} * expansion;
+
+/*!
+ * Data used while building a \c valuate_dag.
+ */
+typedef struct dag_builder_struct {
+  /*! DAG being built */
+  valuate_dag dag;
+  /*! valuation context (holds the variables currently defined) */
+  valuate_context ctx;
+  /*! number of bindings created so far (identifiers are never reused) */
+  unsigned long nb_bindings;
+  /*! variables defined in the source */
+  dag_variable_struct *variables;
+  /*! number of variables */
+  int nb_variables;
+  /*! allocated size of \c variables */
+  int size_variables;
+  /*! first variable of each bucket (index, -1 for none) */
+  int *variable_buckets;
+  /*! number of variable buckets (a power of 2) */
+  unsigned int nb_variable_buckets;
+  /*! number of the current traversal of the variables */
+  unsigned int mark;
+  /*! key being built (see \c expansion_struct ) */
+  unsigned long *key;
+  /*! length of the key being built */
+  unsigned int key_length;
+  /*! allocated size of \c key */
+  unsigned int key_size;
+  /*! memorized expansions (hash buckets) */
+  expansion *expansions;
+  /*! number of buckets (a power of 2) */
+  unsigned int nb_buckets;
+  /*! number of memorized expansions */
+  unsigned int nb_expansions;
+} * dag_builder;
+
+/*!
+ * Find a variable defined in the source.
+ * \param builder DAG builder.
+ * \param variable symbol of the variable.
+ * \return index of the variable or -1 if it is not defined.
+ */
+static int dag_variable_find(dag_builder builder, sstring variable) {
+  unsigned int h =
+      sstring_hash(variable) & (builder->nb_variable_buckets - 1);
+  for (int i = builder->variable_buckets[h]; i >= 0;
+       i = builder->variables[i].next) {
+    if (sstring_equals(builder->variables[i].variable, variable)) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/*!
+ * Find or add a variable.
+ * \param builder DAG builder.
+ * \param variable symbol of the variable.
+ * \return index of the variable.
+ */
+static int dag_variable_add(dag_builder builder, sstring variable) {
+  int i = dag_variable_find(builder, variable);
+  if (i >= 0) {
+    return i;
+  }
+  if (builder->nb_variables == builder->size_variables) {
+    builder->size_variables = 2 * builder->size_variables + 8;
+    builder->variables =
+        realloc(builder->variables,
+                builder->size_variables * sizeof(dag_variable_struct));
+    assert(builder->variables != NULL);
+  }
+  if ((unsigned int)builder->nb_variables >= 2 * builder->nb_variable_buckets) {
+    builder->nb_variable_buckets *= 2;
+    free(builder->variable_buckets);
+    builder->variable_buckets =
+        malloc(builder->nb_variable_buckets * sizeof(int));
+    assert(builder->variable_buckets != NULL);
+    for (unsigned int h = 0; h < builder->nb_variable_buckets; h++) {
+      builder->variable_buckets[h] = -1;
+    }
+    for (int j = 0; j < builder->nb_variables; j++) {
+      unsigned int h = sstring_hash(builder->variables[j].variable) &
+                       (builder->nb_variable_buckets - 1);
+      builder->variables[j].next = builder->variable_buckets[h];
+      builder->variable_buckets[h] = j;
+    }
+  }
+  i = builder->nb_variables++;
+  dag_variable_struct *v = &builder->variables[i];
+  v->variable = variable;
+  v->uses = NULL;
+  v->nb_uses = v->size_uses = 0;
+  v->scope = NULL;
+  v->nb_scope = 0;
+  v->mark = 0;
+  unsigned int h = sstring_hash(variable) & (builder->nb_variable_buckets - 1);
+  v->next = builder->variable_buckets[h];
+  builder->variable_buckets[h] = i;
+  return i;
+}
 
-    push_back_variable(&var_list, term_get_symbol(variable), value);
+/*!
+ * Record that variable \c used is met while the value of \c user is
+ * expanded.
+ * \param builder DAG builder.
+ * \param user index of the defined variable.
+ * \param used index of the variable met.
+ */
+static void dag_variable_add_use(dag_builder builder, int user, int used) {
+  dag_variable_struct *v = &builder->variables[user];
+  if (v->nb_uses == v->size_uses) {
+    v->size_uses = 2 * v->size_uses + 4;
+    v->uses = realloc(v->uses, v->size_uses * sizeof(int));
+    assert(v->uses != NULL);
+  }
+  v->uses[v->nb_uses++] = used;
+}
 
-    term_destroy(&variable);
-    term_destroy(&value);
-    term_destroy(&t);
-    t = term_valuate_inner(arg, var_list);
+/*!
+ * Term still to be scanned by \c dag_variables_collect .
+ */
+typedef struct {
+  /*! term to scan */
+  term t;
+  /*! index of the variable whose value contains \c t or -1 */
+  int user;
+} dag_collect_item;
+
+/*!
+ * Collect the variables of the source and the variables met in their values.
+ * A \c set inside a value is used by it, so that everything that can be met
+ * while the inner value is expanded can also be met for the outer one.
+ * The terms still to scan are kept on an explicit stack, so any depth can be
+ * scanned.
+ * \param builder DAG builder.
+ * \param t term to scan.
+ */
+static void dag_variables_collect(dag_builder builder, term t) {
+  int size = 64;
+  int nb = 0;
+  dag_collect_item *stack = malloc(size * sizeof(dag_collect_item));
+  assert(stack != NULL);
+  stack[nb].t = t;
+  stack[nb++].user = -1;
+  while (nb > 0) {
+    dag_collect_item item = stack[--nb];
+    // room for the arguments of a set (at most 2 more items)
+    if (nb + 2 > size) {
+      size *= 2;
+      stack = realloc(stack, size * sizeof(dag_collect_item));
+      assert(stack != NULL);
+    }
+    if (term_is_set(builder->ctx, item.t)) {
+      int defined = dag_variable_add(
+          builder, term_get_symbol(term_get_argument(item.t, 0)));
+      if (item.user >= 0) {
+        dag_variable_add_use(builder, item.user, defined);
+      }
+      stack[nb].t = term_get_argument(item.t, 2);
+      stack[nb++].user = item.user;
+      stack[nb].t = term_get_argument(item.t, 1);
+      stack[nb++].user = defined;
+      continue;
+    }
+    if (term_is_variable(item.t)) {
+      if (item.user >= 0) {
+        dag_variable_add_use(
+            builder, item.user,
+            dag_variable_add(builder, term_get_symbol(item.t)));
+      }
+      continue;
+    }
+    int const arity = term_get_arity(item.t);
+    if (nb + arity > size) {
+      size = 2 * size + arity;
+      stack = realloc(stack, size * sizeof(dag_collect_item));
+      assert(stack != NULL);
+    }
+    // the first argument on top, so that it is scanned first
+    int const top = nb + arity - 1;
+    int i = 0;
+    term arg;
+    term_for_each_argument(arg, item.t) {
+      stack[top - i].t = arg;
+      stack[top - i].user = item.user;
+      i++;
+    }
+    nb += arity;
+  }
+  free(stack);
+}
+
+static int int_compare(void const *a, void const *b) {
+  int x = *(int const *)a;
+  int y = *(int const *)b;
+  return (x > y) - (x < y);
+}
+
+/*!
+ * Compute, once, the variables that may be looked up while the value of a
+ * variable is expanded: the ones reachable from its uses.
+ * \param builder DAG builder.
+ * \param index index of the variable.
+ */
+static void dag_variable_scope(dag_builder builder, int index) {
+  dag_variable_struct *v = &builder->variables[index];
+  if (v->scope != NULL) {
+    return;
+  }
+  unsigned int mark = ++builder->mark;
+  int *scope = malloc((builder->nb_variables + 1) * sizeof(int));
+  assert(scope != NULL);
+  int nb_scope = 0;
+  for (int i = 0; i < v->nb_uses; i++) {
+    if (builder->variables[v->uses[i]].mark != mark) {
+      builder->variables[v->uses[i]].mark = mark;
+      scope[nb_scope++] = v->uses[i];
+    }
+  }
+  for (int k = 0; k < nb_scope; k++) {
+    dag_variable_struct *u = &builder->variables[scope[k]];
+    for (int i = 0; i < u->nb_uses; i++) {
+      if (builder->variables[u->uses[i]].mark != mark) {
+        builder->variables[u->uses[i]].mark = mark;
+        scope[nb_scope++] = u->uses[i];
+      }
+    }
+  }
+  qsort(scope, nb_scope, sizeof(int), int_compare);
+  v->scope = scope;
+  v->nb_scope = nb_scope;
+}
 
-    pop_variable(&var_list);
+/*!
+ * Append to the key being built.
+ * \param builder DAG builder.
+ * \param id value to append.
+ */
+static void key_append(dag_builder builder, unsigned long id) {
+  if (builder->key_length == builder->key_size) {
+    builder->key_size *= 2;
+    builder->key =
+        realloc(builder->key, builder->key_size * sizeof(unsigned long));
+    assert(builder->key != NULL);
   }
+  builder->key[builder->key_length++] = id;
+}
 
-  variable_definition_list vdl = var_list;
-  while (vdl != NULL) {
-    term_replace_if_variable(t, vdl->variable, vdl->value);
-    vdl = vdl->next;
+/*!
+ * Build the key of the expansion of a binding in the current environment.
+ * \param builder DAG builder.
+ * \param b binding of the variable (hidden).
+ * \return hash of the key.
+ */
+static unsigned int expansion_key(dag_builder builder, variable_binding b) {
+  int index = dag_variable_find(builder, b->variable);
+  assert(index >= 0);
+  dag_variable_scope(builder, index);
+  dag_variable_struct *v = &builder->variables[index];
+  valuate_environment env = builder->ctx->env;
+  unsigned int hash = (unsigned int)((uintptr_t)b->value >> 4);
+  builder->key_length = 0;
+  for (int i = 0; i < v->nb_scope; i++) {
+    sstring variable = builder->variables[v->scope[i]].variable;
+    unsigned int h = sstring_hash(variable) & (env->nb_buckets - 1);
+    for (variable_binding c = env->buckets[h]; c != NULL; c = c->next) {
+      if (!c->expanding && sstring_equals(c->variable, variable)) {
+        key_append(builder, c->id);
+        hash = (hash * 2654435761u) ^ (unsigned int)c->id;
+      }
+    }
+    key_append(builder, 0);
+    hash = hash * 2654435761u;
   }
-  for (int i = 0; i < term_get_arity(t); i++) {
-    term tmp = term_extract_argument(t, i);
-    term arg = term_valuate_inner(tmp, var_list);
-    term_add_argument_position(t, arg, i);
+  return hash;
+}
+
+/*!
+ * Look for a memorized expansion.
+ * \param builder DAG builder, holding the key of \c value .
+ * \param value value of the variable.
+ * \param hash hash of the key.
+ * \return the expansion or NULL if none.
+ */
+static valuate_dag_node expansion_find(dag_builder builder, term value,
+                                       unsigned int hash) {
+  for (expansion e = builder->expansions[hash & (builder->nb_buckets - 1)];
+       e != NULL; e = e->next) {
+    if (e->hash == hash && e->value == value &&
+        e->key_length == builder->key_length &&
+        memcmp(e->key, builder->key,
+               builder->key_length * sizeof(unsigned long)) == 0) {
+      return e->node;
+    }
   }
+  return NULL;
+}
 
-  return t;
+/*!
+ * Memorize an expansion.
+ * \param builder DAG builder, holding the key of \c value .
+ * \param value value of the variable.
+ * \param hash hash of the key.
+ * \param node expansion of the variable.
+ */
+static void expansion_add(dag_builder builder, term value, unsigned int hash,
+                          valuate_dag_node node) {
+  if (builder->nb_expansions >= 2 * builder->nb_buckets) {
+    unsigned int nb_buckets = builder->nb_buckets * 2;
+    expansion *buckets = calloc(nb_buckets, sizeof(expansion));
+    assert(buckets != NULL);
+    for (unsigned int i = 0; i < builder->nb_buckets; i++) {
+      expansion e = builder->expansions[i];
+      while (e != NULL) {
+        expansion next = e->next;
+        unsigned int h = e->hash & (nb_buckets - 1);
+        e->next = buckets[h];
+        buckets[h] = e;
+        e = next;
+      }
+    }
+    free(builder->expansions);
+    builder->expansions = buckets;
+    builder->nb_buckets = nb_buckets;
+  }
+  expansion e = malloc(sizeof(struct expansion_struct));
+  assert(e != NULL);
+  e->value = value;
+  e->key_length = builder->key_length;
+  e->key = malloc((e->key_length + 1) * sizeof(unsigned long));
+  assert(e->key != NULL);
+  memcpy(e->key, builder->key, e->key_length * sizeof(unsigned long));
+  e->hash = hash;
+  e->node = node;
+  unsigned int h = hash & (builder->nb_buckets - 1);
+  e->next = builder->expansions[h];
+  builder->expansions[h] = e;
+  builder->nb_expansions++;
 }
 
-term term_valuate(term t) {
+/*!
+ * Allocate a DAG node.
+ * \param dag DAG the node belongs to.
+ * \param symbol symbol of the node.
+ * \param arity number of arguments.
+ * \return new node, arguments are to be filled.
+ */
+static valuate_dag_node valuate_dag_node_create(valuate_dag dag,
+                                                sstring symbol, int arity) {
+  valuate_dag_node n = malloc(sizeof(valuate_dag_node_struct));
+  assert(n != NULL);
+  n->symbol = symbol;
+  n->arity = arity;
+  n->arguments = NULL;
+  if (arity > 0) {
+    n->arguments = malloc(arity * sizeof(valuate_dag_node));
+    assert(n->arguments != NULL);
+  }
+  n->allocated_next = dag->allocated;
+  dag->allocated = n;
+  dag->nb_nodes++;
+  return n;
+}
+
+/*!
+ * Step still to be done by \c valuate_dag_build .
+ */
+typedef struct {
+  /*! what is to be done */
+  enum {
+    /*! build the node of \c t into \c *node */
+    DAG_STEP_BUILD,
+    /*! the body of the \c set of \c binding is built, remove the binding */
+    DAG_STEP_UNBIND,
+    /*! the value of \c binding is built into \c *node , memorize it */
+    DAG_STEP_MEMORIZE
+  } kind;
+  /*! term to build (\c DAG_STEP_BUILD ) */
+  term t;
+  /*! where the node goes */
+  valuate_dag_node *node;
+  /*! binding (\c DAG_STEP_UNBIND and \c DAG_STEP_MEMORIZE ) */
+  variable_binding binding;
+} dag_step;
+
+/*!
+ * Build the shared valuated term.
+ * Same as \c term_valuate_inner except that the expansions of a value with the
+ * same visible bindings (see \c expansion_struct ) is built once and shared.
+ * The steps still to be done are kept on an explicit stack, so any depth can be
+ * built. Bindings are allocated on the heap (they must not move while they are
+ * in the environment) and recycled.
+ * \param builder DAG builder.
+ * \param t term being valuated.
+ * \return node of the valuated term.
+ */
+static valuate_dag_node valuate_dag_build(dag_builder builder, term t) {
   assert(t != NULL);
-  term t_copy = term_copy(t);
-  ss_set = sstring_create_string(symbol_set);
-  variable_definition_list va_list = NULL;
-  t_copy = term_valuate_inner(t_copy, va_list);
-  sstring_destroy(&ss_set);
-  return t_copy;
+  valuate_dag_node root = NULL;
+  variable_binding free_bindings = NULL;
+  int size = 64;
+  int nb = 0;
+  dag_step *stack = malloc(size * sizeof(dag_step));
+  assert(stack != NULL);
+  stack[nb].kind = DAG_STEP_BUILD;
+  stack[nb].t = t;
+  stack[nb++].node = &root;
+  while (nb > 0) {
+    dag_step step = stack[--nb];
+    // room for the steps of a set or a variable (at most 2 more)
+    if (nb + 2 > size) {
+      size *= 2;
+      stack = realloc(stack, size * sizeof(dag_step));
+      assert(stack != NULL);
+    }
+    if (step.kind == DAG_STEP_UNBIND) {
+      environment_pop(builder->ctx->env, step.binding);
+      step.binding->next = free_bindings;
+      free_bindings = step.binding;
+      continue;
+    }
+    if (step.kind == DAG_STEP_MEMORIZE) {
+      // the key was overwritten by the inner expansions
+      unsigned int hash = expansion_key(builder, step.binding);
+      expansion_add(builder, step.binding->value, hash, *step.node);
+      step.binding->expanding = false;
+      continue;
+    }
+    if (term_is_set(builder->ctx, step.t)) {
+      variable_binding binding = free_bindings;
+      if (binding != NULL) {
+        free_bindings = binding->next;
+      } else {
+        binding = malloc(sizeof(variable_binding_struct));
+        assert(binding != NULL);
+      }
+      binding->variable = term_get_symbol(term_get_argument(step.t, 0));
+      binding->value = term_get_argument(step.t, 1);
+      binding->expanding = false;
+      binding->id = ++builder->nb_bindings;
+      environment_push(builder->ctx->env, binding);
+      stack[nb].kind = DAG_STEP_UNBIND;
+      stack[nb++].binding = binding;
+      stack[nb].kind = DAG_STEP_BUILD;
+      stack[nb].t = term_get_argument(step.t, 2);
+      stack[nb++].node = step.node;
+      continue;
+    }
+    if (term_is_variable(step.t)) {
+      variable_binding b =
+          environment_lookup(builder->ctx->env, term_get_symbol(step.t));
+      if (b != NULL) {
+        b->expanding = true;
+        unsigned int hash = expansion_key(builder, b);
+        *step.node = expansion_find(builder, b->value, hash);
+        if (*step.node != NULL) {
+          b->expanding = false;
+          continue;
+        }
+        stack[nb].kind = DAG_STEP_MEMORIZE;
+        stack[nb].node = step.node;
+        stack[nb++].binding = b;
+        stack[nb].kind = DAG_STEP_BUILD;
+        stack[nb].t = b->value;
+        stack[nb++].node = step.node;
+        continue;
+      }
+    }
+    valuate_dag_node res = valuate_dag_node_create(
+        builder->dag, term_get_symbol(step.t), term_get_arity(step.t));
+    *step.node = res;
+    if (nb + res->arity > size) {
+      size = 2 * size + res->arity;
+      stack = realloc(stack, size * sizeof(dag_step));
+      assert(stack != NULL);
+    }
+    // the first argument on top, so that it is built first
+    int const top = nb + res->arity - 1;
+    int i = 0;
+    term arg;
+    term_for_each_argument(arg, step.t) {
+      stack[top - i].kind = DAG_STEP_BUILD;
+      stack[top - i].t = arg;
+      stack[top - i].node = &res->arguments[i];
+      i++;
+    }
+    nb += res->arity;
+  }
+  free(stack);
+  while (free_bindings != NULL) {
+    variable_binding next = free_bindings->next;
+    free(free_bindings);
+    free_bindings = next;
+  }
+  return root;
+}
+
+valuate_dag valuate_dag_create_with_context(valuate_context ctx, term t) {
+  assert(ctx != NULL);
+  assert(t != NULL);
+  valuate_dag dag = malloc(sizeof(struct valuate_dag_struct));
+  assert(dag != NULL);
+  dag->source = term_copy(t);
+  dag->allocated = NULL;
+  dag->nb_nodes = 0;
+
+  struct dag_builder_struct builder;
+  builder.dag = dag;
+  builder.ctx = ctx;
+  builder.nb_bindings = 0;
+  builder.variables = NULL;
+  builder.nb_variables = builder.size_variables = 0;
+  builder.nb_variable_buckets = ENVIRONMENT_BUCKETS_BASE;
+  builder.variable_buckets = malloc(builder.nb_variable_buckets * sizeof(int));
+  assert(builder.variable_buckets != NULL);
+  for (unsigned int h = 0; h < builder.nb_variable_buckets; h++) {
+    builder.variable_buckets[h] = -1;
+  }
+  builder.mark = 0;
+  builder.key_length = 0;
+  builder.key_size = 16;
+  builder.key = malloc(builder.key_size * sizeof(unsigned long));
+  assert(builder.key != NULL);
+  builder.nb_buckets = ENVIRONMENT_BUCKETS_BASE;
+  builder.nb_expansions = 0;
+  builder.expansions = calloc(builder.nb_buckets, sizeof(expansion));
+  assert(builder.expansions != NULL);
+
+  dag_variables_collect(&builder, dag->source);
+  dag->root = valuate_dag_build(&builder, dag->source);
+
+  for (unsigned int i = 0; i < builder.nb_buckets; i++) {
+    while (builder.expansions[i] != NULL) {
+      expansion next = builder.expansions[i]->next;
+      free(builder.expansions[i]->key);
+      free(builder.expansions[i]);
+      builder.expansions[i] = next;
+    }
+  }
+  free(builder.expansions);
+  for (int i = 0; i < builder.nb_variables; i++) {
+    free(builder.variables[i].uses);
+    free(builder.variables[i].scope);
+  }
+  free(builder.variables);
+  free(builder.variable_buckets);
+  free(builder.key);
+  return dag;
+}
+
+valuate_dag valuate_dag_create(term t) {
+  valuate_context ctx = valuate_context_create();
+  valuate_dag dag = valuate_dag_create_with_context(ctx, t);
+  valuate_context_destroy(&ctx);
+  return dag;
+}
+
+void valuate_dag_destroy(valuate_dag *dag) {
+  assert(dag != NULL);
+  if (*dag != NULL) {
+    valuate_dag_node n = (*dag)->allocated;
+    while (n != NULL) {
+      valuate_dag_node next = n->allocated_next;
+      free(n->arguments);
+      free(n);
+      n = next;
+    }
+    term_destroy(&(*dag)->source);
+    free(*dag);
+    *dag = NULL;
+  }
+}
+
+long valuate_dag_get_size(valuate_dag dag) {
+  assert(dag != NULL);
+  return dag->nb_nodes;
+}
+
+/*!
+ * Node being printed or expanded, with the next argument to handle.
+ */
+typedef struct {
+  /*! node */
+  valuate_dag_node n;
+  /*! index of the next argument */
+  int next;
+  /*! term of the node (\c valuate_dag_expand only) */
+  term t;
+} dag_walk_item;
+
+/*!
+ * Make room for one more item on a walk stack.
+ * \param stack pointer on the stack.
+ * \param nb number of items in the stack.
+ * \param size pointer on the allocated size of the stack.
+ */
+static void dag_walk_reserve(dag_walk_item **stack, int nb, int *size) {
+  if (nb == *size) {
+    *size *= 2;
+    *stack = realloc(*stack, *size * sizeof(dag_walk_item));
+    assert(*stack != NULL);
+  }
+}
+
+void valuate_dag_print_compact(valuate_dag dag, FILE *out) {
+  assert(dag != NULL);
+  assert(out != NULL);
+  int size = 64;
+  int nb = 0;
+  dag_walk_item *stack = malloc(size * sizeof(dag_walk_item));
+  assert(stack != NULL);
+  valuate_dag_node n = dag->root;
+  while (true) {
+    // print the node and go down while there are arguments
+    sstring_print(n->symbol, out);
+    if (n->arity > 0) {
+      fprintf(out, " ( ");
+      dag_walk_reserve(&stack, nb, &size);
+      stack[nb].n = n;
+      stack[nb++].next = 1;
+      n = n->arguments[0];
+      continue;
+    }
+    // go up to the first node with arguments left
+    while (nb > 0 && stack[nb - 1].next == stack[nb - 1].n->arity) {
+      fprintf(out, " )");
+      nb--;
+    }
+    if (nb == 0) {
+      break;
+    }
+    fprintf(out, " ");
+    n = stack[nb - 1].n->arguments[stack[nb - 1].next++];
+  }
+  free(stack);
+}
+
+term valuate_dag_expand(valuate_dag dag) {
+  assert(dag != NULL);
+  int size = 64;
+  int nb = 0;
+  dag_walk_item *stack = malloc(size * sizeof(dag_walk_item));
+  assert(stack != NULL);
+  term res = term_create(dag->root->symbol);
+  stack[nb].n = dag->root;
+  stack[nb].next = 0;
+  stack[nb++].t = res;
+  while (nb > 0) {
+    dag_walk_item *top = &stack[nb - 1];
+    if (top->next == top->n->arity) {
+      nb--;
+      continue;
+    }
+    valuate_dag_node n = top->n->arguments[top->next++];
+    term t = term_create(n->symbol);
+    term_add_argument_last(top->t, t);
+    dag_walk_reserve(&stack, nb, &size);
+    stack[nb].n = n;
+    stack[nb].next = 0;
+    stack[nb++].t = t;
+  }
+  free(stack);
+  return res;
 }
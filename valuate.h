@@ -22,12 +22,45 @@
  */
 
 
+/*!
+ * Valuation context.
+ * It holds everything a valuation needs, so that valuations using different
+ * contexts can run concurrently.
+ * A context can be reused for many valuations but not by two at once.
+ */
+typedef struct valuate_context_struct * valuate_context ;
+
+/*!
+ * Create a valuation context.
+ * \return a new context
+ */
+extern valuate_context valuate_context_create ( void ) ;
+
+/*!
+ * Destroy a valuation context and release related resources.
+ * \param ctx (location of the) context to destroy
+ * \pre ctx is not NULL
+ */
+extern void valuate_context_destroy ( valuate_context * ctx ) ;
+
+/*!
+ * Same as \c term_valuate within a given context.
+ * \param ctx valuation context
+ * \param t term to simplify
+ * \pre ctx and t are not NULL
+ * \return simplified term
+ */
+extern term term_valuate_with_context ( valuate_context ctx , term t ) ;
+
 /*!
  * The initial term is not modified.
  * A new term is generated with all set simplified.
  * If a replacement provide a new variable (or a new \c set), it should be treated.
  *
  * It is not possible to replace all occurrences  of a variable at once since the variable may be redefined on the way.
+ * Variables are resolved through a scoped environment while the new term is built,
+ * so that the cost is linear in the size of the output term.
+ * A variable appearing in a value is valuated where the value is used.
  *
  * \param t term to simplify
  * \return simplified term
@@ -35,5 +68,66 @@
 extern term term_valuate ( term t ) ;
 
 
+/*!
+ * Shared valuated term.
+ * The value of a variable is built once for a given environment and every
+ * occurrence references it, so the size stays proportional to the initial term
+ * even when values are nested (like in \verbatim set ( 'a A ( 'b 'b ) set ( 'b B ( 'c 'c ) … ) ) \endverbatim).
+ * It is only expanded when printed or on demand.
+ */
+typedef struct valuate_dag_struct * valuate_dag ;
+
+/*!
+ * Same as \c term_valuate but the result is shared.
+ * The initial term is not modified.
+ * \param t term to simplify
+ * \pre t is not NULL
+ * \return shared simplified term
+ */
+extern valuate_dag valuate_dag_create ( term t ) ;
+
+/*!
+ * Same as \c valuate_dag_create within a given context.
+ * \param ctx valuation context
+ * \param t term to simplify
+ * \pre ctx and t are not NULL
+ * \return shared simplified term
+ */
+extern valuate_dag valuate_dag_create_with_context ( valuate_context ctx , term t ) ;
+
+/*!
+ * Destroy a shared valuated term and release related resources.
+ * \param dag (location of the) shared term to destroy
+ * \pre dag is not NULL
+ */
+extern void valuate_dag_destroy ( valuate_dag * dag ) ;
+
+/*!
+ * Return the number of nodes actually stored.
+ * No side effect, can be used in assert.
+ * \param dag queried shared term
+ * \pre dag is not NULL
+ * \return number of nodes
+ */
+extern long valuate_dag_get_size ( valuate_dag dag ) ;
+
+/*!
+ * Print the expansion of a shared term in compact format (like \c term_print_compact).
+ * The expansion is streamed, no term is built.
+ * \param dag shared term to print
+ * \param out stream to print to
+ * \pre dag and out are not NULL
+ */
+extern void valuate_dag_print_compact ( valuate_dag dag , FILE * out ) ;
+
+/*!
+ * Build the term corresponding to a shared term.
+ * \param dag shared term to expand
+ * \pre dag is not NULL
+ * \return independent term equal to what \c term_valuate returns
+ */
+extern term valuate_dag_expand ( valuate_dag dag ) ;
+
+
 
 # endif